@@ -38,6 +38,10 @@ struct CLinuxPlatformAtomics
 	{
 		return __sync_val_compare_and_swap(Dest, Comparand, Exchange);
 	}
+	static FORCEINLINE void* InterlockedCompareExchangePointer( void* volatile* Dest, void* Exchange, void* Comparand )
+	{
+		return __sync_val_compare_and_swap(Dest, Comparand, Exchange);
+	}
 };
 typedef CLinuxPlatformAtomics CPlatformAtomics;
 #endif
@@ -85,6 +89,10 @@ struct CWindowsPlatformAtomics
 	{
 		return (int32)_InterlockedCompareExchange((long*)Dest, (long)Exchange, (long)Comparand);
 	}
+	static FORCEINLINE void* InterlockedCompareExchangePointer( void* volatile* Dest, void* Exchange, void* Comparand )
+	{
+		return _InterlockedCompareExchangePointer(Dest, Exchange, Comparand);
+	}
 };
 typedef CWindowsPlatformAtomics CPlatformAtomics;
 
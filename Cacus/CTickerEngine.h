@@ -9,12 +9,18 @@
 
 	This controller knows when the next system timer will hit and will use one
 	or more of the necessary sleeping methods to reach the next timer.
+
+	With a socket poller set, the sleeping part of a tick waits on the
+	poller instead and dispatches network events as they arrive.
+	Ticks without idle time (TickNow) don't dispatch, call
+	CSocketPoller::Dispatch(0) from the tick if those are expected.
 =============================================================================*/
 
 #ifndef USES_CACUS_TICKER
 #define USES_CACUS_TICKER
 
 typedef int (*TickerCallback)(class CTickerEngine* Ticker);
+class CSocketPoller;
 
 class CACUS_API CTickerEngine
 {
@@ -27,6 +33,7 @@ protected:
 	double LastInterval;
 	double LastAdjustedInterval;
 	uint64 TickCount;
+	CSocketPoller* Poller;
 
 public:
 	TickerCallback Callback;
@@ -38,8 +45,10 @@ public:
 	double GetTimeStampResolution() const;
 	double GetLastTickTimestamp() const;
 	uint64 GetTickCount() const;
+	void SetPoller( CSocketPoller* InPoller); //Dispatch network events while sleeping, null to sleep natively
 
 	void NativeSleep( double Time);
+	void IdleSleep( double Time); //NativeSleep or poller dispatch
 	void NativeYield();
 	void FixState( double& EndTime, double CurrentTime); //Needed in case time goes around boundaries
 	void ResetState();
@@ -71,6 +80,11 @@ inline uint64 CTickerEngine::GetTickCount() const
 	return TickCount;
 }
 
+inline void CTickerEngine::SetPoller( CSocketPoller* InPoller)
+{
+	Poller = InPoller;
+}
+
 
 
 #endif
\ No newline at end of file
@@ -15,6 +15,7 @@
 
 #include "Atomics.h"
 #include "CacusTemplate.h"
+#include "CacusName.h"
 #include "TCharBuffer.h"
 
 class CStruct;
@@ -131,9 +132,21 @@ enum EParseType
 	PARSE_PlainTextForm, //method="POST" enctype="text/plain"
 	PARSE_Ini,
 	PARSE_JSON,
+	PARSE_Binary, //See CBinaryWriter
 	PARSE_MAX,
 };
 
+// Property types converted without virtual calls (see CStruct::ExportPrimitives)
+enum EPrimitiveType
+{
+	PRIMITIVE_None,
+	PRIMITIVE_Int32,
+	PRIMITIVE_UInt32,
+	PRIMITIVE_Float,
+	PRIMITIVE_Bool,
+	PRIMITIVE_MAX,
+};
+
 enum EPropertyFlags
 {
 	PF_NoConfig             = 0x00000001,
@@ -175,19 +188,26 @@ class CProperty;
 class PropertyInt32;
 class PropertyFloat;
 class PropertyBool;
+class CBinaryWriter;
+class CBinaryReader;
+struct CCopyStep;
 
 extern "C" CACUS_API CStruct* GetStruct( const char* StructName);
-extern "C" CACUS_API bool DataToObject( const char* Data, void* Into, CProperty* Outer, EParseType ImportType);
+extern "C" CACUS_API bool DataToObject( const char* Data, void* Into, CProperty* Outer, EParseType ImportType); //Text formats only, binary data needs DataViewToObject
+extern "C" CACUS_API bool DataViewToObject( const char* Data, size_t Len, void* Into, CProperty* Outer, EParseType ImportType); //Data doesn't need a terminator (ex: CMappedFile)
 extern "C" CACUS_API void ObjectToObject( void* From, void* Into, CProperty* FromOuter, CProperty* IntoOuter);
 #ifdef _STRING_
 extern "C" CACUS_API void ObjectToData( std::string& OutData, void* From, CProperty* Outer, EParseType ExportType, int DeltaDefaults=0);
 extern "C" CACUS_API bool DataToData( const char* InData, std::string& OutData, EParseType InFormat, EParseType OutFormat);
+extern "C" CACUS_API void ObjectToDelta( std::string& OutDelta, void* Base, void* From, CProperty* Outer); //Changes from Base to From, see Parser/Binary.h
+extern "C" CACUS_API bool DeltaToObject( const char* Delta, size_t Len, void* Into, CProperty* Outer);
 #endif
 
 class CACUS_API CField
 {
 public:
 	const char* Name;
+	CName NameHandle;
 	CStruct* Parent;
 	CField* Next;
 
@@ -222,15 +242,34 @@ class CACUS_API CStruct : public CField
 	CStruct* SuperStruct;
 	CField* Children;
 	CProperty* Properties;
+	CProperty** PropertyTable; //Declaration order, super struct properties first
+	uint32 PropertyCount;
+	uint8* PrimitiveTypes; //EPrimitiveType of every property in table
+	uint32* PrimitiveGroups; //Table positions of primitive properties grouped by type
+	uint32 PrimitiveGroupEnd[PRIMITIVE_MAX];
 	CProperty* DestructorLink;
 	void* DefaultObject;
+	CStruct* HashNext; //Registry chain
+	uint32 NameHash;
+	uint32 SchemaHash; //Binary format layout hash, computed on first use
+	CCopyStep* CopyPlan; //See CopyProperties, built on first use
 
 	CStruct( const char* InName, CStruct* InSuper, STRUCT_CREATOR InDefaultCreator, STRUCT_DESTRUCTOR DefaultDestructor);
 
 	CField* FindField( const char* FieldName) const;
+	CField* FindField( CName FieldName) const;
 	CProperty* FindProperty( const char* PropName) const;
+	CProperty* FindProperty( CName PropName) const;
+	int32 FindPropertyIndex( CName PropName) const; //Position in property table, -1 if not found
 
+	void BuildPropertyTable();
 	void DestroyProperties( void* Object);
+	void CopyProperties( void* From, void* Into) const;
+	bool IdenticalProperties( void* A, void* B) const;
+
+	enum { PRIMITIVE_TEXT_SIZE = 48 };
+	void ExportPrimitives( void* Objects, size_t Stride, size_t Count, char* OutText) const;
+	bool ImportPrimitives( void* Objects, size_t Stride, size_t Count, const char* const* Text) const;
 
 	void GenericDescribe( void* Object) const;
 };
@@ -242,6 +281,7 @@ public:
 		: CStruct( T::StaticStructName(), InSuper, LAMBDA_CREATOR(T), LAMBDA_DESTRUCTOR(T) )
 	{
 		T::CStructInit(this);
+		BuildPropertyTable();
 	}
 };
 
@@ -262,6 +302,12 @@ class CACUS_API CProperty : public CField
 	friend class CParserElement;
 	static bool CParserLog;
 
+	// Properties of a struct are placed in a static descriptor arena (see CP_CREATE)
+	static void* operator new( size_t Size, CStruct* InParent);
+	static void* operator new( size_t Size);
+	static void operator delete( void* Ptr, CStruct* InParent);
+	static void operator delete( void* Ptr);
+
 	virtual bool Parse( void* Into, const char* From) const              { return false; }
 	virtual void Import( void* Into, const CParserElement& Elem) const;
 	virtual void Export( void* From, CParserElement& Elem) const;
@@ -272,6 +318,24 @@ class CACUS_API CProperty : public CField
 	virtual void DestroyValue( void* Object) const                       { return; };
 	virtual const char* String( void* Object) const                      { return ""; };
 	virtual CProperty* GetInner() const                                  { return nullptr; }
+	virtual bool IsPlainData() const                                     { return false; } //Value can be copied with memcpy
+	virtual void CopyValue( void* From, void* Into) const;
+	virtual bool Identical( void* A, void* B) const;
+
+	// Streaming import (see CJSONReader)
+	virtual void* ImportObject( void* Into, const CStruct*& OutStruct, const char* ClassName) const { return nullptr; }
+	virtual bool ImportArray( void* Into) const                          { return false; }
+	virtual void* ImportArrayElement( void* Into, size_t Index) const    { return nullptr; }
+	virtual void ImportArrayEnd( void* Into, size_t Count) const         {}
+
+	// Streaming export (see CJSONWriter)
+	virtual const CStruct* ExportObject( void* From, void*& OutObject) const    { return nullptr; }
+	virtual bool ExportArray( void* From, size_t& OutCount) const        { return false; }
+	virtual void* ExportArrayElement( void* From, size_t Index) const    { return nullptr; }
+
+	// Binary serialization (see CBinaryWriter), defaults to String/Parse
+	virtual void WriteBinary( void* From, CBinaryWriter& Writer) const;
+	virtual bool ReadBinary( void* Into, CBinaryReader& Reader) const;
 
 	template<typename T> T& GetProp( void* Obj) const                    { return *(T*)((uint8*)Obj + Offset); }
 	template<typename T> T* GetAddr( void* Obj) const                    { return (T*)((uint8*)Obj + Offset); }
@@ -294,9 +358,13 @@ class CACUS_API PropertyStdString : public CProperty
 
 	bool Parse( void* Into, const char* From) const;
 	bool Booleanize( void* Object) const;
+	void CopyValue( void* From, void* Into) const;
+	bool Identical( void* A, void* B) const;
 	bool IsText() const                                                  { return true; }
 	void DestroyValue( void* Object) const;
 	const char* String( void* Object) const;
+	void WriteBinary( void* From, CBinaryWriter& Writer) const;
+	bool ReadBinary( void* Into, CBinaryReader& Reader) const;
 };
 #endif
 
@@ -317,8 +385,12 @@ class CACUS_API PropertyC8TextBase : public CProperty
 
 	bool Parse( void* Into, const char* From) const;
 	bool Booleanize( void* Object) const;
+	bool IsPlainData() const                                             { return true; }
+	bool Identical( void* A, void* B) const;
 	bool IsText() const                                                  { return true; }
 	const char* String( void* Object) const;
+	void WriteBinary( void* From, CBinaryWriter& Writer) const;
+	bool ReadBinary( void* Into, CBinaryReader& Reader) const;
 
 	//Custom export rule
 	bool ShouldExport( void* From, void* Delta) const
@@ -338,8 +410,12 @@ class CACUS_API PropertyC16TextBase : public CProperty
 
 	bool Parse( void* Into, const char* From) const;
 	bool Booleanize( void* Object) const;
+	bool IsPlainData() const                                             { return true; }
+	bool Identical( void* A, void* B) const;
 	bool IsText() const                                                  { return true; }
 	const char* String( void* Object) const;
+	void WriteBinary( void* From, CBinaryWriter& Writer) const;
+	bool ReadBinary( void* Into, CBinaryReader& Reader) const;
 
 	//Custom export rule
 	bool ShouldExport( void* From, void* Delta) const
@@ -371,7 +447,10 @@ class CACUS_API PropertyInt32 : public CProperty
 
 	bool Parse( void* Into, const char* From) const;
 	bool Booleanize( void* Object) const;
+	bool IsPlainData() const                                             { return true; }
 	const char* String( void* Object) const;
+	void WriteBinary( void* From, CBinaryWriter& Writer) const;
+	bool ReadBinary( void* Into, CBinaryReader& Reader) const;
 };
 
 class CACUS_API PropertyUInt32 : public CProperty
@@ -384,7 +463,10 @@ class CACUS_API PropertyUInt32 : public CProperty
 
 	bool Parse( void* Into, const char* From) const;
 	bool Booleanize( void* Object) const;
+	bool IsPlainData() const                                             { return true; }
 	const char* String( void* Object) const;
+	void WriteBinary( void* From, CBinaryWriter& Writer) const;
+	bool ReadBinary( void* Into, CBinaryReader& Reader) const;
 };
 
 class CACUS_API PropertyFloat : public CProperty
@@ -397,7 +479,10 @@ class CACUS_API PropertyFloat : public CProperty
 
 	bool Parse( void* Into, const char* From) const;
 	bool Booleanize( void* Object) const;
+	bool IsPlainData() const                                             { return true; }
 	const char* String( void* Object) const;
+	void WriteBinary( void* From, CBinaryWriter& Writer) const;
+	bool ReadBinary( void* Into, CBinaryReader& Reader) const;
 };
 
 class CACUS_API PropertyBool : public CProperty
@@ -410,7 +495,10 @@ class CACUS_API PropertyBool : public CProperty
 
 	bool Parse( void* Into, const char* From) const;
 	bool Booleanize( void* Object) const;
+	bool IsPlainData() const                                             { return true; }
 	const char* String( void* Object) const;
+	void WriteBinary( void* From, CBinaryWriter& Writer) const;
+	bool ReadBinary( void* Into, CBinaryReader& Reader) const;
 };
 
 class CACUS_API PropertyEnum : public CProperty
@@ -428,13 +516,16 @@ class CACUS_API PropertyEnum : public CProperty
 
 	bool Parse( void* Into, const char* From) const;
 	bool Booleanize( void* Object) const;
+	bool IsPlainData() const                                             { return true; }
 	bool IsText() const                                                  { return true; }
 	const char* String( void* Object) const;
+	void WriteBinary( void* From, CBinaryWriter& Writer) const;
+	bool ReadBinary( void* Into, CBinaryReader& Reader) const;
 
 	template<typename T,uint32 InCount> friend PropertyEnum* CreateProperty( const char* Name, CStruct* Parent, T& Prop, const char* (&InLiterals)[InCount], uint32 PropertyFlags=0 )
 	{
 		static_assert( sizeof(T) == sizeof(int), "NOT AN ENUM(int32) PROPERTY");
-		return new PropertyEnum( Name, Parent, 1, ((size_t)&Prop) - CSTRUCT_BASE, PropertyFlags, InLiterals);
+		return new(Parent) PropertyEnum( Name, Parent, 1, ((size_t)&Prop) - CSTRUCT_BASE, PropertyFlags, InLiterals);
 	}
 };
 
@@ -452,7 +543,14 @@ class CACUS_API PropertyFixedArray : public CProperty
 
 	void Import( void* Into, const CParserElement& Elem) const;
 	void Export( void* From, CParserElement& Elem) const;
+	bool ImportArray( void* Into) const;
+	void* ImportArrayElement( void* Into, size_t Index) const;
+	void ImportArrayEnd( void* Into, size_t Count) const;
+	bool ExportArray( void* From, size_t& OutCount) const;
+	void* ExportArrayElement( void* From, size_t Index) const;
 	bool Booleanize( void* Object) const;
+	void CopyValue( void* From, void* Into) const;
+	bool Identical( void* A, void* B) const;
 	void DestroyValue( void* Object) const;
 	CProperty* GetInner() const                                          { return Inner; }
 };
@@ -469,7 +567,11 @@ class CACUS_API PropertyStruct : public CProperty
 
 	void Import( void* Into, const CParserElement& Elem) const;
 	void Export( void* From, CParserElement& Elem) const;
+	void* ImportObject( void* Into, const CStruct*& OutStruct, const char* ClassName) const;
+	const CStruct* ExportObject( void* From, void*& OutObject) const;
 	bool Booleanize( void* Object) const;
+	void CopyValue( void* From, void* Into) const;
+	bool Identical( void* A, void* B) const;
 };
 
 class CACUS_API PropertyStructPtr : public CProperty
@@ -484,7 +586,12 @@ class CACUS_API PropertyStructPtr : public CProperty
 
 	void Import( void* Into, const CParserElement& Elem) const;
 	void Export( void* From, CParserElement& Elem) const;
+	void* ImportObject( void* Into, const CStruct*& OutStruct, const char* ClassName) const;
+	const CStruct* ExportObject( void* From, void*& OutObject) const;
 	bool Booleanize( void* Object) const;
+	void CopyValue( void* From, void* Into) const;
+	bool Identical( void* A, void* B) const;
+	bool IsPointer() const                                               { return true; }
 	void DestroyValue( void* Object) const;
 };
 
@@ -503,7 +610,13 @@ class CACUS_API PropertyMasterObjectArray : public CProperty
 
 	void Import( void* Into, const CParserElement& Elem) const;
 	void Export( void* From, CParserElement& Elem) const;
+	bool ImportArray( void* Into) const;
+	void* ImportArrayElement( void* Into, size_t Index) const;
+	bool ExportArray( void* From, size_t& OutCount) const;
+	void* ExportArrayElement( void* From, size_t Index) const;
 	bool Booleanize( void* Object) const;
+	void CopyValue( void* From, void* Into) const;
+	bool Identical( void* A, void* B) const;
 	void DestroyValue( void* Object) const;
 	CProperty* GetInner() const                                          { return Inner; }
 };
@@ -521,7 +634,13 @@ class CACUS_API PropertyStdVectorBase : public CProperty
 
 	void Import( void* Into, const CParserElement& Elem) const;
 	void Export( void* From, CParserElement& Elem) const;
+	bool ImportArray( void* Into) const;
+	void* ImportArrayElement( void* Into, size_t Index) const;
+	bool ExportArray( void* From, size_t& OutCount) const;
+	void* ExportArrayElement( void* From, size_t Index) const;
 	bool Booleanize( void* Object) const;
+	void CopyValue( void* From, void* Into) const;
+	bool Identical( void* A, void* B) const;
 
 	CProperty* GetInner() const                                          { return Inner; }
 	size_t _CalcVectorSize( const CParserElement& Elem, CParserElement*& Child) const;
@@ -575,7 +694,7 @@ class CACUS_API PropertyStringFunction : public CProperty
 
 inline CProperty* CreateFunction( const char* Name, CStruct* Parent, PROP_STRING_FUNCTION StrFunc, PROP_BOOL_FUNCTION BoolFunc=&PropertyStringFunction::DefaultBooleanize )
 {
-	return new PropertyStringFunction(Name, Parent, StrFunc, BoolFunc);
+	return new(Parent) PropertyStringFunction(Name, Parent, StrFunc, BoolFunc);
 }
 
 
@@ -584,7 +703,7 @@ inline CProperty* CreateFunction( const char* Name, CStruct* Parent, PROP_STRING
 //=============================================================================
 
 #define CP_CREATE(Type,...) \
-	new Type(Name,Parent,1,((int_p)&Prop)-CSTRUCT_BASE,PropertyFlags,##__VA_ARGS__);
+	new(Parent) Type(Name,Parent,1,((int_p)&Prop)-CSTRUCT_BASE,PropertyFlags,##__VA_ARGS__);
 
 template<typename T> inline CProperty* CreateProperty( const char* Name, CStruct* Parent, T*& Prop, uint32 PropertyFlags=0)
 {
@@ -676,21 +795,46 @@ template<size_t BufSize> inline CProperty* CreateProperty( const char* Name, CSt
 
 template< typename T > void DataToObject( const char* Data, T& Into, EParseType ParseType)
 {
-	auto* Outer = CreateProperty("",nullptr,*(T*)nullptr,PF_Inner);
+	auto* Outer = CreateProperty("",nullptr,*(T*)CSTRUCT_BASE,PF_Inner);
 	DataToObject( Data, (void*)&Into, Outer, ParseType);
 	delete Outer;
 }
 
+template< typename T > bool DataViewToObject( const char* Data, size_t Len, T& Into, EParseType ParseType)
+{
+	auto* Outer = CreateProperty("",nullptr,*(T*)CSTRUCT_BASE,PF_Inner);
+	bool Result = DataViewToObject( Data, Len, (void*)&Into, Outer, ParseType);
+	delete Outer;
+	return Result;
+}
+
 
 #ifdef _STRING_
 template< typename T > std::string ObjectToData( const T& From, EParseType ExportType, int DeltaDefaults=0)
 {
-	auto* Outer = CreateProperty("",nullptr,*(T*)nullptr,PF_Inner);
+	auto* Outer = CreateProperty("",nullptr,*(T*)CSTRUCT_BASE,PF_Inner);
 	std::string Result;
 	ObjectToData( Result, (void*)&From, Outer, ExportType, DeltaDefaults);
 	delete Outer;
 	return Result;
 }
+
+template< typename T > std::string ObjectToDelta( const T& Base, const T& From)
+{
+	auto* Outer = CreateProperty("",nullptr,*(T*)CSTRUCT_BASE,PF_Inner);
+	std::string Result;
+	ObjectToDelta( Result, (void*)&Base, (void*)&From, Outer);
+	delete Outer;
+	return Result;
+}
+
+template< typename T > bool DeltaToObject( const char* Delta, size_t Len, T& Into)
+{
+	auto* Outer = CreateProperty("",nullptr,*(T*)CSTRUCT_BASE,PF_Inner);
+	bool Result = DeltaToObject( Delta, Len, (void*)&Into, Outer);
+	delete Outer;
+	return Result;
+}
 #endif
 
 template< typename T1, typename T2 > void ObjectToObject( const T1& From, T2& Into)
@@ -87,7 +87,7 @@ inline uint8* CMemExStack::PushBytes( size_t InSize, size_t InAlign=EALIGN_PLATF
 	Top = Result + InSize;
 	if ( Top > End )
 	{
-		PushBlock( Max(InSize,DefaultSize) );
+		PushBlock( Max(InSize+InAlign,DefaultSize) );
 		Result = AddressAlign(Top, InAlign);
 		Top = Result + InSize;
 	}
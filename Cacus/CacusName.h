@@ -0,0 +1,70 @@
+/*=============================================================================
+	CacusName.h
+	Author: Fernando Velzquez
+
+	Global interned name table.
+	Names are stored once as UTF-8 and referenced by integer handles, so
+	comparing two names is a single integer compare.
+=============================================================================*/
+
+#ifndef USES_CACUS_NAME
+#define USES_CACUS_NAME
+
+#include "CacusPlatform.h"
+
+#ifndef char16
+	#define char16 char16_t
+#endif
+#ifndef char32
+	#define char32 char32_t
+#endif
+
+enum ECNameFind
+{
+	CNAME_Find, // Do not add name to table, result is None if not found.
+	CNAME_Add,  // Add name to table if not found.
+};
+
+//
+// Interned name handle.
+//
+// Hashing and comparison are case-insensitive (ASCII letters only),
+// names that only differ in case share the comparison index while
+// the display index keeps the exact spelling.
+// Index 0 is reserved for None (empty string).
+//
+class CACUS_API CName
+{
+	int32 Index;
+	int32 DisplayIndex;
+
+public:
+	CName()
+		: Index(0)
+		, DisplayIndex(0)
+	{}
+
+	explicit CName( const char* Str, ECNameFind Find=CNAME_Add);
+	explicit CName( const char* Str, size_t Len, ECNameFind Find=CNAME_Add);
+	explicit CName( const char16* Str, ECNameFind Find=CNAME_Add);
+	explicit CName( const char32* Str, ECNameFind Find=CNAME_Add);
+#ifdef _WINDOWS
+	explicit CName( const wchar_t* Str, ECNameFind Find=CNAME_Add) : CName( (const char16*)Str, Find) {}
+#else
+	explicit CName( const wchar_t* Str, ECNameFind Find=CNAME_Add) : CName( (const char32*)Str, Find) {}
+#endif
+
+	const char* operator*() const;
+	size_t Len() const;
+	uint32 Hash() const;
+
+	int32 GetIndex() const                          { return Index; }
+	bool IsNone() const                             { return Index == 0; }
+
+	bool operator==( const CName& Other) const      { return Index == Other.Index; }
+	bool operator!=( const CName& Other) const      { return Index != Other.Index; }
+
+	static int32 Count();
+};
+
+#endif
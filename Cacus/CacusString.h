@@ -208,12 +208,12 @@ template < typename CHAR, size_t cmpsize > FORCEINLINE int CStrnicmp( const CHAR
 
 template<typename C> FORCEINLINE C CChrToUpper( C Chr)
 {
-	return CChrIsLower(Chr) ? Chr : (Chr - ('a' - 'A'));
+	return CChrIsLower(Chr) ? (Chr - ('a' - 'A')) : Chr;
 }
 
 template<typename C> FORCEINLINE C CChrToLower( C Chr)
 {
-	return CChrIsUpper(Chr) ? Chr : (Chr + ('a' - 'A'));
+	return CChrIsUpper(Chr) ? (Chr + ('a' - 'A')) : Chr;
 }
 
 
@@ -294,6 +294,29 @@ template < typename CHAR, size_t ArraySize > FORCEINLINE CHAR* CopyToBuffer( CHA
 	return CopyToBuffer<CHAR>( Src, ArraySize-1);
 }
 
+//*******************************************************************
+// NUMBER CONVERSION
+
+// Notes:
+// Conversions are locale independent and use a dot as decimal separator.
+// Formatters write a null terminated string into Out (CNUMBER_TEXT_SIZE chars are always enough)
+// and return its length, floats are written with the fewest digits that parse back into the same value.
+// Parsers skip leading whitespace and return the amount of characters read, zero if there is no number.
+// Integer parsers saturate on overflow, UInt32 reads '0x' hex and leading '0' octal like strtoul base 0.
+
+#define CNUMBER_TEXT_SIZE 32
+
+extern "C"
+{
+	CACUS_API size_t CFormatInt32 ( char* Out, int32 Value);
+	CACUS_API size_t CFormatUInt32( char* Out, uint32 Value);
+	CACUS_API size_t CFormatFloat ( char* Out, float Value);
+
+	CACUS_API size_t CParseInt32 ( const char* Str, int32* Value);
+	CACUS_API size_t CParseUInt32( const char* Str, uint32* Value);
+	CACUS_API size_t CParseFloat ( const char* Str, float* Value);
+};
+
 //*******************************************************************
 // STRING BUFFERS
 
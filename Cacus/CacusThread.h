@@ -69,6 +69,27 @@ private:
 	static ENTRY_TYPE CThreadEntryContainer( void* Arg);
 };
 
+//////////////////////////////////////////
+// Event (Cacus)
+// Wait() blocks until another thread calls Signal()
+// Auto reset events wake a single waiter and reset, manual reset events
+// stay signaled until Reset()
+//////////////////////////////////////////
+class CACUS_API CEvent
+{
+	void* Handle;
+public:
+	CEvent( bool bManualReset=false);
+	CEvent( const CEvent& Copy) = delete;
+	~CEvent();
+
+	void Signal();
+	void Reset();
+	bool Wait( double MaxWait=-1); //Seconds, negative waits indefinitely. False on timeout
+};
+
+extern "C" CACUS_API uint32 CGetProcessorCount(); //Online logical processors, at least 1
+
 
 
 
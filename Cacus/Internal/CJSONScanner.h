@@ -0,0 +1,62 @@
+/*=============================================================================
+	Internal/CJSONScanner.h
+	Author: Fernando Velzquez
+
+	Stage 1 JSON structural scanner.
+=============================================================================*/
+
+#pragma once
+
+#include "../CacusPlatform.h"
+
+//
+// Classifies JSON text in 64 byte blocks using SIMD compares and bit
+// arithmetic, producing the location of every token start:
+// - Structural characters {}[]:, outside of strings.
+// - Unescaped quotes (both opening and closing).
+// - First character of every literal (numbers, true, false, null).
+//
+// Whitespace and string contents never make it into the index, so the
+// parser can jump from token to token instead of testing every character.
+// The index is filled lazily in windows of INDEX_SIZE entries, quote,
+// escape and literal state is carried across blocks.
+//
+class CJSONScanner
+{
+public:
+	enum { INDEX_SIZE = 2048 };
+
+	CJSONScanner( const char* InBase, size_t InLen);
+
+	// Returns first token start at or after From, or the end of the text.
+	// Positions must be requested in increasing order.
+	const char* Next( const char* From);
+
+private:
+	const char* Base;
+	size_t Len;
+	size_t ScanOffset;
+	uint64 PrevEscaped;
+	uint64 PrevInString;
+	uint64 PrevScalar;
+	uint32 Pos;
+	uint32 Count;
+	const char* Indices[INDEX_SIZE];
+
+	bool Refill();
+	uint64 ScanBlock( const char* Block);
+};
+
+inline const char* CJSONScanner::Next( const char* From)
+{
+	do
+	{
+		while ( Pos < Count )
+		{
+			if ( Indices[Pos] >= From )
+				return Indices[Pos];
+			Pos++;
+		}
+	} while ( Refill() );
+	return Base + Len;
+}
@@ -2,6 +2,10 @@
 
 #ifdef _STRING_
 // Manually parse text using this if the stock code doesn't work for you
+#include "../CacusName.h"
+#include "../CacusMem.h"
+#include "CJSONScanner.h"
+
 class CStruct;
 class CProperty;
 enum EParseType;
@@ -16,34 +20,59 @@ enum EParserElementFlags
 	PEF_Root          = 0x0020, //Should not delete
 	PEF_DeltaExport   = 0x0040,
 	PEF_Inner         = 0x0080, //Keep?
+	PEF_ValueView     = 0x0100, //Value isn't null terminated at ValueLen
 
 	PEF_Inherit       = PEF_DeltaExport,
 };
 
+//
+// Elements, their children and their text live in the arena of the root
+// element and are released all at once with it, elements have no destructor.
+// Values may be views into the parsed text and are not necessarily null
+// terminated, use GetValue() when a C string is needed.
+// Parsed keys are only looked up in the name table, keys that aren't
+// names yet keep their text in the arena (KeyText) and a None Key.
+//
 class CParserElement
 {
 public:
 	CParserElement* Next;
 	CParserElement* Children;
-	std::string Key;
-	std::string Value;
+	CMemExStack* Mem;
+	CName Key;
+	const char* KeyText; //Set if Key isn't in the name table
+	const char* Value;
+	size_t ValueLen;
 	const char* TypeName;
 	int32 Flags;
 
-	//Default constructor
-	CParserElement( int32 InFlags)
-		: Next(nullptr), Children(nullptr), TypeName(nullptr), Flags(InFlags) {}
+	//Root constructor
+	CParserElement( int32 InFlags, CMemExStack& InMem)
+		: Next(nullptr), Children(nullptr), Mem(&InMem), KeyText(nullptr), Value(""), ValueLen(0), TypeName(nullptr), Flags(InFlags) {}
 
 	//Child constructor (attach at front of linked list)
-	CParserElement( CParserElement& Parent, const char* InKeyName="")
-		: Next(Parent.Children), Children(nullptr), Key(InKeyName), TypeName(nullptr), Flags(Parent.Flags&PEF_Inherit)
+	CParserElement( CParserElement& Parent, CName InKey=CName())
+		: Next(Parent.Children), Children(nullptr), Mem(Parent.Mem), Key(InKey), KeyText(nullptr), Value(""), ValueLen(0), TypeName(nullptr), Flags(Parent.Flags&PEF_Inherit)
 	{ Parent.Children = this; }
 
-	~CParserElement();
+	CParserElement* AddChild( CName InKey=CName())     { return new(*Mem) CParserElement( *this, InKey); }
+	CParserElement* NewElement( int32 InFlags) const   { return new(*Mem) CParserElement( InFlags, *Mem); }
+
+	void SetKey( const char* InKey, size_t InLen); //Does not add to the name table
+	const char* GetKey() const                            { return KeyText ? KeyText : *Key; }
+	bool HasKey() const                                   { return KeyText || !Key.IsNone(); }
+	bool MatchesKey( CName InKey, const char* InText) const;
+	void SetValue( const char* InValue);
+	void SetValue( const char* InValue, size_t InLen);
+	void SetValueView( const char* InValue, size_t InLen, bool bTerminated=false);
+	const char* GetValue() const;
+	const char* GetArenaValue() const; //Copies views into the arena, valid as long as the element
+	bool HasValue() const                                 { return ValueLen != 0; }
 
 	void LogTokens( uint32 Depth=0);
 	uint32 CountTokens( const bool bCountChildren=false);
 
+	CParserElement* GetChild( CName ChildKey) const;
 	CParserElement* GetChild( const char* ChildKey) const;
 	CParserElement* GetChild( const char* ChildKey, bool bCreate=false);
 	CParserElement* GetChild( uint32 ChildId, bool bCreate=false);
@@ -72,22 +101,42 @@ class CParser
 {
 public:
 	const char* Data;
+	CMemExStack Mem;
 	CParserElement RootElement;
 
-	CParser( const char* InData=nullptr)  : Data(InData), RootElement(PEF_Root) {}
+	CParser( const char* InData=nullptr)  : Data(InData), Mem(16384), RootElement(PEF_Root,Mem) {}
 	virtual ~CParser()                    {}
 	virtual bool Parse()                  { return false; }
 };
 
+//
+// Values are spans over the input text, only strings containing escape
+// sequences are decoded into the arena.
+// In-situ mode decodes strings into the input buffer instead and null
+// terminates them there, the buffer must outlive the element tree.
+// Whitespace and string contents are skipped using the structural index
+// built by the stage 1 scanner.
+//
 class CJSONParser : public CParser
 {
+	bool bInSitu;
+	CJSONScanner Scanner;
 public:
-	CJSONParser( const char* InData)  : CParser(InData) {}
+	static bool UseStructuralIndex; //Disable to fall back to per-character skipping
+
+	CJSONParser( const char* InData);
+	CJSONParser( char* InData, bool bInSitu);
 	bool Parse();
+	void SkipWhitespace();
 	bool ParseKey( CParserElement* Parent);
 	bool ParseValue( CParserElement* Element);
 	bool ParseObject( CParserElement* Element);
 	bool ParseArray( CParserElement* Container);
+
+	bool ParseString( const char*& OutStart, size_t& OutLen, bool& bOutTerminated);
+	bool ParseLiteral( const char*& OutStart, size_t& OutLen, bool& bOutTerminated);
+
+	static size_t Unescape( char* Dest, const char* Src, size_t SrcLen);
 };
 
 class CPlainTextFormParser : public CParser
@@ -24,6 +24,14 @@ enum ESocketState
 	SOCKET_MAX
 };
 
+enum ESocketPollFlags
+{
+	SOCKET_PollRead  = 0x0001,
+	SOCKET_PollWrite = 0x0002,
+	SOCKET_PollError = 0x0004, //Always reported (errors and hang ups)
+	SOCKET_PollEdge  = 0x0100, //CSocketPoller only
+};
+
 /*----------------------------------------------------------------------------
 	Socket abstraction (win32/unix).
 ----------------------------------------------------------------------------*/
@@ -39,6 +47,7 @@ typedef SocketBSD CSocket;
 
 class CACUS_API SocketGeneric
 {
+	friend class CSocketPoller;
 protected:
 	int_p SocketDescriptor;
 public:
@@ -72,7 +81,7 @@ public:
 	bool SendTo( const uint8* Buffer, int32 BufferSize, int32& BytesSent, const IPEndpoint& Dest);
 	bool Recv( uint8* Data, int32 BufferSize, int32& BytesRead); //Implement flags later
 	bool RecvFrom( uint8* Data, int32 BufferSize, int32& BytesRead, IPEndpoint& Source); //Implement flags later, add IPv6 type support
-	bool Poll();
+	uint32 Poll( uint32 PollFlags, double WaitTime=0); //Ready ESocketPollFlags, zero on timeout. Negative WaitTime waits indefinitely
 	bool Listen( int32 Backlog);
 	bool EnableBroadcast( bool bEnable=1);
 	void SetQueueSize( int32 RecvSize, int32 SendSize);
@@ -104,8 +113,6 @@ public:
 	bool SetNonBlocking();
 	bool SetReuseAddr( bool bReUse=true);
 	bool SetLinger();
-
-	ESocketState CheckState( ESocketState CheckFor, double WaitTime=0);
 };
 
 
@@ -132,6 +139,87 @@ public:
 #endif
 
 
+/*----------------------------------------------------------------------------
+	Socket poller.
+
+	Waits on many sockets at once and returns the ready ones in batches.
+	Uses epoll on Linux, poll (WSAPoll) elsewhere.
+
+	Usage:
+	- Add sockets with a combination of ESocketPollFlags, Add returns the
+	  slot that Modify/Remove take (also passed as Event::Slot).
+	- Wait() fills an event array, Dispatch() passes events to Callback.
+	- A CTickerEngine with SetPoller() dispatches events while it would
+	  otherwise sleep, so network I/O is serviced from the tick thread.
+
+	Notes:
+	- Sockets must be removed before they're closed or destroyed.
+	- SOCKET_PollError is always reported (errors and hang ups).
+	- SOCKET_PollEdge is only honored by epoll, poll is level triggered.
+	  Edge triggered sockets must be read/written until they'd block.
+----------------------------------------------------------------------------*/
+
+class CACUS_API CSocketPoller
+{
+public:
+	struct Event
+	{
+		CSocket* Socket;
+		void*    UserData;
+		uint32   Flags; //Ready ESocketPollFlags
+		int32    Slot;
+	};
+	typedef void (*EVENT_CALLBACK)( CSocketPoller* Poller, const Event& Ready);
+
+	enum { DISPATCH_BATCH = 64 };
+
+	EVENT_CALLBACK Callback;
+
+	CSocketPoller( EVENT_CALLBACK InCallback=nullptr);
+	CSocketPoller( const CSocketPoller& Copy) = delete;
+	~CSocketPoller();
+
+	int32 Add( CSocket* Socket, uint32 Flags, void* UserData=nullptr); //Slot, -1 on failure
+	bool Modify( int32 Slot, uint32 Flags);
+	bool Remove( int32 Slot);
+	int32 Num() const;
+
+	int32 Wait( Event* OutEvents, int32 MaxEvents, double WaitTime=0); //Ready count, 0 on timeout, -1 on error. Negative WaitTime waits indefinitely
+	int32 Dispatch( double WaitTime=0); //Waits once and passes the events to Callback
+	int32 DispatchFor( double Time); //Dispatches until Time has passed
+
+private:
+	struct Entry
+	{
+		CSocket* Socket; //Null if free
+		void*    UserData;
+		uint32   Flags;
+		int32    NextFree;
+	};
+
+	int_p  Handle; //epoll descriptor
+	Entry* Entries;
+	void*  PollFDs; //pollfd per entry when epoll isn't available
+	int32  EntryCount;
+	int32  EntrySize;
+	int32  FirstFree;
+	int32  Active;
+
+	bool IsUsed( int32 Slot) const;
+	bool Control( int32 Op, int32 Slot);
+};
+
+inline int32 CSocketPoller::Num() const
+{
+	return Active;
+}
+
+inline bool CSocketPoller::IsUsed( int32 Slot) const
+{
+	return (Slot >= 0) && (Slot < EntryCount) && Entries[Slot].Socket;
+}
+
+
 
 /*----------------------------------------------------------------------------
 	Socket abstraction inlines.
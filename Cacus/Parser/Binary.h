@@ -0,0 +1,113 @@
+/*=============================================================================
+	Parser/Binary.h
+	Author: Fernando Velzquez
+
+	Compact binary serialization for the CField property system.
+
+	Layout:
+	- Header: 'CBIN' magic, schema hash and payload size (little endian uint32).
+	- Objects: [class name] then (tag,value) pairs closed by a zero tag.
+	  Tags are the distance from the previously written property id, ids
+	  are positions in the property table of the struct.
+	- Arrays: element count followed by the elements.
+	- Integers are varints (zigzag for signed), floats are raw little endian,
+	  strings are length prefixed.
+
+	Notes:
+	- The schema hash covers property names, types and nesting of the root
+	property, data written with a different layout is rejected.
+	- The class name is only written for structs with a 'Class' property.
+	- Struct pointers are prefixed by a presence flag, null pointers are
+	left untouched when read.
+
+	Deltas ('CDLT' magic, same header) hold the changes between two
+	instances of the same type, the payload is empty if nothing changed:
+	- Objects: [class name] then a bitmask over property ids followed by
+	  the deltas of the marked properties.
+	- Arrays: a mode byte, zero if the whole array follows, one if the size
+	  is unchanged and an element bitmask with element deltas follows.
+	- Values of a new object (or one of another class) are written as a
+	  delta against nothing, which marks every property.
+	- Null pointers are replicated, the object is destroyed when applied.
+=============================================================================*/
+
+#pragma once
+
+#include "../CacusField.h"
+
+#ifdef _STRING_
+
+class CACUS_API CBinaryWriter
+{
+public:
+	enum { HEADER_SIZE = 12 };
+
+	CBinaryWriter( std::string& InOut, bool bInDelta=false);
+
+	void WriteRoot( const CProperty* Outer, void* From);
+	void WriteValue( const CProperty* Property, void* From);
+	void WriteObject( const CStruct* Struct, void* Object);
+
+	void WriteDeltaRoot( const CProperty* Outer, void* Base, void* From);
+	bool WriteDelta( const CProperty* Property, void* Base, void* From); //False (nothing written) if unchanged
+	void WriteDeltaObject( const CStruct* Struct, void* BaseObject, void* Object);
+
+	void WriteVarint( uint64 Value);
+	void WriteSigned( int64 Value);
+	void WriteFixed32( uint32 Value);
+	void WriteBytes( const void* Data, size_t Len);
+	void WriteString( const char* Text, size_t Len);
+
+private:
+	std::string& Out;
+	bool bDelta;
+
+	void WriteHeader( size_t Start, const uint8* Magic, const CProperty* Outer);
+};
+
+class CACUS_API CBinaryReader
+{
+public:
+	enum { MAX_DEPTH = 64 };
+
+	CBinaryReader( const void* InData, size_t InLen);
+
+	bool ReadRoot( const CProperty* Outer, void* Into);
+	bool ReadValue( const CProperty* Property, void* Into);
+	bool ReadObject( const CStruct* Struct, void* Object);
+
+	bool ReadDeltaRoot( const CProperty* Outer, void* Into);
+	bool ReadDelta( const CProperty* Property, void* Into);
+	bool ReadDeltaObject( const CStruct* Struct, void* Object);
+
+	bool ReadVarint( uint64& Value);
+	bool ReadSigned( int64& Value);
+	bool ReadFixed32( uint32& Value);
+	bool ReadBytes( const char*& OutData, size_t Len);
+	bool ReadString( const char*& OutText, size_t& OutLen);
+	const char* ReadText(); //Null terminated copy, valid until next call
+
+	bool HasError() const;
+	static size_t PeekSize( const void* Data, size_t Len); //Full size from header, zero if Len can't hold a binary or delta header
+
+private:
+	const uint8* Pos;
+	const uint8* End;
+	int32 Depth;
+	bool bError;
+	std::string Scratch;
+
+	bool Error( const char* Message);
+	bool ReadHeader( const uint8* Magic, const CProperty* Outer);
+	bool ReadClassName( const CStruct* Struct, const char*& OutClassName);
+	bool Discard( const CProperty* Property, const CStruct* Owner);
+};
+
+extern "C" CACUS_API uint32 BinarySchemaHash( const CProperty* Outer);
+
+inline bool CBinaryReader::HasError() const
+{
+	return bError;
+}
+
+#endif
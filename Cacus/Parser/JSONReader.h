@@ -0,0 +1,106 @@
+/*=============================================================================
+	Parser/JSONReader.h
+	Author: Fernando Velzquez
+
+	Streaming JSON reader bound to the CField property system.
+
+	Tokens are imported into the target object as they arrive, no element
+	tree is built so memory use is bounded by nesting depth and the length
+	of the longest string/literal, regardless of document size.
+
+	Data may be fed in arbitrary chunks (ex: as received from a socket),
+	tokens split across chunks are carried over to the next Feed call.
+
+	Notes:
+	- Polymorphic 'Class' keys are only honored if they're the first key
+	in an object, as the object needs to be created before its properties
+	are imported.
+	- Objects are imported as they're read, a malformed document may leave
+	the target partially imported. Arrays left open are trimmed to the
+	elements read.
+=============================================================================*/
+
+#pragma once
+
+#include "../CacusField.h"
+
+class CACUS_API CJSONReader
+{
+public:
+	enum { MAX_DEPTH = 64 };
+
+	CJSONReader( void* InInto, CProperty* InOuter);
+	~CJSONReader();
+
+	bool Feed( const char* Data, size_t Len);
+	bool Finish(); //Ends the stream, returns true if a full value was imported (error otherwise)
+
+	bool IsDone() const;
+	bool HasError() const;
+
+private:
+	enum EExpect
+	{
+		EXPECT_Done,
+		EXPECT_Value,
+		EXPECT_ValueOrEnd,
+		EXPECT_Key,
+		EXPECT_KeyOrEnd,
+		EXPECT_Colon,
+		EXPECT_CommaOrEnd,
+	};
+
+	struct CFrame
+	{
+		const CProperty* Property; //Property that owns the object/array
+		void* Container;           //Address the property applies to
+		const CStruct* Struct;     //Object struct, once resolved
+		void* Object;              //Object address, once resolved
+		size_t Count;              //Keys or elements read
+		uint8 bArray;
+		uint8 bPending;            //Object awaiting resolution (first key may be 'Class')
+		uint8 bIgnore;             //Read but do not import
+	};
+
+	CFrame Stack[MAX_DEPTH];
+	int32 Depth;
+	uint8 Expect;
+	bool bError;
+	bool bClassValue;
+	bool bCarryEscape;
+
+	//Import destination of next value
+	const CProperty* ValueProperty;
+	void* ValueContainer;
+
+	//Token split across chunks
+	char* Carry;
+	size_t CarryLen;
+	size_t CarrySize;
+
+	//Null terminated value
+	char* Scratch;
+	size_t ScratchSize;
+
+	bool Structural( char C);
+	bool String( const char* Start, size_t Len);
+	bool Literal( const char* Start, size_t Len);
+	bool BeginValue( bool bString=false);
+	void EndValue();
+	void ImportValue( const char* Value);
+	void Resolve( CFrame& Frame, const char* ClassName);
+	bool Error( const char* Message);
+	void Unwind();
+	bool AppendCarry( const char* Start, const char* End);
+	const char* ScratchValue( const char* Start, size_t Len);
+};
+
+inline bool CJSONReader::IsDone() const
+{
+	return (Expect == EXPECT_Done) && !bError;
+}
+
+inline bool CJSONReader::HasError() const
+{
+	return bError;
+}
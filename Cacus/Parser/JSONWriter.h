@@ -0,0 +1,46 @@
+/*=============================================================================
+	Parser/JSONWriter.h
+	Author: Fernando Velzquez
+
+	Direct JSON writer for the CField property system.
+
+	Objects are written straight from their properties into the output
+	string, no element tree is built.
+	Strings are escaped in a single pass, copying unescaped runs at once.
+	Number and bool properties are converted in batches per struct, along
+	with the rest of the elements of the array when possible.
+
+	Notes:
+	- Polymorphic objects write their 'Class' key first so they can be read
+	back by CJSONReader.
+=============================================================================*/
+
+#pragma once
+
+#include "../CacusField.h"
+
+#ifdef _STRING_
+
+class CACUS_API CJSONWriter
+{
+public:
+	CJSONWriter( std::string& InOut, bool bInDelta=false);
+
+	void WriteValue( const CProperty* Property, void* From);
+	void WriteObject( const CStruct* Struct, void* Object);
+
+	static void WriteString( std::string& Out, const char* Text, size_t Len);
+
+private:
+	std::string& Out;
+	bool bDelta;
+	std::string Scratch; //Primitive text rows, see CStruct::ExportPrimitives
+
+	bool WriteStructArray( const CProperty* Property, void* From, size_t Count);
+	size_t ExportPrimitives( const CStruct* Struct, void* Objects, size_t Stride, size_t Count);
+	void WriteStructProperties( const CStruct* Struct, void* Object, bool& bFirst, size_t Row);
+	void WriteKey( const CName& Key, bool& bFirst);
+	void WriteText( const CProperty* Property, const char* Text);
+};
+
+#endif
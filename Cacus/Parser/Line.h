@@ -9,49 +9,211 @@
 	- "\r\n" "\n" "\r"
 	Also, "\0" is always a line break
 
+	Text may be given with a length instead of null terminated, for example
+	the view of a CMappedFile.
+
+	Result modes:
+	- Parse: lines are copied into a single allocation, text can be discarded.
+	- ParseView: lines are (start,length) spans into the text, no copies.
+	- ParseInSitu: line breaks are overwritten with null terminators and
+	lines point into the text.
+	The text must outlive the results of the last two.
+
 	Notes:
 	- GetLineArray() will have an additional nullptr entry at Index=LineCount
-	for algorithms that don't want to query GetLineCount()
+	for algorithms that don't want to query GetLineCount(), same applies
+	to GetViewArray() with a null Start.
+	- GetLineArray() is empty after ParseView and GetViewArray() is empty
+	after Parse and ParseInSitu.
 	- Line breaks may be replaced with tokens for a token based parser.
+	- Text is scanned for the first characters of the line breaks 16 bytes
+	at a time when there's up to three distinct ones (as in the default set).
+
+	CParserFastLine is available for char, char16, char32 and wchar_t text
+	(CParserFastLine8/16/32/W), line breaks are given in the same width.
+	Characters outside of the 8 bit range are scanned in the same way.
+
+	CParserStreamLine8 splits text that arrives in chunks, see below.
 =============================================================================*/
 
 
 //
-// 8 bit char line parser.
+// Compiled set of line breaks, used by the line parsers.
+// Implemented for char, char16, char32 and wchar_t text.
+//
+struct CACUS_API CLineBreakMatcher
+{
+	enum
+	{
+		MATCH_None    = -1,
+		MATCH_Partial = -2, //Text ended in the middle of a break
+	};
+
+	uint32 StartMask[256]; //Bit i set if break i starts with a character with this low byte
+	uint32 ScanChars[4];
+	uint32 ScanCharCount;  //Zero if the scanner can't use SIMD compares
+	bool   bMatchAll;      //Too many breaks for the table, test all of them
+
+	template<typename CHAR> CLineBreakMatcher( const CHAR** Breaks, size_t BreakCount);
+	template<typename CHAR> void Compile( const CHAR** Breaks, size_t BreakCount);
+
+	template<typename CHAR> const CHAR* Find( const CHAR* Text, const CHAR* End) const;
+	template<typename CHAR> int32 Match( const CHAR** Breaks, size_t BreakCount, const CHAR* Text, const CHAR* End, bool bFinal) const;
+};
+
+
+//
+// Line parser for any char width.
 //
-class CACUS_API CParserFastLine8
+template<typename CHAR> class CACUS_API CParserFastLine
 {
+public:
+	struct LineView
+	{
+		const CHAR* Start;
+		size_t      Len;
+	};
+
+protected:
+	size_t          LineCount;
+	const CHAR**    LineArray;
+	const LineView* ViewArray;
+	void*           Data;
+
+	size_t       LineBreakCount;
+	const CHAR** LineBreakArray;
+public:
+	CParserFastLine();
+	~CParserFastLine();
+
+	void SetLineBreaks( const CHAR** NewLineBreakArray, size_t NewLineBreakCount);
+
+	bool Parse( const CHAR* Text);
+	bool Parse( const CHAR* Text, size_t Len);
+	bool ParseView( const CHAR* Text, size_t Len);
+	bool ParseInSitu( CHAR* Text);
+
+	// Inlines
+	size_t          GetLineCount();
+	const CHAR**    GetLineArray();
+	const LineView* GetViewArray();
+
 protected:
-	size_t       LineCount;
-	const char** LineArray;
-	void*        Data;
+	enum EResultMode
+	{
+		RESULT_Copy,
+		RESULT_View,
+		RESULT_InSitu,
+	};
+
+	bool ParseLines( const CHAR* Text, size_t Len, EResultMode Mode);
+};
+
+extern template class CParserFastLine<char>;
+extern template class CParserFastLine<char16>;
+extern template class CParserFastLine<char32>;
+extern template class CParserFastLine<wchar_t>;
+
+typedef CParserFastLine<char>    CParserFastLine8;
+typedef CParserFastLine<char16>  CParserFastLine16;
+typedef CParserFastLine<char32>  CParserFastLine32;
+typedef CParserFastLine<wchar_t> CParserFastLineW;
 
+
+//
+// 8 bit char incremental line parser.
+//
+// Chunks of text (ex: socket reads) are fed as they arrive and complete
+// lines are returned by Next() until it runs out of them. Lines inside a
+// chunk are returned in place as (start,length) spans, a line split across
+// chunks is joined in an internal buffer and returned null terminated.
+// A line is complete once its line break has been seen, Finish() marks
+// the end of the stream so the last line doesn't need one.
+//
+// Usage:
+//	Lines.Feed( Buffer, Read);
+//	while ( Lines.Next( Line, Len) )
+//		...
+//
+class CACUS_API CParserStreamLine8
+{
+protected:
+	CLineBreakMatcher Matcher;
 	size_t       LineBreakCount;
 	const char** LineBreakArray;
+	size_t       MaxBreakLen;
+
+	// Unread part of the last chunk
+	const char* Pos;
+	const char* End;
+
+	// Incomplete line
+	char*  Carry;
+	size_t CarryLen;
+	size_t CarrySize;
+	size_t CarryScan;     //Offset where the line break search resumes
+	size_t CarryConsumed; //Returned as a line, removed on next call
+	bool   bFinished;
+
 public:
-	CParserFastLine8();
-	~CParserFastLine8();
+	CParserStreamLine8();
+	~CParserStreamLine8();
 
 	void SetLineBreaks( const char** NewLineBreakArray, size_t NewLineBreakCount);
 
-	bool Parse( const char* Text);
+	void Feed( const char* Data, size_t Len); //Data must stay valid until Next() returns false
+	bool Next( const char*& OutLine, size_t& OutLen); //Line is valid until the next call
+	void Finish();
+	void Reset();
+
+	template<typename FUNC> void Feed( const char* Data, size_t Len, FUNC&& OnLine);
 
 	// Inlines
-	size_t       GetLineCount();
-	const char** GetLineArray();
+	size_t GetBufferedLen() const; //Bytes fed that haven't been returned as lines
+
+protected:
+	bool ScanLine( const char* Text, const char* TextEnd, bool bFinal, const char*& OutLineEnd, const char*& OutNext, const char*& OutResume) const;
+	void AppendCarry( const char* Start, size_t Len);
 };
 
 
 /*-----------------------------------------------------------------------------
-	CParserFastLine8.
+	CParserFastLine.
 -----------------------------------------------------------------------------*/
 
-inline size_t CParserFastLine8::GetLineCount()
+template<typename CHAR> inline size_t CParserFastLine<CHAR>::GetLineCount()
 {
 	return LineCount;
 }
 
-inline const char** CParserFastLine8::GetLineArray()
+template<typename CHAR> inline const CHAR** CParserFastLine<CHAR>::GetLineArray()
 {
 	return LineArray;
 }
+
+template<typename CHAR> inline const typename CParserFastLine<CHAR>::LineView* CParserFastLine<CHAR>::GetViewArray()
+{
+	return ViewArray;
+}
+
+
+/*-----------------------------------------------------------------------------
+	CParserStreamLine8.
+-----------------------------------------------------------------------------*/
+
+//
+// Feeds a chunk and passes every completed line to OnLine( Line, Len).
+//
+template<typename FUNC> inline void CParserStreamLine8::Feed( const char* Data, size_t Len, FUNC&& OnLine)
+{
+	Feed( Data, Len);
+	const char* Line;
+	size_t LineLen;
+	while ( Next( Line, LineLen) )
+		OnLine( Line, LineLen);
+}
+
+inline size_t CParserStreamLine8::GetBufferedLen() const
+{
+	return (CarryLen - CarryConsumed) + (size_t)(End - Pos);
+}
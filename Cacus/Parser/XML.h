@@ -3,6 +3,27 @@
 	Author: Fernando Velzquez
 
 	Simple, single allocation result, read-only XML parser.
+
+	Text is parsed in the width it's given (UTF-8, char16, char32 or
+	wchar_t), nodes and browsers use the same width as the input:
+	- Parse( (const char*)Data) -> CreateBrowser<char>()
+	- Parse( L"...")            -> CreateBrowser() / CreateBrowser<wchar_t>()
+	GetRoot() returns null when asked for another width.
+
+	BuildIndex() adds a (parent,name) lookup table after parsing, browsers
+	created afterwards find children and same named siblings without
+	scanning sibling lists. Query("root/device/service") walks a path.
+
+	SetLayoutThreads() lets large documents write their nodes and strings
+	from multiple threads, split by the subtrees under the top level
+	elements. The resulting tree is the same in every mode, one thread
+	(default) lays out in a single pass without splitting.
+	Scaling has only been measured on a single core so far, where extra
+	layout threads are slower. Measure before enabling it.
+
+	SetLimits() bounds depth, node and attribute counts and memory, the
+	parse is aborted as soon as one is exceeded. Set them when parsing
+	documents from untrusted sources.
 =============================================================================*/
 
 
@@ -13,6 +34,8 @@ https://datatracker.ietf.org/doc/html/rfc7303
 
 */
 
+#include "../CacusName.h"
+#include "../CacusString.h"
 
 class CACUS_API CParserFastXML
 {
@@ -24,6 +47,15 @@ public:
 		NT_Comment,        // <!--Content-->
 	};
 
+	// Parse limits, zero means no limit
+	struct CLimits
+	{
+		uint32 MaxDepth;      // Open elements
+		size_t MaxNodes;      // Elements and text nodes
+		size_t MaxAttributes;
+		size_t MaxMemory;     // Temporary tree plus result, estimated from the parsed text
+	};
+
 	// Post-parse XML Tree
 	template <typename CHAR> struct Attrib
 	{
@@ -39,38 +71,191 @@ public:
 		const CHAR*   Content;
 		Attrib<CHAR>* Attribute;     // Valid if Type==NT_Element
 		int_p         Type;
+		CName         Name;          // Content if it's in the name table (None otherwise), valid if Type==NT_Element
 	};
 
 	CParserFastXML();
 	~CParserFastXML();
 
+	bool Parse( const char* Input); // UTF-8
+	bool Parse( const char16* Input);
+	bool Parse( const char32* Input);
 	bool Parse( const wchar_t* Input);
 	void Empty();
+	void SetLayoutThreads( uint32 MaxThreads); // 0 = one per processor, 1 = single threaded (default)
+	void SetLimits( const CLimits& InLimits);
+	const CLimits& GetLimits() const;
+
+	template <typename CHAR> const Node<CHAR>* GetRoot() const; // Null if parsed with another char width
+
+	// Child lookup index
+	enum { INDEX_None = 0xFFFFFFFF };
+	bool BuildIndex();
+	template <typename CHAR> uint32 IndexFindChild( uint32 Parent, const CHAR* Name) const;               // Parent is a node index + 1, zero for top level
+	template <typename CHAR> uint32 IndexFindSibling( uint32 Node, const CHAR* Name, bool bAfter) const; // First at (or after) Node
+	bool HasIndex() const;
 
 	// Simplified browser helper
-	class Browser
+	template <typename CHAR> class TBrowser
 	{
 	public:
-		Browser( const Node<wchar_t>* InPosition);
+		TBrowser( const Node<CHAR>* InPosition, const CParserFastXML* InOwner=nullptr);
 
-		bool Start( const wchar_t* FirstElementName);
-		bool Next( const wchar_t* NextElementName);
-		bool Down( const wchar_t* ChildElementName);
+		bool Start( const CHAR* FirstElementName);
+		bool Next( const CHAR* NextElementName);
+		bool Down( const CHAR* ChildElementName);
+		CACUS_API bool Query( const CHAR* Path); // Start, then Down for each '/' separated name
 
 		operator bool();
-		CACUS_API const wchar_t* operator*(); // Outputs contents (excluding Element brackets) using the circular buffer.
+		CACUS_API const CHAR* operator*(); // Outputs contents (excluding Element brackets) using the circular buffer.
 
-		const Node<wchar_t>* Position;
+		const Node<CHAR>* Position;
+		const CParserFastXML* Owner; // Index is used if the parser has one
+
+	private:
+		static const Node<CHAR>* FindElement( const Node<CHAR>* Link, CName Name, const CHAR* ElementName);
+		const Node<CHAR>* FindIndexed( uint32 Index) const;
 	};
+	typedef TBrowser<wchar_t> Browser;
 
-	Browser CreateBrowser()  { return Browser(Root); }
+	template <typename CHAR=wchar_t> TBrowser<CHAR> CreateBrowser() const  { return TBrowser<CHAR>(GetRoot<CHAR>(),this); }
 
 
 protected:
 	void* Data;
+	void* Root;
+	size_t CharSize; // Width of the parsed text
+	size_t NodeCount;
+	uint32 LayoutThreads;
+	CLimits Limits;
+
+	// Index, single allocation
+	void*   IndexData;
+	uint32* IndexParent;   // Parent node index + 1
+	uint32* IndexNextSame; // Next sibling with the same name
+	uint32* IndexNameHash; // Case-insensitive hash of the element text
+	uint32* IndexTable;    // Open addressing (Parent,Name) -> first child
+	uint32  IndexMask;
+
+	template <typename CHAR> bool ParseText( const CHAR* Input);
+	template <typename CHAR> void LinkIndex();
+};
+
+extern template class CParserFastXML::TBrowser<char>;
+extern template class CParserFastXML::TBrowser<char16>;
+extern template class CParserFastXML::TBrowser<char32>;
+extern template class CParserFastXML::TBrowser<wchar_t>;
 
+
+//
+// 8 bit char (UTF-8) pull XML reader.
+//
+// The document is fed in chunks as it arrives and read one event at a
+// time with Next(), no tree is built. Memory is bounded by the longest
+// markup/text token plus a chunk and the names of the open elements.
+// SetMaxTokenSize() caps the token, set it when reading from untrusted
+// sources.
+//
+// Events:
+// - StartElement: GetName(), followed by an Attribute event per attribute.
+// - Attribute:    GetName() and GetValue().
+// - Text:         GetValue(), text between tags and CDATA sections.
+// - Comment:      GetValue().
+// - EndElement:   GetName(), also sent after self closing elements.
+// - Done:         root element closed (or stream finished after it).
+// - NeedData:     chunk exhausted, Feed() more data or Finish().
+//
+// Notes:
+// - Names and values are null terminated and valid until the next call.
+// - Entities and character references are decoded, CDATA is not.
+// - Whitespace-only text, processing instructions and DOCTYPE are skipped.
+//
+// Usage:
+//	Reader.Feed( Buffer, Read);
+//	while ( (Event=Reader.Next()) > CParserStreamXML8::XML_NeedData )
+//		...
+//
+class CACUS_API CParserStreamXML8
+{
 public:
-	Node<wchar_t>* Root;
+	enum EEvent
+	{
+		XML_Error,
+		XML_NeedData,
+		XML_StartElement,
+		XML_Attribute,
+		XML_Text,
+		XML_Comment,
+		XML_EndElement,
+		XML_Done,
+	};
+	enum { MAX_DEPTH = 256 };
+
+	CParserStreamXML8();
+	~CParserStreamXML8();
+
+	void Feed( const char* Data, size_t Len); //Data must stay valid until Next() returns XML_NeedData
+	void Finish();
+	void Reset();
+	EEvent Next();
+	void SetMaxTokenSize( size_t MaxBytes); // Tag, text run, comment or CDATA section, zero means no limit (default)
+
+	// Inlines
+	const char* GetName() const;
+	const char* GetValue() const;
+	size_t      GetValueLen() const;
+	int32       GetDepth() const; //Open elements, including a started one
+
+protected:
+	// Unread part of the last chunk
+	const char* Pos;
+	const char* End;
+
+	size_t MaxTokenSize;
+
+	// Token split across chunks
+	char*  Carry;
+	size_t CarryLen;
+	size_t CarrySize;
+	size_t CarryRead;
+
+	// Token end search, resumed when more data arrives
+	size_t ScanOffset;
+	char   ScanQuote;
+	int32  ScanBrackets;
+
+	// Open element names, null terminated and back to back
+	char*  Names;
+	size_t NamesSize;
+	size_t NameStart[MAX_DEPTH];
+	int32  Depth;
+
+	// Start tag whose attributes are being read
+	const char* AttrPos;
+	const char* AttrEnd;
+	bool        bEmptyElement;
+
+	// Current event
+	const char* Name;
+	const char* Value;
+	char*       Scratch;
+	size_t      ScratchSize;
+	size_t      ValueLen;
+
+	bool bPopName;
+	bool bFinished;
+	bool bDone;
+	bool bError;
+
+	bool NextToken( const char*& OutStart, const char*& OutEnd);
+	const char* FindTokenEnd( const char* Text, const char* TextEnd, bool bFinal);
+	EEvent StartElement( const char* Start, const char* TokenEnd);
+	EEvent EndElement( const char* Start, const char* TokenEnd);
+	bool NextAttribute();
+	EEvent Error( const char* Message);
+	bool AppendCarry( const char* Start, size_t Len);
+	bool PushName( const char* Start, size_t Len);
+	char* ScratchValue( size_t Offset, const char* Start, size_t Len, bool bDecode);
 };
 
 
@@ -81,64 +266,134 @@ public:
 inline CParserFastXML::CParserFastXML()
 	: Data(nullptr)
 	, Root(nullptr)
+	, CharSize(0)
+	, NodeCount(0)
+	, LayoutThreads(1)
+	, IndexData(nullptr)
 {
+	Limits = CLimits{0,0,0,0};
+}
+
+inline void CParserFastXML::SetLayoutThreads( uint32 MaxThreads)
+{
+	LayoutThreads = MaxThreads;
+}
+
+inline void CParserFastXML::SetLimits( const CLimits& InLimits)
+{
+	Limits = InLimits;
+}
+
+inline const CParserFastXML::CLimits& CParserFastXML::GetLimits() const
+{
+	return Limits;
+}
+
+template <typename CHAR> inline const CParserFastXML::Node<CHAR>* CParserFastXML::GetRoot() const
+{
+	return (CharSize == sizeof(CHAR)) ? (const Node<CHAR>*)Root : nullptr;
+}
+
+inline bool CParserFastXML::HasIndex() const
+{
+	return IndexData != nullptr;
 }
 
 
 /*----------------------------------------------------------------------------
-	CParserFastXML::Iterator inlines
+	CParserFastXML::TBrowser inlines
 ----------------------------------------------------------------------------*/
 
-inline CParserFastXML::Browser::Browser( const CParserFastXML::Node<wchar_t>* InPosition)
+template <typename CHAR> inline CParserFastXML::TBrowser<CHAR>::TBrowser( const CParserFastXML::Node<CHAR>* InPosition, const CParserFastXML* InOwner)
 	: Position(InPosition)
+	, Owner( (InOwner && InOwner->HasIndex()) ? InOwner : nullptr)
 {
 }
 
-inline bool CParserFastXML::Browser::Start( const wchar_t* FirstElementName)
+//
+// Element names are only looked up during parse, so documents can't grow
+// the name table. Elements with names outside of it are matched by text.
+// The index hashes the element text and doesn't use the name table.
+//
+template <typename CHAR> inline const CParserFastXML::Node<CHAR>* CParserFastXML::TBrowser<CHAR>::FindElement( const Node<CHAR>* Link, CName Name, const CHAR* ElementName)
 {
-	for ( auto* Link=Position; Link; Link=Link->Next)
-		if ( (Link->Type == NT_Element) && Link->Content && !CStricmp(Link->Content,FirstElementName) )
-		{
-			Position = Link;
-			return true;
-		}
+	for ( ; Link; Link=Link->Next)
+		if ( (Link->Type == NT_Element) && (Link->Name.IsNone() ? !CStricmp( Link->Content, ElementName) : (Link->Name == Name)) )
+			return Link;
+	return nullptr;
+}
 
-	Position = nullptr;
-	return false;
+template <typename CHAR> inline const CParserFastXML::Node<CHAR>* CParserFastXML::TBrowser<CHAR>::FindIndexed( uint32 Index) const
+{
+	return (Index != INDEX_None) ? Owner->GetRoot<CHAR>() + Index : nullptr;
 }
 
-inline bool CParserFastXML::Browser::Next( const wchar_t* NextElementName)
+template <typename CHAR> inline bool CParserFastXML::TBrowser<CHAR>::Start( const CHAR* FirstElementName)
+{
+	if ( Position && Owner )
+		Position = FindIndexed( Owner->IndexFindSibling( (uint32)(Position - Owner->GetRoot<CHAR>()), FirstElementName, false));
+	else
+		Position = FindElement( Position, CName( FirstElementName, CNAME_Find), FirstElementName);
+	return Position != nullptr;
+}
+
+template <typename CHAR> inline bool CParserFastXML::TBrowser<CHAR>::Next( const CHAR* NextElementName)
 {
 	if ( Position )
 	{
-		for ( auto* Link=Position->Next; Link; Link=Link->Next)
-			if ( (Link->Type == NT_Element) && Link->Content && !CStricmp(Link->Content,NextElementName) )
-			{
-				Position = Link;
-				return true;
-			}
-		Position = nullptr;
+		if ( Owner )
+			Position = FindIndexed( Owner->IndexFindSibling( (uint32)(Position - Owner->GetRoot<CHAR>()), NextElementName, true));
+		else
+			Position = FindElement( Position->Next, CName( NextElementName, CNAME_Find), NextElementName);
+		return Position != nullptr;
 	}
 	return false;
 }
 
-inline bool CParserFastXML::Browser::Down( const wchar_t* ChildElementName)
+template <typename CHAR> inline bool CParserFastXML::TBrowser<CHAR>::Down( const CHAR* ChildElementName)
 {
 	if ( Position )
 	{
-		for ( auto* Link=Position->Child; Link; Link=Link->Next)
-			if ( (Link->Type == NT_Element) && Link->Content && !CStricmp(Link->Content,ChildElementName) )
-			{
-				Position = Link;
-				return true;
-			}
-		Position = nullptr;
+		if ( Owner )
+			Position = FindIndexed( Owner->IndexFindChild( (uint32)(Position - Owner->GetRoot<CHAR>()) + 1, ChildElementName));
+		else
+			Position = FindElement( Position->Child, CName( ChildElementName, CNAME_Find), ChildElementName);
+		return Position != nullptr;
 	}
 	return false;
 }
 
-inline CParserFastXML::Browser::operator bool()
+template <typename CHAR> inline CParserFastXML::TBrowser<CHAR>::operator bool()
 {
 	return Position != nullptr;
 }
 
+
+/*----------------------------------------------------------------------------
+	CParserStreamXML8 inlines
+----------------------------------------------------------------------------*/
+
+inline void CParserStreamXML8::SetMaxTokenSize( size_t MaxBytes)
+{
+	MaxTokenSize = MaxBytes;
+}
+
+inline const char* CParserStreamXML8::GetName() const
+{
+	return Name;
+}
+
+inline const char* CParserStreamXML8::GetValue() const
+{
+	return Value;
+}
+
+inline size_t CParserStreamXML8::GetValueLen() const
+{
+	return ValueLen;
+}
+
+inline int32 CParserStreamXML8::GetDepth() const
+{
+	return Depth;
+}
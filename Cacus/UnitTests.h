@@ -6,6 +6,20 @@
 extern "C" CACUS_API void TestCallbacks();
 extern "C" CACUS_API void TestCharBuffer();
 extern "C" CACUS_API void TestTimer();
+extern "C" CACUS_API void TestJSONScanner();
+extern "C" CACUS_API void TestJSONSpans();
+extern "C" CACUS_API void TestJSONReader();
+extern "C" CACUS_API void TestJSONWriter();
+extern "C" CACUS_API void TestBinaryFormat();
+extern "C" CACUS_API void TestObjectCopy();
+extern "C" CACUS_API void TestObjectDelta();
+extern "C" CACUS_API void TestPropertyTable();
+extern "C" CACUS_API void TestNumberConversion();
+extern "C" CACUS_API void TestMappedFile();
+extern "C" CACUS_API void TestLineParser();
+extern "C" CACUS_API void TestXMLReader();
+extern "C" CACUS_API void TestXMLParser();
+extern "C" CACUS_API void TestSocketPoller();
 
 inline void TestMain()
 {
@@ -13,6 +27,20 @@ inline void TestMain()
 	TEST_AND_CONTINUE(TestCallbacks)
 	TEST_AND_CONTINUE(TestCharBuffer)
 	TEST_AND_CONTINUE(TestTimer)
+	TEST_AND_CONTINUE(TestJSONScanner)
+	TEST_AND_CONTINUE(TestJSONSpans)
+	TEST_AND_CONTINUE(TestJSONReader)
+	TEST_AND_CONTINUE(TestJSONWriter)
+	TEST_AND_CONTINUE(TestBinaryFormat)
+	TEST_AND_CONTINUE(TestObjectCopy)
+	TEST_AND_CONTINUE(TestObjectDelta)
+	TEST_AND_CONTINUE(TestPropertyTable)
+	TEST_AND_CONTINUE(TestNumberConversion)
+	TEST_AND_CONTINUE(TestMappedFile)
+	TEST_AND_CONTINUE(TestLineParser)
+	TEST_AND_CONTINUE(TestXMLReader)
+	TEST_AND_CONTINUE(TestXMLParser)
+	TEST_AND_CONTINUE(TestSocketPoller)
 	#undef TEST_AND_CONTINUE
 }
 
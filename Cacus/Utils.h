@@ -30,6 +30,55 @@ namespace cacus
 };
 
 
+//
+// Read-only view of a whole file mapped into memory.
+// The data is read from the page cache on access, without copying it
+// into a heap buffer first. It's not null terminated, use the parser
+// entry points that take a length.
+//
+class CACUS_API CMappedFile
+{
+public:
+	CMappedFile();
+	CMappedFile( const char* InFilename);
+	~CMappedFile();
+
+	bool Open( const char* InFilename);
+	void Close();
+
+	bool IsOpen() const;
+	const uint8* GetData() const;
+	size_t GetSize() const;
+
+private:
+	const uint8* Data;
+	size_t Size;
+	bool bOpen;
+#if _WINDOWS
+	void* FileHandle;
+	void* MappingHandle;
+#endif
+
+	CMappedFile( const CMappedFile&) = delete;
+	CMappedFile& operator=( const CMappedFile&) = delete;
+};
+
+inline bool CMappedFile::IsOpen() const
+{
+	return bOpen;
+}
+
+inline const uint8* CMappedFile::GetData() const
+{
+	return Data;
+}
+
+inline size_t CMappedFile::GetSize() const
+{
+	return Size;
+}
+
+
 
 
 
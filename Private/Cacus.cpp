@@ -22,6 +22,7 @@ void CFixedArray::Setup( size_t NewNum, size_t ElementSize)
 		size_t OldAllocSize = Num*ElementSize;
 
 		size_t AllocSize = NewNum*ElementSize;
+		Data = nullptr;
 		if ( AllocSize )
 		{
 			Data = CMalloc( AllocSize);
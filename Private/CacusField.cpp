@@ -13,24 +13,121 @@
 
 #include "TimeStamp.h"
 #include "DebugCallback.h"
+#include "CacusMem.h"
 
+static const CName NAME_Class("Class");
 
-static CStruct* StructList = nullptr;
+
+//========= Struct registry - begin ==========//
+//
+// CStruct descriptors are hashed by name into a fixed bucket table.
+// Structs are never unregistered, so lookups walk the chains without
+// locking while registration is serialized by StructListLock and
+// published with an atomic swap of the bucket head.
+//
+// Struct names are static strings and every CStruct keeps the pointer it
+// was registered with, so callers handing back a registered name (such as
+// the 'Class' marker) are resolved by pointer comparison alone.
+//
+#define STRUCT_HASH_SIZE 256
+
+static CStruct* volatile StructHash[STRUCT_HASH_SIZE] = {0};
 static volatile int32 StructListLock = 0;
 
+static uint32 HashStructName( const char* Name)
+{
+	uint32 Hash = 2166136261u; //FNV-1a
+	while ( *Name )
+		Hash = (Hash ^ (uint8)*Name++) * 16777619u;
+	return Hash;
+}
+
+static void RegisterStruct( CStruct* Struct)
+{
+	CSpinLock SL( &StructListLock);
+	CStruct* volatile* Bucket = &StructHash[Struct->NameHash & (STRUCT_HASH_SIZE-1)];
+	Struct->HashNext = *Bucket;
+	CPlatformAtomics::InterlockedCompareExchangePointer( (void* volatile*)Bucket, Struct, Struct->HashNext);
+}
 
 CStruct* GetStruct( const char* StructName)
 {
-	for ( CField* Link=StructList ; Link ; Link=Link->Next )
-		if ( CStrcmp( Link->Name, StructName) )
-			return (CStruct*)Link;
+	if ( !StructName )
+		return nullptr;
+
+	uint32 Hash = HashStructName( StructName);
+	CStruct* First = StructHash[Hash & (STRUCT_HASH_SIZE-1)];
+	for ( CStruct* Link=First ; Link ; Link=Link->HashNext )
+		if ( Link->Name == StructName )
+			return Link;
+	for ( CStruct* Link=First ; Link ; Link=Link->HashNext )
+		if ( (Link->NameHash == Hash) && !CStrcmp( Link->Name, StructName) )
+			return Link;
 	return nullptr;
 }
+//========= Struct registry - end ==========//
+
+
+//========= Descriptor arena - begin ==========//
+//
+// Properties of a struct are created in sequence by CStructInit and live
+// as long as the program, they're placed back to back in a static arena
+// along with the property table of their struct.
+// Registering structs doesn't use the heap and the descriptors of a
+// struct share cache lines.
+//
+// Properties without a parent (array inners, temporaries) go to the heap,
+// as does everything once the arena is full.
+//
+#define PROPERTY_ARENA_SIZE (64*1024)
+
+static void* PropertyArena[PROPERTY_ARENA_SIZE / sizeof(void*)];
+static volatile int32 PropertyArenaUsed = 0;
+
+static void* AllocateDescriptor( size_t Size)
+{
+	Size = Align( Size, EALIGN_PLATFORM_PTR);
+	if ( Size <= PROPERTY_ARENA_SIZE )
+	{
+		int32 Start = CPlatformAtomics::InterlockedAdd( &PropertyArenaUsed, (int32)Size);
+		if ( Start + Size <= PROPERTY_ARENA_SIZE )
+			return (uint8*)PropertyArena + Start;
+		PropertyArenaUsed = PROPERTY_ARENA_SIZE; //Full, stop counter from growing
+	}
+	return CMalloc( Size);
+}
+
+static bool IsArenaDescriptor( void* Ptr)
+{
+	return (Ptr >= (void*)PropertyArena) && (Ptr < (void*)(PropertyArena + ARRAY_COUNT(PropertyArena)));
+}
+
+void* CProperty::operator new( size_t Size, CStruct* InParent)
+{
+	return InParent ? AllocateDescriptor( Size) : CMalloc( Size);
+}
+
+void* CProperty::operator new( size_t Size)
+{
+	return CMalloc( Size);
+}
+
+void CProperty::operator delete( void* Ptr, CStruct* InParent)
+{
+	operator delete( Ptr);
+}
 
+void CProperty::operator delete( void* Ptr)
+{
+	if ( Ptr && !IsArenaDescriptor( Ptr) )
+		CFree( Ptr);
+}
+//========= Descriptor arena - end ==========//
 
 
 CField::CField( const char* InName, CStruct* InParent)
 	: Name(InName)
+	, NameHandle(InName)
 	, Parent( InParent)
 {
 	if ( InParent )
@@ -56,24 +153,34 @@ CStruct::CStruct( const char* InName, CStruct* InSuper, STRUCT_CREATOR InDefault
 	, SuperStruct(InSuper)
 	, Children(nullptr)
 	, Properties(nullptr)
+	, PropertyTable(nullptr)
+	, PropertyCount(0)
+	, PrimitiveTypes(nullptr)
+	, PrimitiveGroups(nullptr)
 	, DestructorLink(nullptr)
 	, DefaultObject( (*InDefaultCreator)() )
+	, HashNext(nullptr)
+	, NameHash( HashStructName(InName) )
+	, SchemaHash(0)
+	, CopyPlan(nullptr)
 {
-	CSpinLock SL( &StructListLock);
-	Next = StructList;
-	StructList = (CStruct*)Next;
+	memset( PrimitiveGroupEnd, 0, sizeof(PrimitiveGroupEnd));
+	RegisterStruct( this);
 }
 
 CField* CStruct::FindField( const char* FieldName) const
 {
-	if ( FieldName )
-	{
-		for ( CField* Link=Children ; Link ; Link=Link->Next )
-			if ( _stricmp( Link->Name, FieldName) )
-				return Link;
-		if ( SuperStruct )
-			return SuperStruct->FindField( FieldName);
-	}
+	CName FieldHandle( FieldName, CNAME_Find);
+	return FieldHandle.IsNone() ? nullptr : FindField( FieldHandle);
+}
+
+CField* CStruct::FindField( CName FieldName) const
+{
+	for ( CField* Link=Children ; Link ; Link=Link->Next )
+		if ( Link->NameHandle == FieldName )
+			return Link;
+	if ( SuperStruct )
+		return SuperStruct->FindField( FieldName);
 	return nullptr;
 }
 
@@ -81,17 +188,91 @@ CProperty* CStruct::FindProperty( const char* PropertyName) const
 {
 	if ( PropertyName )
 	{
-		if ( !PropertyName[0] ) //Find a default property instead
-			PropertyName = "DefaultProperty";
-		for ( CProperty* Link=Properties ; Link ; Link=Link->NextProperty )
-			if ( !_stricmp( Link->Name, PropertyName) )
-				return Link;
-		if ( SuperStruct )
-			return SuperStruct->FindProperty( PropertyName);
+		CName PropertyHandle( PropertyName, CNAME_Find);
+		if ( !PropertyHandle.IsNone() || !PropertyName[0] )
+			return FindProperty( PropertyHandle);
+	}
+	return nullptr;
+}
+
+CProperty* CStruct::FindProperty( CName PropertyName) const
+{
+	if ( PropertyName.IsNone() ) //Find a default property instead
+	{
+		static const CName NAME_DefaultProperty( "DefaultProperty");
+		PropertyName = NAME_DefaultProperty;
 	}
+	if ( PropertyTable )
+	{
+		int32 Index = FindPropertyIndex( PropertyName);
+		return (Index >= 0) ? PropertyTable[Index] : nullptr;
+	}
+	for ( CProperty* Link=Properties ; Link ; Link=Link->NextProperty )
+		if ( Link->NameHandle == PropertyName )
+			return Link;
+	if ( SuperStruct )
+		return SuperStruct->FindProperty( PropertyName);
 	return nullptr;
 }
 
+int32 CStruct::FindPropertyIndex( CName PropertyName) const
+{
+	if ( PropertyName.IsNone() ) //Find a default property instead
+	{
+		static const CName NAME_DefaultProperty( "DefaultProperty");
+		PropertyName = NAME_DefaultProperty;
+	}
+	for ( uint32 i=PropertyCount ; i>0 ; i-- ) //Newest first, same as walking the property lists
+		if ( PropertyTable[i-1]->NameHandle == PropertyName )
+			return (int32)i - 1;
+	return -1;
+}
+
+static uint8 GetPrimitiveType( const CProperty* Property)
+{
+	if ( Property->ArrayDim == 1 )
+	{
+		if ( Property->IsType("PropertyInt32") )   return PRIMITIVE_Int32;
+		if ( Property->IsType("PropertyUInt32") )  return PRIMITIVE_UInt32;
+		if ( Property->IsType("PropertyFloat") )   return PRIMITIVE_Float;
+		if ( Property->IsType("PropertyBool") )    return PRIMITIVE_Bool;
+	}
+	return PRIMITIVE_None;
+}
+
+//
+// Flattens the property lists of this struct and its super structs into a
+// single array in declaration order, called once CStructInit is done.
+//
+void CStruct::BuildPropertyTable()
+{
+	uint32 Count = 0;
+	for ( const CStruct* Struct=this ; Struct ; Struct=Struct->SuperStruct )
+		for ( CProperty* Link=Struct->Properties ; Link ; Link=Link->NextProperty )
+			Count++;
+
+	CProperty** Table = (CProperty**)AllocateDescriptor( sizeof(CProperty*) * Max<uint32>( Count, 1));
+	uint32 i = Count;
+	for ( const CStruct* Struct=this ; Struct ; Struct=Struct->SuperStruct )
+		for ( CProperty* Link=Struct->Properties ; Link ; Link=Link->NextProperty )
+			Table[--i] = Link;
+	PropertyTable = Table;
+	PropertyCount = Count;
+
+	PrimitiveTypes = (uint8*)AllocateDescriptor( Max<uint32>( Count, 1));
+	PrimitiveGroups = (uint32*)AllocateDescriptor( sizeof(uint32) * Max<uint32>( Count, 1));
+	for ( i=0 ; i<Count ; i++ )
+		PrimitiveTypes[i] = GetPrimitiveType( Table[i]);
+	uint32 GroupEnd = 0;
+	for ( uint32 Type=PRIMITIVE_None+1 ; Type<PRIMITIVE_MAX ; Type++ )
+	{
+		for ( i=0 ; i<Count ; i++ )
+			if ( PrimitiveTypes[i] == Type )
+				PrimitiveGroups[GroupEnd++] = i;
+		PrimitiveGroupEnd[Type] = GroupEnd;
+	}
+}
+
 void CStruct::DestroyProperties( void* Object)
 {
 	for ( CProperty* Link=DestructorLink ; Link ; Link=Link->NextDestructor )
@@ -100,6 +281,226 @@ void CStruct::DestroyProperties( void* Object)
 		SuperStruct->DestroyProperties( Object);
 }
 
+//========= Copy plan - begin ==========//
+//
+// Plain data properties (numbers, enums, text buffers) are copied with
+// memcpy, adjacent ones merged into a single run. Structs held by value
+// are flattened into the plan of their owner unless they need a post
+// parse call, everything else is copied through CopyValue.
+// The same plan is used to compare objects (see IdenticalProperties).
+// Properties that are not exported or not imported are skipped, same as
+// when copying through an element tree.
+//
+struct CCopyStep
+{
+	size_t Offset;
+	size_t Size;               //Bytes copied with memcpy
+	const CProperty* Property; //Copied through CopyValue if Size is zero
+};
+
+static void AddCopySteps( CArray<CCopyStep>& Runs, CArray<CCopyStep>& Steps, const CStruct* Struct, size_t Base)
+{
+	for ( uint32 p=0 ; p<Struct->PropertyCount ; p++ )
+	{
+		const CProperty* Link = Struct->PropertyTable[p];
+		if ( Link->PropertyFlags & (PF_NoExport|PF_NoImport) )
+			continue;
+		CStruct* Model = Link->IsTypeA("PropertyStruct") ? ((const PropertyStruct*)Link)->Model : nullptr;
+		if ( Model && !Model->PostParseFunction )
+			AddCopySteps( Runs, Steps, Model, Base + Link->Offset);
+		else if ( Link->IsPlainData() )
+		{
+			CCopyStep Run = { Base + Link->Offset, Link->ElementSize * Link->ArrayDim, nullptr };
+			size_t i = Runs.size(); //Keep sorted by offset
+			while ( i && (Runs[i-1].Offset > Run.Offset) )
+				i--;
+			Runs.insert( Runs.begin() + i, Run);
+		}
+		else
+		{
+			CCopyStep Step = { Base, 0, Link };
+			Steps.push_back( Step);
+		}
+	}
+}
+
+static CCopyStep* BuildCopyPlan( const CStruct* Struct)
+{
+	CArray<CCopyStep> Runs, Steps;
+	AddCopySteps( Runs, Steps, Struct, 0);
+
+	CCopyStep* Plan = new CCopyStep[Runs.size() + Steps.size() + 1];
+	size_t Count = 0;
+	for ( size_t i=0 ; i<Runs.size() ; i++ )
+	{
+		if ( Count && (Runs[i].Offset <= Plan[Count-1].Offset + Plan[Count-1].Size) ) //Adjacent or aliased
+			Plan[Count-1].Size = Max( Plan[Count-1].Size, Runs[i].Offset + Runs[i].Size - Plan[Count-1].Offset);
+		else
+			Plan[Count++] = Runs[i];
+	}
+	for ( size_t i=0 ; i<Steps.size() ; i++ )
+		Plan[Count++] = Steps[i];
+	Plan[Count].Size = 0;
+	Plan[Count].Property = nullptr;
+	return Plan;
+}
+
+static const CCopyStep* GetCopyPlan( const CStruct* Struct)
+{
+	CCopyStep* Plan = Struct->CopyPlan;
+	if ( !Plan )
+	{
+		Plan = BuildCopyPlan( Struct);
+		CCopyStep* Current = (CCopyStep*)CPlatformAtomics::InterlockedCompareExchangePointer( (void* volatile*)&Struct->CopyPlan, Plan, nullptr);
+		if ( Current ) //Another thread published first
+		{
+			delete[] Plan;
+			Plan = Current;
+		}
+	}
+	return Plan;
+}
+
+void CStruct::CopyProperties( void* From, void* Into) const
+{
+	for ( const CCopyStep* Plan=GetCopyPlan(this) ; Plan->Size || Plan->Property ; Plan++ )
+	{
+		if ( Plan->Size )
+			CMemcpy( (uint8*)Into + Plan->Offset, (uint8*)From + Plan->Offset, Plan->Size);
+		else
+			Plan->Property->CopyValue( (uint8*)From + Plan->Offset, (uint8*)Into + Plan->Offset);
+	}
+	if ( PostParseFunction )
+		(*PostParseFunction)( Into);
+}
+
+bool CStruct::IdenticalProperties( void* A, void* B) const
+{
+	for ( const CCopyStep* Plan=GetCopyPlan(this) ; Plan->Size || Plan->Property ; Plan++ )
+	{
+		if ( Plan->Size )
+		{
+			if ( memcmp( (uint8*)A + Plan->Offset, (uint8*)B + Plan->Offset, Plan->Size) )
+				return false;
+		}
+		else if ( !Plan->Property->Identical( (uint8*)A + Plan->Offset, (uint8*)B + Plan->Offset) )
+			return false;
+	}
+	return true;
+}
+//========= Copy plan - end ==========//
+
+
+//========= Primitive batches - begin ==========//
+//
+// Int32, UInt32, Float and Bool properties are grouped by type when the
+// property table is built. Batch conversions run every group over all
+// objects with code specialized for the type, instead of a virtual
+// String or Parse call per property and object.
+// Text slots are PRIMITIVE_TEXT_SIZE bytes, property I of object N uses
+// slot N * PropertyCount + I.
+//
+static FORCEINLINE void FormatPrimitive( char* Text, uint32 Value)
+{
+	CFormatUInt32( Text, Value);
+}
+
+static FORCEINLINE void FormatPrimitive( char* Text, int32 Value)
+{
+	CFormatInt32( Text, Value);
+}
+
+static FORCEINLINE void FormatPrimitive( char* Text, float Value)
+{
+	CFormatFloat( Text, Value);
+}
+
+static FORCEINLINE void FormatPrimitive( char* Text, bool Value)
+{
+	CMemcpy( Text, Value ? "true" : "false", Value ? 5 : 6);
+}
+
+static FORCEINLINE bool ParsePrimitive( const char* Text, int32& Value)
+{
+	CParseInt32( Text, &Value);
+	return true;
+}
+
+static FORCEINLINE bool ParsePrimitive( const char* Text, uint32& Value)
+{
+	CParseUInt32( Text, &Value);
+	return true;
+}
+
+static FORCEINLINE bool ParsePrimitive( const char* Text, float& Value)
+{
+	CParseFloat( Text, &Value);
+	return true;
+}
+
+static FORCEINLINE bool ParsePrimitive( const char* Text, bool& Value)
+{
+	if ( !_stricmp( Text, "true") || !_stricmp( Text, "1") )
+		Value = true;
+	else if ( !_stricmp( Text, "false") || !_stricmp( Text, "0") )
+		Value = false;
+	else
+		return false;
+	return true;
+}
+
+template<typename T> static void ExportGroup( const CStruct* Struct, uint32 Type, uint8* Objects, size_t Stride, size_t Count, char* OutText)
+{
+	const uint32* First = Struct->PrimitiveGroups + Struct->PrimitiveGroupEnd[Type-1];
+	const uint32* End = Struct->PrimitiveGroups + Struct->PrimitiveGroupEnd[Type];
+	for ( size_t n=0 ; n<Count ; n++ )
+	{
+		uint8* Object = Objects + n * Stride;
+		char* Row = OutText + n * Struct->PropertyCount * CStruct::PRIMITIVE_TEXT_SIZE;
+		for ( const uint32* Index=First ; Index<End ; Index++ )
+			FormatPrimitive( Row + *Index * CStruct::PRIMITIVE_TEXT_SIZE, *(T*)(Object + Struct->PropertyTable[*Index]->Offset));
+	}
+}
+
+template<typename T> static bool ImportGroup( const CStruct* Struct, uint32 Type, uint8* Objects, size_t Stride, size_t Count, const char* const* Text)
+{
+	bool bResult = true;
+	const uint32* First = Struct->PrimitiveGroups + Struct->PrimitiveGroupEnd[Type-1];
+	const uint32* End = Struct->PrimitiveGroups + Struct->PrimitiveGroupEnd[Type];
+	for ( size_t n=0 ; n<Count ; n++ )
+	{
+		uint8* Object = Objects + n * Stride;
+		const char* const* Row = Text + n * Struct->PropertyCount;
+		for ( const uint32* Index=First ; Index<End ; Index++ )
+			if ( Row[*Index] && !ParsePrimitive( Row[*Index], *(T*)(Object + Struct->PropertyTable[*Index]->Offset)) )
+			{
+				DebugCallback( CSprintf("Import failed for property [%s] with value %s", Struct->PropertyTable[*Index]->Name, Row[*Index]), CACUS_CALLBACK_PARSER );
+				bResult = false;
+			}
+	}
+	return bResult;
+}
+
+// Writes the text of the primitive properties of every object, other slots are left untouched.
+void CStruct::ExportPrimitives( void* Objects, size_t Stride, size_t Count, char* OutText) const
+{
+	ExportGroup<int32>  ( this, PRIMITIVE_Int32,  (uint8*)Objects, Stride, Count, OutText);
+	ExportGroup<uint32> ( this, PRIMITIVE_UInt32, (uint8*)Objects, Stride, Count, OutText);
+	ExportGroup<float>  ( this, PRIMITIVE_Float,  (uint8*)Objects, Stride, Count, OutText);
+	ExportGroup<bool>   ( this, PRIMITIVE_Bool,   (uint8*)Objects, Stride, Count, OutText);
+}
+
+// Parses the primitive properties with non null text, other slots are ignored.
+bool CStruct::ImportPrimitives( void* Objects, size_t Stride, size_t Count, const char* const* Text) const
+{
+	bool bResult = ImportGroup<int32>( this, PRIMITIVE_Int32, (uint8*)Objects, Stride, Count, Text);
+	bResult = ImportGroup<uint32>( this, PRIMITIVE_UInt32, (uint8*)Objects, Stride, Count, Text) && bResult;
+	bResult = ImportGroup<float>( this, PRIMITIVE_Float, (uint8*)Objects, Stride, Count, Text) && bResult;
+	bResult = ImportGroup<bool>( this, PRIMITIVE_Bool, (uint8*)Objects, Stride, Count, Text) && bResult;
+	return bResult;
+}
+//========= Primitive batches - end ==========//
+
 void CStruct::GenericDescribe( void* Object) const
 {
 	if ( SuperStruct )
@@ -132,6 +533,21 @@ CProperty::CProperty( const char* InName, CStruct* InParent, int32 InArrayDim, s
 	}
 }
 
+void CProperty::CopyValue( void* From, void* Into) const
+{
+	if ( IsPlainData() )
+		CMemcpy( (uint8*)Into + Offset, (uint8*)From + Offset, ElementSize * ArrayDim);
+	else
+		Parse( Into, String( From));
+}
+
+bool CProperty::Identical( void* A, void* B) const
+{
+	if ( IsPlainData() )
+		return !memcmp( (uint8*)A + Offset, (uint8*)B + Offset, ElementSize * ArrayDim);
+	return !CStrcmp( String( A), String( B));
+}
+
 //=======================
 // PropertyStdString
 #ifdef _STRING_
@@ -158,6 +574,16 @@ const char* PropertyStdString::String( void* Object) const
 {
 	return CopyToBuffer( GetProp<Primitive>(Object).c_str() );
 }
+
+void PropertyStdString::CopyValue( void* From, void* Into) const
+{
+	GetProp<Primitive>(Into) = GetProp<Primitive>(From);
+}
+
+bool PropertyStdString::Identical( void* A, void* B) const
+{
+	return GetProp<Primitive>(A) == GetProp<Primitive>(B);
+}
 #endif
 
 //=======================
@@ -181,6 +607,11 @@ bool PropertyC8TextBase::Booleanize( void* Object) const
 	return *Prop != 0;
 }
 
+bool PropertyC8TextBase::Identical( void* A, void* B) const
+{
+	return !CStrncmp( GetAddr<char>(A), GetAddr<char>(B), BufSize);
+}
+
 const char* PropertyC8TextBase::String( void* Object) const //SHEEEEEEEIT
 {
 	char* SrcBuffer = (char*)Object + Offset;
@@ -213,6 +644,11 @@ bool PropertyC16TextBase::Booleanize( void* Object) const
 	return *Buffer != 0;
 }
 
+bool PropertyC16TextBase::Identical( void* A, void* B) const
+{
+	return !CStrncmp( GetAddr<char16>(A), GetAddr<char16>(B), BufSize);
+}
+
 const char* PropertyC16TextBase::String( void* Object) const //SHEEEEEEEIT
 {
 	char16* SrcBuffer = (char16_t*)((uint8*)Object + Offset);
@@ -233,7 +669,7 @@ const char* PropertyC16TextBase::String( void* Object) const //SHEEEEEEEIT
 bool PropertyFloat::Parse( void* Into, const char* From) const
 {
 	Primitive& Prop = GetProp<Primitive>(Into);
-	Prop = (float)atof(From);
+	CParseFloat( From, &Prop);
 	return true;
 }
 
@@ -246,7 +682,9 @@ bool PropertyFloat::Booleanize( void* Object) const
 const char* PropertyFloat::String( void* Object) const
 {
 	Primitive& Prop = GetProp<Primitive>(Object);
-	return CSprintf( "%f", Prop);
+	char* Text = CharBuffer<char>( CNUMBER_TEXT_SIZE);
+	CFormatFloat( Text, Prop);
+	return Text;
 }
 
 //=======================
@@ -255,7 +693,7 @@ const char* PropertyFloat::String( void* Object) const
 bool PropertyInt32::Parse( void* Into, const char* From) const
 {
 	Primitive& Prop = GetProp<Primitive>(Into);
-	Prop = atoi(From);
+	CParseInt32( From, &Prop);
 	return true;
 }
 
@@ -268,7 +706,9 @@ bool PropertyInt32::Booleanize( void* Object) const
 const char* PropertyInt32::String( void* Object) const
 {
 	Primitive& Prop = GetProp<Primitive>(Object);
-	return CSprintf( "%i", Prop);
+	char* Text = CharBuffer<char>( CNUMBER_TEXT_SIZE);
+	CFormatInt32( Text, Prop);
+	return Text;
 }
 
 //=======================
@@ -277,8 +717,7 @@ const char* PropertyInt32::String( void* Object) const
 bool PropertyUInt32::Parse( void* Into, const char* From) const
 {
 	Primitive& Prop = GetProp<Primitive>(Into);
-	char* EndPtr = (char*)From;
-	Prop = strtoul(From,&EndPtr,0);
+	CParseUInt32( From, &Prop);
 	return true;
 }
 
@@ -291,7 +730,9 @@ bool PropertyUInt32::Booleanize( void* Object) const
 const char* PropertyUInt32::String( void* Object) const
 {
 	Primitive& Prop = GetProp<Primitive>(Object);
-	return CSprintf( "%u", Prop);
+	char* Text = CharBuffer<char>( CNUMBER_TEXT_SIZE);
+	CFormatUInt32( Text, Prop);
+	return Text;
 }
 
 //=======================
@@ -366,6 +807,34 @@ void PropertyFixedArray::DestroyValue( void* Object) const
 	GetProp<Primitive>(Object).~CFixedArray();
 }
 
+void PropertyFixedArray::CopyValue( void* From, void* Into) const
+{
+	CFixedArray& FromArray = GetProp<Primitive>(From);
+	CFixedArray& IntoArray = GetProp<Primitive>(Into);
+	size_t Count = FromArray.Size();
+	IntoArray.Setup( Count, Inner->ElementSize);
+	if ( Inner->IsPlainData() )
+		CMemcpy( IntoArray.GetData(), FromArray.GetData(), Count * Inner->ElementSize);
+	else
+		for ( size_t i=0 ; i<Count ; i++ )
+			Inner->CopyValue( (uint8*)FromArray.GetData() + i * Inner->ElementSize, (uint8*)IntoArray.GetData() + i * Inner->ElementSize);
+}
+
+bool PropertyFixedArray::Identical( void* A, void* B) const
+{
+	CFixedArray& ArrayA = GetProp<Primitive>(A);
+	CFixedArray& ArrayB = GetProp<Primitive>(B);
+	size_t Count = ArrayA.Size();
+	if ( Count != ArrayB.Size() )
+		return false;
+	if ( Inner->IsPlainData() )
+		return !Count || !memcmp( ArrayA.GetData(), ArrayB.GetData(), Count * Inner->ElementSize);
+	for ( size_t i=0 ; i<Count ; i++ )
+		if ( !Inner->Identical( (uint8*)ArrayA.GetData() + i * Inner->ElementSize, (uint8*)ArrayB.GetData() + i * Inner->ElementSize) )
+			return false;
+	return true;
+}
+
 //=======================
 // PropertyMasterObjectArray
 #ifdef _VECTOR_
@@ -379,10 +848,55 @@ void PropertyMasterObjectArray::DestroyValue( void* Object) const
 	GetProp<Primitive>(Object).Empty();
 	GetProp<Primitive>(Object).~TMasterObjectArray();
 }
-#endif
+
+void PropertyMasterObjectArray::CopyValue( void* From, void* Into) const
+{
+	auto& FromList = GetProp<Primitive>(From).List;
+	ImportArray( Into);
+	for ( size_t i=0 ; i<FromList.size() ; i++ )
+		Inner->CopyValue( &FromList[i], ImportArrayElement( Into, i));
+}
+
+bool PropertyMasterObjectArray::Identical( void* A, void* B) const
+{
+	auto& ListA = GetProp<Primitive>(A).List;
+	auto& ListB = GetProp<Primitive>(B).List;
+	if ( ListA.size() != ListB.size() )
+		return false;
+	for ( size_t i=0 ; i<ListA.size() ; i++ )
+		if ( !Inner->Identical( &ListA[i], &ListB[i]) )
+			return false;
+	return true;
+}
+
 //=======================
 // PropertyStdVectorBase
 
+void PropertyStdVectorBase::CopyValue( void* From, void* Into) const
+{
+	size_t Count = VectorGetSize( From);
+	VectorSetSize( Into, Count);
+	if ( Count && Inner->IsPlainData() ) //Contiguous
+		CMemcpy( VectorGetElement( Into, 0), VectorGetElement( From, 0), Count * Inner->ElementSize);
+	else
+		for ( size_t i=0 ; i<Count ; i++ )
+			Inner->CopyValue( VectorGetElement( From, i), VectorGetElement( Into, i));
+}
+
+bool PropertyStdVectorBase::Identical( void* A, void* B) const
+{
+	size_t Count = VectorGetSize( A);
+	if ( Count != VectorGetSize( B) )
+		return false;
+	if ( Count && Inner->IsPlainData() )
+		return !memcmp( VectorGetElement( A, 0), VectorGetElement( B, 0), Count * Inner->ElementSize);
+	for ( size_t i=0 ; i<Count ; i++ )
+		if ( !Inner->Identical( VectorGetElement( A, i), VectorGetElement( B, i)) )
+			return false;
+	return true;
+}
+#endif
+
 
 
 //=======================
@@ -397,6 +911,16 @@ bool PropertyStruct::Booleanize( void* Object) const //If any sub-property boole
 	return false;
 }
 
+void PropertyStruct::CopyValue( void* From, void* Into) const
+{
+	Model->CopyProperties( GetAddr<void>(From), GetAddr<void>(Into));
+}
+
+bool PropertyStruct::Identical( void* A, void* B) const
+{
+	return Model->IdenticalProperties( GetAddr<void>(A), GetAddr<void>(B));
+}
+
 //=======================
 // PropertyStructPtr
 
@@ -412,6 +936,37 @@ bool PropertyStructPtr::Booleanize( void* Object) const
 	return false;
 }
 
+void PropertyStructPtr::CopyValue( void* From, void* Into) const
+{
+	void* FromObject = GetProp<void*>(From);
+	if ( !FromObject ) //Null pointers are left untouched
+		return;
+	const CStruct* Struct = Model;
+	CProperty* ClassProp = Model->FindProperty( NAME_Class);
+	void* IntoObject = ImportObject( Into, Struct, ClassProp ? ClassProp->String( FromObject) : nullptr);
+	if ( IntoObject )
+		Struct->CopyProperties( FromObject, IntoObject);
+}
+
+bool PropertyStructPtr::Identical( void* A, void* B) const
+{
+	void* ObjectA = GetProp<void*>(A);
+	void* ObjectB = GetProp<void*>(B);
+	if ( !ObjectA || !ObjectB )
+		return ObjectA == ObjectB;
+	const CStruct* Struct = Model;
+	CProperty* ClassProp = Model->FindProperty( NAME_Class);
+	if ( ClassProp ) //Objects of different classes are never identical
+	{
+		CStruct* RealStruct = GetStruct( ClassProp->String( ObjectA));
+		if ( RealStruct != GetStruct( ClassProp->String( ObjectB)) )
+			return false;
+		if ( RealStruct )
+			Struct = RealStruct;
+	}
+	return Struct->IdenticalProperties( ObjectA, ObjectB);
+}
+
 void PropertyStructPtr::DestroyValue( void * Object) const
 {
 	if ( PropertyFlags | PF_Destructible ) //Objects references by this need to be destroyed
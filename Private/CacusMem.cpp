@@ -29,11 +29,14 @@ static TChar8Buffer<256> ThrowLocal;
 void CMemExStack::PushBlock( size_t InSize)
 {
 	// Locate a suitable unused memory block
-	MemBlock* NewTopBlock = UnusedBlock;
-	while ( NewTopBlock && NewTopBlock->Size < InSize )
-		NewTopBlock = NewTopBlock->Next;
-
-	if ( !NewTopBlock )
+	MemBlock** UnusedLink = &UnusedBlock;
+	while ( *UnusedLink && (*UnusedLink)->Size < InSize )
+		UnusedLink = &(*UnusedLink)->Next;
+
+	MemBlock* NewTopBlock = *UnusedLink;
+	if ( NewTopBlock )
+		*UnusedLink = NewTopBlock->Next;
+	else
 	{
 		// Create one if needed
 		NewTopBlock = (MemBlock*)CMalloc(sizeof(MemBlock) + InSize);
@@ -45,8 +48,9 @@ void CMemExStack::PushBlock( size_t InSize)
 		NewTopBlock->Size = InSize;
 	}
 	NewTopBlock->Next = TopBlock;
+	TopBlock = NewTopBlock;
 	Top = NewTopBlock->Data;
-	End = Top + InSize;
+	End = Top + NewTopBlock->Size;
 }
 //========= Extendable Stack: PushBlock - end ==========//
 
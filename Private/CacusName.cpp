@@ -0,0 +1,222 @@
+/*=============================================================================
+	CacusName.cpp
+	Author: Fernando Velzquez
+
+	Global interned name table.
+=============================================================================*/
+
+#include "CacusLibPrivate.h"
+
+#include "CacusName.h"
+#include "CacusString.h"
+#include "DebugCallback.h"
+#include "CacusTemplate.h"
+#include "CacusMem.h"
+
+//========= Name table - begin ==========//
+//
+// Entries are bump allocated from pages that are never released and
+// indexed through a fixed array of chunk pointers, so resolving a handle
+// into text never needs to lock.
+// Hash chains are only ever prepended to, lookups walk them without
+// locking while insertions are serialized by NameLock and published with
+// an atomic swap of the bucket head.
+//
+// All table state is zero-initialized POD so handles can be created
+// during static initialization of other modules.
+//
+#define NAME_HASH_SIZE   4096
+#define NAME_CHUNK_SHIFT 12
+#define NAME_CHUNK_SIZE  (1 << NAME_CHUNK_SHIFT)
+#define NAME_MAX_CHUNKS  1024
+#define NAME_PAGE_SIZE   65536
+
+struct CNameEntry
+{
+	CNameEntry* HashNext;
+	uint32      Hash;
+	int32       Index;
+	int32       ComparisonIndex; //Index of the first entry with the same case-insensitive text
+	uint32      Length;
+	char        Text[1];
+};
+
+static CNameEntry* volatile NameHash[NAME_HASH_SIZE] = {0};
+static CNameEntry** NameChunks[NAME_MAX_CHUNKS] = {0};
+static CNameEntry NameNone = { nullptr, 0, 0, 0, 0, {0} };
+static volatile int32 NameCount = 1; //None is always present
+static volatile int32 NameLock = 0;
+static uint8* NamePoolTop = nullptr;
+static uint8* NamePoolEnd = nullptr;
+
+
+static FORCEINLINE char NameToLower( char C)
+{
+	return (C >= 'A' && C <= 'Z') ? (C + ('a'-'A')) : C;
+}
+
+static uint32 HashName( const char* Str, size_t Len)
+{
+	uint32 Hash = 2166136261u; //FNV-1a
+	for ( size_t i=0 ; i<Len ; i++ )
+		Hash = (Hash ^ (uint8)NameToLower(Str[i])) * 16777619u;
+	return Hash;
+}
+
+static bool NameEqualsI( const CNameEntry* Entry, const char* Str, size_t Len)
+{
+	for ( size_t i=0 ; i<Len ; i++ )
+		if ( NameToLower(Entry->Text[i]) != NameToLower(Str[i]) )
+			return false;
+	return true;
+}
+
+// Returns the entry with exact spelling, or the first case-insensitive match in Similar
+static CNameEntry* FindEntry( CNameEntry* Link, const char* Str, size_t Len, uint32 Hash, CNameEntry*& Similar)
+{
+	Similar = nullptr;
+	for ( ; Link ; Link=Link->HashNext )
+		if ( (Link->Hash == Hash) && (Link->Length == Len) )
+		{
+			if ( !memcmp( Link->Text, Str, Len) )
+				return Link;
+			if ( !Similar && NameEqualsI( Link, Str, Len) )
+				Similar = Link;
+		}
+	return nullptr;
+}
+
+static CNameEntry* AllocateEntry( const char* Str, size_t Len, uint32 Hash, CNameEntry* Similar)
+{
+	size_t EntrySize = Align( sizeof(CNameEntry) + Len, EALIGN_PLATFORM_PTR);
+	if ( NamePoolTop + EntrySize > NamePoolEnd )
+	{
+		size_t PageSize = Max<size_t>( EntrySize, NAME_PAGE_SIZE);
+		NamePoolTop = (uint8*)CMalloc( PageSize);
+		if ( !NamePoolTop )
+			return nullptr;
+		NamePoolEnd = NamePoolTop + PageSize;
+	}
+
+	int32 Index = NameCount;
+	int32 Chunk = Index >> NAME_CHUNK_SHIFT;
+	if ( Chunk >= NAME_MAX_CHUNKS )
+		return nullptr;
+	if ( !NameChunks[Chunk] )
+	{
+		NameChunks[Chunk] = (CNameEntry**)CMalloc( sizeof(CNameEntry*) * NAME_CHUNK_SIZE);
+		if ( !NameChunks[Chunk] )
+			return nullptr;
+	}
+
+	CNameEntry* Entry = (CNameEntry*)NamePoolTop;
+	NamePoolTop += EntrySize;
+	Entry->Hash   = Hash;
+	Entry->Index  = Index;
+	Entry->ComparisonIndex = Similar ? Similar->ComparisonIndex : Index;
+	Entry->Length = (uint32)Len;
+	CMemcpy( Entry->Text, Str, Len);
+	Entry->Text[Len] = '\0';
+	NameChunks[Chunk][Index & (NAME_CHUNK_SIZE-1)] = Entry;
+	NameCount = Index + 1;
+	return Entry;
+}
+
+static FORCEINLINE const CNameEntry* GetEntry( int32 Index)
+{
+	return Index ? NameChunks[Index >> NAME_CHUNK_SHIFT][Index & (NAME_CHUNK_SIZE-1)] : &NameNone;
+}
+
+static const CNameEntry* FindOrAddName( const char* Str, size_t Len, ECNameFind Find)
+{
+	if ( !Str || !Len )
+		return &NameNone;
+
+	uint32 Hash = HashName( Str, Len);
+	CNameEntry* volatile* Bucket = &NameHash[Hash & (NAME_HASH_SIZE-1)];
+	CNameEntry* Similar;
+	CNameEntry* Entry = FindEntry( *Bucket, Str, Len, Hash, Similar);
+	if ( Entry )
+		return Entry;
+	if ( Find == CNAME_Find )
+		return Similar ? Similar : &NameNone;
+
+	CSpinLock SL( &NameLock);
+	CNameEntry* First = *Bucket;
+	if ( (Entry=FindEntry( First, Str, Len, Hash, Similar)) != nullptr ) //Added by another thread
+		return Entry;
+	if ( (Entry=AllocateEntry( Str, Len, Hash, Similar)) == nullptr )
+	{
+		DebugCallback( "CName: name table is full", CACUS_CALLBACK_MEMORY);
+		return &NameNone;
+	}
+	Entry->HashNext = First;
+	CPlatformAtomics::InterlockedCompareExchangePointer( (void* volatile*)Bucket, Entry, First);
+	return Entry;
+}
+
+template<typename CHAR> static const CNameEntry* FindOrAddWideName( const CHAR* Str, ECNameFind Find)
+{
+	if ( !Str || !*Str )
+		return &NameNone;
+
+	size_t Len = utf8::EncodedLen( Str);
+	if ( Len == 0 )
+		return &NameNone;
+	size_t BufferSize = Len + 4; //Encoder requires slack
+	char Buffer[256];
+	CScopeMem Mem( (BufferSize > sizeof(Buffer)) ? BufferSize : 0);
+	char* Text = Mem.GetArray<char>() ? Mem.GetArray<char>() : Buffer;
+	if ( utf8::Encode( Text, BufferSize, Str) )
+		return &NameNone;
+	return FindOrAddName( Text, CStrlen(Text), Find);
+}
+//========= Name table - end ==========//
+
+
+#define SET_NAME_ENTRY(entry) \
+	const CNameEntry* Entry = entry; \
+	Index = Entry->ComparisonIndex; \
+	DisplayIndex = Entry->Index;
+
+CName::CName( const char* Str, ECNameFind Find)
+{
+	SET_NAME_ENTRY( FindOrAddName( Str, Str ? CStrlen(Str) : 0, Find) );
+}
+
+CName::CName( const char* Str, size_t Len, ECNameFind Find)
+{
+	SET_NAME_ENTRY( FindOrAddName( Str, Len, Find) );
+}
+
+CName::CName( const char16* Str, ECNameFind Find)
+{
+	SET_NAME_ENTRY( FindOrAddWideName( Str, Find) );
+}
+
+CName::CName( const char32* Str, ECNameFind Find)
+{
+	SET_NAME_ENTRY( FindOrAddWideName( Str, Find) );
+}
+
+#undef SET_NAME_ENTRY
+
+const char* CName::operator*() const
+{
+	return GetEntry(DisplayIndex)->Text;
+}
+
+size_t CName::Len() const
+{
+	return GetEntry(DisplayIndex)->Length;
+}
+
+uint32 CName::Hash() const
+{
+	return GetEntry(DisplayIndex)->Hash;
+}
+
+int32 CName::Count()
+{
+	return NameCount;
+}
@@ -1,6 +1,9 @@
 
 #include <cstdarg>
 #include <wchar.h>
+#include <math.h>
+#include <locale.h>
+#include <stdlib.h>
 
 #include "CacusLibPrivate.h"
 
@@ -648,3 +651,515 @@ template<typename CHAR> inline CHAR* templ_extract_line( const CHAR*& Pos)
 char*   ExtractLine8 (const char  *& Pos) { return templ_extract_line(Pos); }
 char16* ExtractLine16(const char16*& Pos) { return templ_extract_line(Pos); }
 char32* ExtractLine32(const char32*& Pos) { return templ_extract_line(Pos); }
+
+
+
+/* ==============================================
+NUMBER CONVERSION
+
+Locale independent, the decimal separator is always a dot.
+Floats are written with the fewest digits that read back as the same
+value (Ryu, Ulf Adams 2018), in plain notation if the decimal point is
+within 21 digits and in exponent notation otherwise.
+Float parsing computes exactly rounded results with float or double
+arithmetic when digits and exponent are small enough, other values are
+handed to strtof.
+*/
+
+// Writes Value backwards ending at End, returns start of text
+static FORCEINLINE char* WriteDigitsBackwards( char* End, uint32 Value)
+{
+	do
+	{
+		*--End = (char)('0' + Value % 10);
+		Value /= 10;
+	} while ( Value );
+	return End;
+}
+
+size_t CFormatUInt32( char* Out, uint32 Value)
+{
+	char Buffer[12];
+	char* Start = WriteDigitsBackwards( Buffer + sizeof(Buffer), Value);
+	size_t Len = Buffer + sizeof(Buffer) - Start;
+	CMemcpy( Out, Start, Len);
+	Out[Len] = '\0';
+	return Len;
+}
+
+size_t CFormatInt32( char* Out, int32 Value)
+{
+	if ( Value < 0 )
+	{
+		*Out = '-';
+		return CFormatUInt32( Out + 1, 0u - (uint32)Value) + 1;
+	}
+	return CFormatUInt32( Out, (uint32)Value);
+}
+
+// floor(2^(Pow5Bits(i)-1+59) / 5^i) + 1
+static const uint64 FLOAT_POW5_INV_SPLIT[31] =
+{
+	0x0800000000000001ULL, 0x0666666666666667ULL, 0x051EB851EB851EB9ULL, 0x04189374BC6A7EFAULL,
+	0x068DB8BAC710CB2AULL, 0x053E2D6238DA3C22ULL, 0x0431BDE82D7B634EULL, 0x06B5FCA6AF2BD216ULL,
+	0x055E63B88C230E78ULL, 0x044B82FA09B5A52DULL, 0x06DF37F675EF6EAEULL, 0x057F5FF85E592558ULL,
+	0x0465E6604B7A8447ULL, 0x0709709A125DA071ULL, 0x05A126E1A84AE6C1ULL, 0x0480EBE7B9D58567ULL,
+	0x0734ACA5F6226F0BULL, 0x05C3BD5191B525A3ULL, 0x049C97747490EAE9ULL, 0x0760F253EDB4AB0EULL,
+	0x05E72843249088D8ULL, 0x04B8ED0283A6D3E0ULL, 0x078E480405D7B966ULL, 0x060B6CD004AC9452ULL,
+	0x04D5F0A66A23A9DBULL, 0x07BCB43D769F762BULL, 0x063090312BB2C4EFULL, 0x04F3A68DBC8F03F3ULL,
+	0x07EC3DAF94180651ULL, 0x065697BFA9ACD1DAULL, 0x051212FFBAF0A7E2ULL
+};
+
+// 5^i normalized to 61 bits
+static const uint64 FLOAT_POW5_SPLIT[47] =
+{
+	0x1000000000000000ULL, 0x1400000000000000ULL, 0x1900000000000000ULL, 0x1F40000000000000ULL,
+	0x1388000000000000ULL, 0x186A000000000000ULL, 0x1E84800000000000ULL, 0x1312D00000000000ULL,
+	0x17D7840000000000ULL, 0x1DCD650000000000ULL, 0x12A05F2000000000ULL, 0x174876E800000000ULL,
+	0x1D1A94A200000000ULL, 0x12309CE540000000ULL, 0x16BCC41E90000000ULL, 0x1C6BF52634000000ULL,
+	0x11C37937E0800000ULL, 0x16345785D8A00000ULL, 0x1BC16D674EC80000ULL, 0x1158E460913D0000ULL,
+	0x15AF1D78B58C4000ULL, 0x1B1AE4D6E2EF5000ULL, 0x10F0CF064DD59200ULL, 0x152D02C7E14AF680ULL,
+	0x1A784379D99DB420ULL, 0x108B2A2C28029094ULL, 0x14ADF4B7320334B9ULL, 0x19D971E4FE8401E7ULL,
+	0x1027E72F1F128130ULL, 0x1431E0FAE6D7217CULL, 0x193E5939A08CE9DBULL, 0x1F8DEF8808B02452ULL,
+	0x13B8B5B5056E16B3ULL, 0x18A6E32246C99C60ULL, 0x1ED09BEAD87C0378ULL, 0x13426172C74D822BULL,
+	0x1812F9CF7920E2B6ULL, 0x1E17B84357691B64ULL, 0x12CED32A16A1B11EULL, 0x178287F49C4A1D66ULL,
+	0x1D6329F1C35CA4BFULL, 0x125DFA371A19E6F7ULL, 0x16F578C4E0A060B5ULL, 0x1CB2D6F618C878E3ULL,
+	0x11EFC659CF7D4B8DULL, 0x166BB7F0435C9E71ULL, 0x1C06A5EC5433C60DULL
+};
+
+#define FLOAT_POW5_INV_BITCOUNT 59
+#define FLOAT_POW5_BITCOUNT 61
+
+static FORCEINLINE int32 Pow5Bits( int32 e)      { return (int32)(((uint32)e * 1217359) >> 19) + 1; } //ceil(log2(5^e))
+static FORCEINLINE uint32 Log10Pow2( int32 e)    { return ((uint32)e * 78913) >> 18; } //floor(log10(2^e))
+static FORCEINLINE uint32 Log10Pow5( int32 e)    { return ((uint32)e * 732923) >> 20; } //floor(log10(5^e))
+
+static FORCEINLINE bool MultipleOfPowerOf5( uint32 Value, uint32 p)
+{
+	uint32 Count = 0;
+	for ( ; Value % 5 == 0 ; Value /= 5 )
+		Count++;
+	return Count >= p;
+}
+
+static FORCEINLINE bool MultipleOfPowerOf2( uint32 Value, uint32 p)
+{
+	return (Value & ((1u << p) - 1)) == 0;
+}
+
+static FORCEINLINE uint32 MulShift( uint32 m, uint64 Factor, int32 Shift)
+{
+	uint64 Bits0 = (uint64)m * (uint32)Factor;
+	uint64 Bits1 = (uint64)m * (uint32)(Factor >> 32);
+	return (uint32)(((Bits0 >> 32) + Bits1) >> (Shift - 32));
+}
+
+// Shortest Digits * 10^Exponent that lies inside the rounding interval of the float
+static void FloatToDecimal( uint32 IeeeMantissa, uint32 IeeeExponent, uint32& Digits, int32& Exponent)
+{
+	int32 e2;
+	uint32 m2;
+	if ( IeeeExponent == 0 )
+	{
+		e2 = 1 - 127 - 23 - 2;
+		m2 = IeeeMantissa;
+	}
+	else
+	{
+		e2 = (int32)IeeeExponent - 127 - 23 - 2;
+		m2 = (1u << 23) | IeeeMantissa;
+	}
+	bool bAcceptBounds = (m2 & 1) == 0;
+
+	// Value and halfway points to the neighbours
+	uint32 mv = 4 * m2;
+	uint32 mp = 4 * m2 + 2;
+	uint32 mmShift = (IeeeMantissa != 0) || (IeeeExponent <= 1);
+	uint32 mm = 4 * m2 - 1 - mmShift;
+
+	// Convert to decimal power base
+	uint32 vr, vp, vm;
+	int32 e10;
+	bool bVmTrailingZeros = false;
+	bool bVrTrailingZeros = false;
+	uint8 LastRemovedDigit = 0;
+	if ( e2 >= 0 )
+	{
+		uint32 q = Log10Pow2( e2);
+		e10 = (int32)q;
+		int32 k = FLOAT_POW5_INV_BITCOUNT + Pow5Bits( (int32)q) - 1;
+		int32 i = -e2 + (int32)q + k;
+		vr = MulShift( mv, FLOAT_POW5_INV_SPLIT[q], i);
+		vp = MulShift( mp, FLOAT_POW5_INV_SPLIT[q], i);
+		vm = MulShift( mm, FLOAT_POW5_INV_SPLIT[q], i);
+		if ( q != 0 && (vp - 1) / 10 <= vm / 10 )
+		{
+			int32 l = FLOAT_POW5_INV_BITCOUNT + Pow5Bits( (int32)(q - 1)) - 1;
+			LastRemovedDigit = (uint8)(MulShift( mv, FLOAT_POW5_INV_SPLIT[q-1], -e2 + (int32)q - 1 + l) % 10);
+		}
+		if ( q <= 9 )
+		{
+			if ( mv % 5 == 0 )
+				bVrTrailingZeros = MultipleOfPowerOf5( mv, q);
+			else if ( bAcceptBounds )
+				bVmTrailingZeros = MultipleOfPowerOf5( mm, q);
+			else
+				vp -= MultipleOfPowerOf5( mp, q);
+		}
+	}
+	else
+	{
+		uint32 q = Log10Pow5( -e2);
+		e10 = (int32)q + e2;
+		int32 i = -e2 - (int32)q;
+		int32 k = Pow5Bits( i) - FLOAT_POW5_BITCOUNT;
+		int32 j = (int32)q - k;
+		vr = MulShift( mv, FLOAT_POW5_SPLIT[i], j);
+		vp = MulShift( mp, FLOAT_POW5_SPLIT[i], j);
+		vm = MulShift( mm, FLOAT_POW5_SPLIT[i], j);
+		if ( q != 0 && (vp - 1) / 10 <= vm / 10 )
+		{
+			j = (int32)q - 1 - (Pow5Bits( i + 1) - FLOAT_POW5_BITCOUNT);
+			LastRemovedDigit = (uint8)(MulShift( mv, FLOAT_POW5_SPLIT[i+1], j) % 10);
+		}
+		if ( q <= 1 )
+		{
+			bVrTrailingZeros = true;
+			if ( bAcceptBounds )
+				bVmTrailingZeros = (mmShift == 1);
+			else
+				vp--;
+		}
+		else if ( q < 31 )
+			bVrTrailingZeros = MultipleOfPowerOf2( mv, q - 1);
+	}
+
+	// Remove digits while the interval allows it
+	int32 Removed = 0;
+	if ( bVmTrailingZeros || bVrTrailingZeros )
+	{
+		while ( vp / 10 > vm / 10 )
+		{
+			bVmTrailingZeros &= (vm % 10 == 0);
+			bVrTrailingZeros &= (LastRemovedDigit == 0);
+			LastRemovedDigit = (uint8)(vr % 10);
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			Removed++;
+		}
+		if ( bVmTrailingZeros )
+			while ( vm % 10 == 0 )
+			{
+				bVrTrailingZeros &= (LastRemovedDigit == 0);
+				LastRemovedDigit = (uint8)(vr % 10);
+				vr /= 10;
+				vp /= 10;
+				vm /= 10;
+				Removed++;
+			}
+		if ( bVrTrailingZeros && LastRemovedDigit == 5 && vr % 2 == 0 ) //Round to even
+			LastRemovedDigit = 4;
+		Digits = vr + (uint32)((vr == vm && (!bAcceptBounds || !bVmTrailingZeros)) || LastRemovedDigit >= 5);
+	}
+	else
+	{
+		while ( vp / 10 > vm / 10 )
+		{
+			LastRemovedDigit = (uint8)(vr % 10);
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			Removed++;
+		}
+		Digits = vr + (uint32)(vr == vm || LastRemovedDigit >= 5);
+	}
+	Exponent = e10 + Removed;
+}
+
+size_t CFormatFloat( char* Out, float Value)
+{
+	uint32 Bits;
+	CMemcpy( &Bits, &Value, sizeof(Bits));
+	uint32 IeeeMantissa = Bits & ((1u << 23) - 1);
+	uint32 IeeeExponent = (Bits >> 23) & 0xFF;
+	char* Pos = Out;
+	if ( IeeeExponent == 0xFF && IeeeMantissa )
+	{
+		CMemcpy( Out, "nan", 4);
+		return 3;
+	}
+	if ( Bits >> 31 )
+		*Pos++ = '-';
+	if ( IeeeExponent == 0xFF )
+	{
+		CMemcpy( Pos, "inf", 4);
+		return Pos + 3 - Out;
+	}
+	if ( !IeeeExponent && !IeeeMantissa )
+	{
+		CMemcpy( Pos, "0", 2);
+		return Pos + 1 - Out;
+	}
+
+	uint32 Digits;
+	int32 Exponent;
+	FloatToDecimal( IeeeMantissa, IeeeExponent, Digits, Exponent);
+	char Buffer[12];
+	char* DigitText = WriteDigitsBackwards( Buffer + sizeof(Buffer), Digits);
+	int32 DigitCount = (int32)(Buffer + sizeof(Buffer) - DigitText);
+	int32 Point = DigitCount + Exponent; //Digits before the decimal point
+
+	if ( DigitCount <= Point && Point <= 21 ) //1500
+	{
+		CMemcpy( Pos, DigitText, DigitCount);
+		Pos += DigitCount;
+		for ( int32 i=DigitCount ; i<Point ; i++ )
+			*Pos++ = '0';
+	}
+	else if ( 0 < Point && Point <= 21 ) //1.5
+	{
+		CMemcpy( Pos, DigitText, Point);
+		Pos += Point;
+		*Pos++ = '.';
+		CMemcpy( Pos, DigitText + Point, DigitCount - Point);
+		Pos += DigitCount - Point;
+	}
+	else if ( -6 < Point && Point <= 0 ) //0.0015
+	{
+		*Pos++ = '0';
+		*Pos++ = '.';
+		for ( int32 i=Point ; i<0 ; i++ )
+			*Pos++ = '0';
+		CMemcpy( Pos, DigitText, DigitCount);
+		Pos += DigitCount;
+	}
+	else //1.5e+30
+	{
+		*Pos++ = DigitText[0];
+		if ( DigitCount > 1 )
+		{
+			*Pos++ = '.';
+			CMemcpy( Pos, DigitText + 1, DigitCount - 1);
+			Pos += DigitCount - 1;
+		}
+		*Pos++ = 'e';
+		*Pos++ = (Point > 0) ? '+' : '-';
+		Pos += CFormatUInt32( Pos, (Point > 0) ? (uint32)(Point - 1) : (uint32)(1 - Point));
+	}
+	*Pos = '\0';
+	return Pos - Out;
+}
+
+
+static FORCEINLINE const char* SkipSpaces( const char* Str)
+{
+	while ( *Str == ' ' || (uint32)(*Str - '\t') <= '\r' - '\t' )
+		Str++;
+	return Str;
+}
+
+static FORCEINLINE bool IsDigit( char C)
+{
+	return (uint32)(C - '0') < 10;
+}
+
+static FORCEINLINE bool IsHexDigit( char C)
+{
+	return IsDigit( C) || (uint32)((C | 0x20) - 'a') < 6;
+}
+
+size_t CParseInt32( const char* Str, int32* Value)
+{
+	const char* Pos = SkipSpaces( Str);
+	bool bNegative = (*Pos == '-');
+	if ( *Pos == '-' || *Pos == '+' )
+		Pos++;
+	const char* Digits = Pos;
+	uint64 Result = 0;
+	for ( ; IsDigit( *Pos) ; Pos++ )
+		Result = Min<uint64>( Result * 10 + (*Pos - '0'), 0x80000000ULL); //Saturate
+	if ( Pos == Digits )
+	{
+		*Value = 0;
+		return 0;
+	}
+	if ( bNegative )
+		*Value = (int32)(0u - (uint32)Result);
+	else
+		*Value = (int32)Min<uint64>( Result, 0x7FFFFFFF);
+	return Pos - Str;
+}
+
+size_t CParseUInt32( const char* Str, uint32* Value)
+{
+	const char* Pos = SkipSpaces( Str);
+	bool bNegative = (*Pos == '-');
+	if ( *Pos == '-' || *Pos == '+' )
+		Pos++;
+	const char* Digits = Pos;
+	uint64 Result = 0;
+	if ( Pos[0] == '0' && (Pos[1] | 0x20) == 'x' && IsHexDigit( Pos[2]) )
+	{
+		for ( Pos+=2 ; IsHexDigit( *Pos) ; Pos++ )
+			Result = Min<uint64>( (Result << 4) | (IsDigit( *Pos) ? (*Pos - '0') : ((*Pos | 0x20) - 'a' + 10)), 0xFFFFFFFFULL);
+	}
+	else if ( Pos[0] == '0' ) //Octal, like strtoul base 0
+	{
+		for ( Pos++ ; (uint32)(*Pos - '0') < 8 ; Pos++ )
+			Result = Min<uint64>( (Result << 3) | (*Pos - '0'), 0xFFFFFFFFULL);
+	}
+	else
+		for ( ; IsDigit( *Pos) ; Pos++ )
+			Result = Min<uint64>( Result * 10 + (*Pos - '0'), 0xFFFFFFFFULL);
+	if ( Pos == Digits )
+	{
+		*Value = 0;
+		return 0;
+	}
+	*Value = bNegative ? (0u - (uint32)Result) : (uint32)Result;
+	return Pos - Str;
+}
+
+static const float FloatPowersOf10[] =
+{
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static const double DoublePowersOf10[] =
+{
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Case insensitive match of a lower case word
+static FORCEINLINE bool MatchWord( const char* Str, const char* Word)
+{
+	for ( ; *Word ; Str++, Word++ )
+		if ( (*Str | 0x20) != *Word )
+			return false;
+	return true;
+}
+
+//
+// Clinger's fast path: a mantissa and power of ten that are both exactly
+// representable give an exactly rounded product or quotient.
+// Float arithmetic covers mantissas up to 2^24 and powers up to 10^10,
+// double arithmetic covers 2^53 and 10^22 but the conversion to float
+// rounds twice, so results that land on a float halfway point are
+// redone by strtof.
+//
+size_t CParseFloat( const char* Str, float* Value)
+{
+	const char* Pos = SkipSpaces( Str);
+	bool bNegative = (*Pos == '-');
+	if ( *Pos == '-' || *Pos == '+' )
+		Pos++;
+
+	if ( MatchWord( Pos, "inf") || MatchWord( Pos, "nan") )
+	{
+		bool bNaN = (*Pos | 0x20) == 'n';
+		Pos += MatchWord( Pos, "infinity") ? 8 : 3;
+		*Value = bNaN ? NAN : (bNegative ? -INFINITY : INFINITY);
+		return Pos - Str;
+	}
+
+	// Up to 19 significant digits go into the mantissa
+	uint64 Mantissa = 0;
+	int32 SignificantDigits = 0;
+	int32 Exponent = 0;
+	bool bTruncated = false;
+	const char* Digits = Pos;
+	for ( ; IsDigit( *Pos) ; Pos++ )
+	{
+		if ( SignificantDigits < 19 )
+		{
+			Mantissa = Mantissa * 10 + (*Pos - '0');
+			SignificantDigits += (Mantissa != 0);
+		}
+		else
+		{
+			Exponent++;
+			bTruncated |= (*Pos != '0');
+		}
+	}
+	size_t DigitCount = Pos - Digits;
+	if ( *Pos == '.' )
+	{
+		for ( Digits=++Pos ; IsDigit( *Pos) ; Pos++ )
+			if ( SignificantDigits < 19 )
+			{
+				Mantissa = Mantissa * 10 + (*Pos - '0');
+				SignificantDigits += (Mantissa != 0);
+				Exponent--;
+			}
+			else
+				bTruncated |= (*Pos != '0');
+		DigitCount += Pos - Digits;
+	}
+	if ( !DigitCount )
+	{
+		*Value = 0;
+		return 0;
+	}
+	const char* End = Pos;
+	if ( (*Pos | 0x20) == 'e' )
+	{
+		const char* ExpPos = Pos + 1;
+		bool bNegativeExp = (*ExpPos == '-');
+		if ( *ExpPos == '-' || *ExpPos == '+' )
+			ExpPos++;
+		if ( IsDigit( *ExpPos) )
+		{
+			int32 ExpValue = 0;
+			for ( ; IsDigit( *ExpPos) ; ExpPos++ )
+				ExpValue = Min<int32>( ExpValue * 10 + (*ExpPos - '0'), 100000);
+			Exponent += bNegativeExp ? -ExpValue : ExpValue;
+			End = ExpPos;
+		}
+	}
+
+	float Result;
+	if ( !Mantissa )
+		Result = 0.0f;
+	else if ( !bTruncated && Mantissa <= (1u << 24) && Exponent >= -10 && Exponent <= 10 )
+	{
+		Result = (float)Mantissa;
+		Result = (Exponent < 0) ? (Result / FloatPowersOf10[-Exponent]) : (Result * FloatPowersOf10[Exponent]);
+	}
+	else
+	{
+		double Double = 0;
+		bool bExact = !bTruncated && Mantissa <= (1ULL << 53) && Exponent >= -22 && Exponent <= 22;
+		if ( bExact )
+		{
+			Double = (double)Mantissa;
+			Double = (Exponent < 0) ? (Double / DoublePowersOf10[-Exponent]) : (Double * DoublePowersOf10[Exponent]);
+			uint64 Bits;
+			CMemcpy( &Bits, &Double, sizeof(Bits));
+			bExact = (Bits & 0x1FFFFFFF) != 0x10000000; //Halfway between floats
+		}
+		if ( bExact )
+			Result = (float)Double;
+		else
+		{
+			const char* Text = Str;
+			char DecimalPoint = *localeconv()->decimal_point;
+			if ( DecimalPoint != '.' ) //Rewrite with the locale's decimal separator
+			{
+				size_t Len = End - Str;
+				char* Buffer = CharBuffer<char>( Len + 1);
+				CMemcpy( Buffer, Str, Len);
+				Buffer[Len] = '\0';
+				char* Dot = CStrchr( Buffer, '.');
+				if ( Dot )
+					*Dot = DecimalPoint;
+				Text = Buffer;
+			}
+			Result = strtof( Text, nullptr);
+			bNegative = false;
+		}
+	}
+	*Value = bNegative ? -Result : Result;
+	return End - Str;
+}
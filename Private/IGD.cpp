@@ -25,9 +25,11 @@ https://datatracker.ietf.org/doc/html/rfc6970
 #include "NetUtils/CacusHTTP.h"
 
 #include "Parser/Line.h"
-#include "Parser/UTF.h"
 #include "Parser/XML.h"
 
+// Move semantics
+#include <utility>
+
 #include "IGD_TEST.h"
 #include <stdio.h>
 
@@ -86,7 +88,7 @@ struct UpnpRouterSession
 	CParserFastLine8 SSDP_Response;
 	URI RootDescURI;
 	IPEndpoint RootDescEndpoint;
-	CParserUTF RootDescFile;
+	CScopeMem RootDescFile; // Null terminated UTF-8
 
 	bool ResolveLocalAddress();
 	bool GetDeviceRootDescLocation();
@@ -170,9 +172,8 @@ bool UpnpRouterSession::DownloadRootDesc()
 	CacusHTTP Browser;
 	if ( Browser.Browse(*RootDescURI) )
 	{
-		// File cannot be decoded
-		if ( !RootDescFile.Parse(Browser.ResponseData.GetData()) )
-			return false;
+		// Parsed as received, no wide char conversion
+		RootDescFile = std::move(Browser.ResponseData);
 		return true;
 	}
 	return false;
@@ -201,23 +202,26 @@ bool SetUpnpPort( int Port, bool Enable)
 		return false;
 	}
 
+	// Root descriptors are a few KB, a broken or hostile device shouldn't make us allocate more
+	static const CParserFastXML::CLimits RootDescLimits = { 32, 4096, 4096, 1024*1024 };
 	CParserFastXML XMLParser;
-	if ( !XMLParser.Parse(Session.RootDescFile.Output) )
+	XMLParser.SetLimits(RootDescLimits);
+	if ( !XMLParser.Parse(Session.RootDescFile.GetArray<char>()) )
 	{
 		DebugCallback("Unable to parse UPnP Root device descriptor", CACUS_CALLBACK_TEST);
 		return false;
 	}
 
-	auto Browser = XMLParser.CreateBrowser();
-	if ( Browser.Start(L"root") && Browser.Down(L"device") && Browser.Down(L"serviceList") && Browser.Down(L"service") )
+	auto Browser = XMLParser.CreateBrowser<char>();
+	if ( Browser.Start("root") && Browser.Down("device") && Browser.Down("serviceList") && Browser.Down("service") )
 	{
 		do
 		{
-			wprintf(L"Found service %s in root device\r\n", *Browser);
-		} while ( Browser.Next(L"service") );
+			printf("Found service %s in root device\r\n", *Browser);
+		} while ( Browser.Next("service") );
 	}
 
-//	wprintf(L"RootDesc: \n%s\n", Session.RootDescFile.Output);
+//	printf("RootDesc: \n%s\n", Session.RootDescFile.GetArray<char>());
 	
 
 
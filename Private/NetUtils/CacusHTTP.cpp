@@ -26,69 +26,6 @@ CacusHTTP::CacusHTTP()
 {
 }
 
-//========= ParseResponse() - begin ==========//
-//
-// Private functionality of CacusHTTP browser.
-// 
-// (char*) Headers       - Null-terminated header text.
-// (bool)  Return value  - Header parsed and valid.
-//
-static bool ParseResponse( CacusHTTP& Browser, const char* Headers)
-{
-	CParserFastLine8 HeaderLines;
-
-	// Parse lines up to empty line
-	if ( HeaderLines.Parse(Headers) )
-	{
-		Browser.ContentLength = 0;
-
-		for ( const char** Line=HeaderLines.GetLineArray(); *Line; Line++)
-		{
-			if ( !Browser.ContentLength && !CStrnicmp(*Line,"Content-Length: ") )
-				Browser.ContentLength = atoi(*Line + _len("Content-Length: "));
-		}
-		return (Browser.ContentLength > 0);
-	}
-	return false;
-}
-//========= ParseResponse() - end ==========//
-
-
-//========= SplitContent() - begin ==========//
-//
-// Finds the empty line and replaces the second line terminator
-// with null terminators.
-// 
-// (char*) Buffer        - Raw buffer.
-// (int32) Offset        - Optional search offset.
-// (int32) Return value  - Position of Content.
-//
-static int32 SplitContent( const char* Buffer, int32 Offset)
-{
-	const char* SearchStart = Buffer + Offset;
-
-	// Attempt to process header everytime data is received
-	char* EmptyRN = CStrstr(Buffer, "\r\n\r\n");
-	char* EmptyN  = CStrstr(Buffer, "\n\n");
-
-	if ( EmptyRN && (!EmptyN || EmptyN>EmptyRN) )
-	{
-		EmptyRN[2] = '\0';
-		EmptyRN[3] = '\0';
-		return (int32)(EmptyRN - Buffer) + 4;
-	}
-
-	if ( EmptyN && (!EmptyRN || EmptyRN>EmptyN) )
-	{
-		EmptyN[1] = '\0';
-		return (int32)(EmptyN - Buffer) + 2;
-	}
-
-	return 0;
-}
-//========= SplitContent() - end ==========//
-
-
 bool CacusHTTP::Browse( const char* BrowseURI)
 {
 	// Once URI is validated, object state will be overwritten
@@ -146,6 +83,11 @@ bool CacusHTTP::Browse( const char* BrowseURI)
 		ResponseHeaderData.Resize(BufferSize + EALIGN_PLATFORM_PTR);
 		uint8* Buffer = ResponseHeaderData.GetArray<uint8>();
 
+		// Header lines are processed as they arrive, the received text isn't rescanned
+		CParserStreamLine8 HeaderLines;
+		const char* Line;
+		size_t Len;
+
 		while ( !ContentStart && (TotalRead < BufferSize) )
 		{
 			if ( Socket.Recv( Buffer+TotalRead, BufferSize-TotalRead, Read) )
@@ -154,14 +96,30 @@ bool CacusHTTP::Browse( const char* BrowseURI)
 				if ( Read == 0 ) //Shutdown
 					break;
 
+				HeaderLines.Feed( (char*)Buffer+TotalRead, Read);
 				TotalRead += Read;
 				Buffer[TotalRead] = 0;
 
-				if ( (ContentStart=SplitContent((char*)Buffer,0)) != 0 )
+				while ( HeaderLines.Next(Line, Len) )
+				{
+					if ( !Len ) //Empty line, content follows
+					{
+						ContentStart = TotalRead - (int32)HeaderLines.GetBufferedLen();
+						break;
+					}
+					if ( !ContentLength && (Len > _len("Content-Length: ")) && !CStrnicmp(Line,"Content-Length: ") )
+						ContentLength = atoi(Line + _len("Content-Length: "));
+				}
+
+				// Here the double end line has already been found
+				// Meaning that failure to parse the header is fatal.
+				if ( ContentStart )
 				{
-					// Here the double end line has already been found
-					// Meaning that failure to parse the header is fatal.
-					if ( ParseResponse(*this, (char*)Buffer) )
+					// Keep header text null terminated
+					Buffer[ContentStart-1] = 0;
+					if ( (ContentStart >= 2) && (Buffer[ContentStart-2] == '\r') )
+						Buffer[ContentStart-2] = 0;
+					if ( ContentLength > 0 )
 						break;
 					return false;
 				}
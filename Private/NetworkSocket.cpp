@@ -16,6 +16,7 @@
 	#define MSG_NOSIGNAL		0
 	#undef gai_strerror
 	#define gai_strerror gai_strerrorA
+	#define poll WSAPoll
 #else
 // BSD socket includes.
 	#define __BSD_SOCKETS__ 1
@@ -29,6 +30,11 @@
 	#include <netdb.h>
 	#include <errno.h>
 	#include <fcntl.h>
+	#include <poll.h>
+	#if __linux__
+		#include <sys/epoll.h>
+		#define USES_EPOLL 1
+	#endif
 
 	#ifndef MSG_NOSIGNAL
 		#define MSG_NOSIGNAL 0x4000
@@ -42,6 +48,7 @@
 #include "NetworkSocket.h"
 #include "AppTime.h"
 #include "Atomics.h"
+#include "CacusTemplate.h"
 #include "Math/Math.h"
 
 
@@ -49,6 +56,7 @@
 #if _UNIX || _unix
 	#define INVALID_SOCKET      -1
 	#define SOCKET_ERROR        -1
+	#define WSAEINTR            EINTR
 
 /*	#define ECONNREFUSED        111
 	#define EAGAIN              11*/
@@ -205,12 +213,59 @@ bool SocketGeneric::RecvFrom( uint8* Data, int32 BufferSize, int32& BytesRead, I
 	return BytesRead >= 0;
 }
 
-bool SocketGeneric::Poll()
+static uint32 ToNativePoll( uint32 Flags)
 {
-//	pollfd pfd;
-	// TODO: Implement
-	return false;
+	return ((Flags & SOCKET_PollRead)  ? POLLIN  : 0)
+		|  ((Flags & SOCKET_PollWrite) ? POLLOUT : 0);
+}
+
+static uint32 FromNativePoll( uint32 Native)
+{
+	return ((Native & POLLIN)                     ? SOCKET_PollRead  : 0)
+		|  ((Native & POLLOUT)                    ? SOCKET_PollWrite : 0)
+		|  ((Native & (POLLERR|POLLHUP|POLLNVAL)) ? SOCKET_PollError : 0);
+}
+
+//========= SocketGeneric::Poll - begin ==========//
+//
+// Single descriptor poll, no descriptor limit (unlike FD_SET).
+// Timeouts are nanosecond precise with ppoll, millisecond (rounded up)
+// otherwise. Interrupted waits resume with the remaining time.
+//
+uint32 SocketGeneric::Poll( uint32 PollFlags, double WaitTime)
+{
+	pollfd Native;
+	Native.fd      = (SOCKET)SocketDescriptor;
+	Native.events  = (short)ToNativePoll( PollFlags);
+	Native.revents = 0;
+
+	double EndTime = FPlatformTime::Seconds() + WaitTime;
+	int Status;
+	while ( true )
+	{
+#if __linux__
+		timespec Time;
+		Time.tv_sec  = (time_t)WaitTime;
+		Time.tv_nsec = (long)((WaitTime - (double)Time.tv_sec) * 1000000000.0);
+		Status = ppoll( &Native, 1, (WaitTime < 0) ? nullptr : &Time, nullptr);
+#else
+		Status = poll( &Native, 1, (WaitTime < 0) ? -1 : (int)(WaitTime * 1000.0 + 0.999));
+#endif
+		if ( (Status != Error) || (CSocket::ErrorCode() != WSAEINTR) )
+			break;
+		if ( WaitTime > 0 )
+			WaitTime = Max( EndTime - FPlatformTime::Seconds(), 0.0);
+	}
+
+	if ( Status == Error )
+	{
+		LastError = CSocket::ErrorCode();
+		return SOCKET_PollError;
+	}
+	LastError = 0;
+	return (Status > 0) ? FromNativePoll( Native.revents) : 0;
 }
+//========= SocketGeneric::Poll - end ==========//
 
 bool SocketGeneric::Listen( int32 Backlog)
 {
@@ -291,63 +346,21 @@ uint16 SocketGeneric::BindPort( IPEndpoint& LocalAddress, int NumTries, int Incr
 	return 0;
 }
 
+//
+// Returns CheckFor if ready, SOCKET_HasError if the socket has an error
+// (or the poll failed) and SOCKET_Timeout otherwise.
+//
 ESocketState SocketGeneric::CheckState( ESocketState CheckFor, double WaitTime)
 {
-	fd_set SocketSet;
-	timeval Time;
+	static const uint32 CheckFlags[SOCKET_MAX] = { 0, SOCKET_PollRead, SOCKET_PollWrite, 0 };
 
-	int Status = 0;
-	while ( (WaitTime >= 0) && (Status == 0) )
-	{
-		double StartTime = FPlatformTime::InitTiming();
-		Time.tv_sec = CFloor(WaitTime);
-		Time.tv_usec = CFloor((WaitTime - (double)Time.tv_sec) * 1000.0 * 1000.0);
-		FD_ZERO(&SocketSet);
-		FD_SET( ((SOCKET)SocketDescriptor), &SocketSet);
-
-		int BSDCompat = (int)SocketDescriptor + 1;
-		if      ( CheckFor == SOCKET_Readable ) Status = select(BSDCompat, &SocketSet, nullptr, nullptr, &Time);
-		else if ( CheckFor == SOCKET_Writable ) Status = select(BSDCompat, nullptr, &SocketSet, nullptr, &Time);
-		else if ( CheckFor == SOCKET_HasError ) Status = select(BSDCompat, nullptr, nullptr, &SocketSet, &Time);
-		LastError = Status;
-
-		if ( Status == Error )
-			return SOCKET_HasError;
-		else if ( Status == 0 )
-		{
-			if ( WaitTime > 0 ) //Do not spin
-				Sleep(1);
-			WaitTime -= FPlatformTime::Seconds() - StartTime;
-			if ( WaitTime <= 0 ) //Timed out
-				return SOCKET_Timeout;
-		}
-	}
-	return CheckFor;
-}
-
-/*ESocketState SocketGeneric::CheckState( ESocketState CheckFor, double WaitTime)
-{
-	fd_set SocketSet;
-	timeval Time;
-
-	Time.tv_sec = CFloor(WaitTime);
-	Time.tv_usec = CFloor((WaitTime - (double)Time.tv_sec) * 1000.0 * 1000.0);
-	FD_ZERO(&SocketSet);
-	FD_SET( ((SOCKET)SocketDescriptor), &SocketSet);
-
-	int Status = 0;
-	int BSDCompat = (int)SocketDescriptor + 1;
-	if      ( CheckFor == SOCKET_Readable ) Status = select(BSDCompat, &SocketSet, nullptr, nullptr, &Time);
-	else if ( CheckFor == SOCKET_Writable ) Status = select(BSDCompat, nullptr, &SocketSet, nullptr, &Time);
-	else if ( CheckFor == SOCKET_HasError ) Status = select(BSDCompat, nullptr, nullptr, &SocketSet, &Time);
-	LastError = Status;
-
-	if ( Status == Error )
+	uint32 Ready = Poll( CheckFlags[CheckFor], Max( WaitTime, 0.0));
+	if ( Ready & CheckFlags[CheckFor] )
+		return CheckFor;
+	if ( Ready & SOCKET_PollError )
 		return SOCKET_HasError;
-	else if ( Status == 0 )
-		return SOCKET_Timeout;
-	return CheckFor;
-}*/
+	return SOCKET_Timeout;
+}
 
 /*----------------------------------------------------------------------------
 	Windows socket.
@@ -488,40 +501,6 @@ inline bool SocketWindows::IsNonBlocking( int32 Code)
 	return (Code == WSAEWOULDBLOCK) || (Code == WSAEINPROGRESS);
 }
 
-ESocketState SocketWindows::CheckState( ESocketState CheckFor, double WaitTime)
-{
-	fd_set SocketSet;
-	timeval Time;
-
-	int Status = 0;
-	while ( (WaitTime >= 0) && (Status == 0) )
-	{
-		double StartTime = FPlatformTime::Seconds();
-		Time.tv_sec = CFloor(WaitTime);
-		Time.tv_usec = CFloor((WaitTime - (double)Time.tv_sec) * 1000.0 * 1000.0);
-		FD_ZERO(&SocketSet);
-		FD_SET( ((SOCKET)SocketDescriptor), &SocketSet);
-
-		int BSDCompat = (int)SocketDescriptor + 1;
-		if      ( CheckFor == SOCKET_Readable ) Status = select(BSDCompat, &SocketSet, nullptr, nullptr, &Time);
-		else if ( CheckFor == SOCKET_Writable ) Status = select(BSDCompat, nullptr, &SocketSet, nullptr, &Time);
-		else if ( CheckFor == SOCKET_HasError ) Status = select(BSDCompat, nullptr, nullptr, &SocketSet, &Time);
-		LastError = Status;
-
-		if ( Status == Error )
-			return SOCKET_HasError;
-		else if ( Status == 0 )
-		{
-			if ( WaitTime > 0 ) //Do not spin
-				Sleep(1);
-			WaitTime -= FPlatformTime::Seconds() - StartTime;
-			if ( WaitTime <= 0 ) //Timed out
-				return SOCKET_Timeout;
-		}
-	}
-	return CheckFor;
-}
-
 #endif
 /*----------------------------------------------------------------------------
 	Unix socket.
@@ -637,6 +616,253 @@ bool SocketBSD::IsNonBlocking( int32 Code)
 
 #endif
 
+/*----------------------------------------------------------------------------
+	Socket poller.
+----------------------------------------------------------------------------*/
+
+#ifndef USES_EPOLL
+	#define USES_EPOLL 0
+#endif
+
+enum EPollControl
+{
+	POLLCTL_Add,
+	POLLCTL_Modify,
+	POLLCTL_Remove,
+};
+
+#if USES_EPOLL
+static uint32 ToNativeEpoll( uint32 Flags)
+{
+	return ((Flags & SOCKET_PollRead)  ? (uint32)EPOLLIN  : 0)
+		|  ((Flags & SOCKET_PollWrite) ? (uint32)EPOLLOUT : 0)
+		|  ((Flags & SOCKET_PollEdge)  ? (uint32)EPOLLET  : 0);
+}
+
+static uint32 FromNativeEpoll( uint32 Native)
+{
+	return ((Native & EPOLLIN)               ? SOCKET_PollRead  : 0)
+		|  ((Native & EPOLLOUT)              ? SOCKET_PollWrite : 0)
+		|  ((Native & (EPOLLERR|EPOLLHUP))   ? SOCKET_PollError : 0);
+}
+#endif
+
+
+CSocketPoller::CSocketPoller( EVENT_CALLBACK InCallback)
+	: Callback(InCallback)
+	, Handle(SocketGeneric::InvalidSocket)
+	, Entries(nullptr)
+	, PollFDs(nullptr)
+	, EntryCount(0)
+	, EntrySize(0)
+	, FirstFree(-1)
+	, Active(0)
+{
+#if USES_EPOLL
+	Handle = epoll_create1( EPOLL_CLOEXEC);
+	if ( Handle < 0 )
+		DebugCallback( CSprintf("CSocketPoller: epoll_create1 failed (%s)", CSocket::ErrorText()), CACUS_CALLBACK_NET);
+#endif
+}
+
+CSocketPoller::~CSocketPoller()
+{
+#if USES_EPOLL
+	if ( Handle >= 0 )
+		close( Handle);
+#endif
+	if ( Entries )
+		CFree( Entries);
+	if ( PollFDs )
+		CFree( PollFDs);
+}
+
+//========= CSocketPoller::Add - begin ==========//
+//
+// Slots are reused through a free list, the slot index is the event
+// identifier handed to epoll/poll.
+//
+int32 CSocketPoller::Add( CSocket* Socket, uint32 Flags, void* UserData)
+{
+	if ( !Socket || Socket->IsInvalid() )
+		return -1;
+
+	int32 Slot = FirstFree;
+	if ( Slot >= 0 )
+		FirstFree = Entries[Slot].NextFree;
+	else
+	{
+		if ( EntryCount == EntrySize )
+		{
+			int32 NewSize = Max<int32>( EntrySize * 2, 16);
+			Entry* NewEntries = (Entry*)CRealloc( Entries, NewSize * sizeof(Entry));
+			if ( !NewEntries )
+				return -1;
+			Entries = NewEntries;
+#if !USES_EPOLL
+			pollfd* NewPollFDs = (pollfd*)CRealloc( PollFDs, NewSize * sizeof(pollfd));
+			if ( !NewPollFDs )
+				return -1;
+			PollFDs = NewPollFDs;
+#endif
+			EntrySize = NewSize;
+		}
+		Slot = EntryCount++;
+	}
+
+	Entries[Slot].Socket   = Socket;
+	Entries[Slot].UserData = UserData;
+	Entries[Slot].Flags    = Flags;
+	Entries[Slot].NextFree = -1;
+	if ( !Control( POLLCTL_Add, Slot) )
+	{
+		Entries[Slot].Socket   = nullptr;
+		Entries[Slot].NextFree = FirstFree;
+		FirstFree = Slot;
+		return -1;
+	}
+	Active++;
+	return Slot;
+}
+//========= CSocketPoller::Add - end ==========//
+
+bool CSocketPoller::Modify( int32 Slot, uint32 Flags)
+{
+	if ( !IsUsed( Slot) )
+		return false;
+	Entries[Slot].Flags = Flags;
+	return Control( POLLCTL_Modify, Slot);
+}
+
+bool CSocketPoller::Remove( int32 Slot)
+{
+	if ( !IsUsed( Slot) )
+		return false;
+	Control( POLLCTL_Remove, Slot);
+	Entries[Slot].Socket   = nullptr;
+	Entries[Slot].NextFree = FirstFree;
+	FirstFree = Slot;
+	Active--;
+	return true;
+}
+
+bool CSocketPoller::Control( int32 Op, int32 Slot)
+{
+	Entry& Target = Entries[Slot];
+#if USES_EPOLL
+	if ( Handle < 0 )
+		return false;
+	epoll_event Native;
+	Native.events = ToNativeEpoll( Target.Flags);
+	Native.data.u64 = (uint64)Slot;
+	int32 NativeOp = (Op == POLLCTL_Add) ? EPOLL_CTL_ADD : (Op == POLLCTL_Modify) ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+	if ( epoll_ctl( Handle, NativeOp, (int)Target.Socket->SocketDescriptor, &Native) )
+	{
+		DebugCallback( CSprintf("CSocketPoller: epoll_ctl failed (%s)", CSocket::ErrorText()), CACUS_CALLBACK_NET);
+		return false;
+	}
+#else
+	pollfd& Native = ((pollfd*)PollFDs)[Slot];
+	Native.fd      = (Op == POLLCTL_Remove) ? (SOCKET)-1 : (SOCKET)Target.Socket->SocketDescriptor; //Negative descriptors are ignored
+	Native.events  = (Op == POLLCTL_Remove) ? 0 : (short)ToNativePoll( Target.Flags);
+	Native.revents = 0;
+#endif
+	return true;
+}
+
+//========= CSocketPoller::Wait - begin ==========//
+//
+// Level triggered sockets that didn't fit in OutEvents are reported again
+// on the next call, edge triggered ones stay in the epoll ready list.
+//
+int32 CSocketPoller::Wait( Event* OutEvents, int32 MaxEvents, double WaitTime)
+{
+	int TimeoutMS = (WaitTime < 0) ? -1 : (int)(WaitTime * 1000.0);
+	int32 Count = 0;
+#if USES_EPOLL
+	if ( Handle < 0 )
+		return -1;
+	epoll_event Ready[DISPATCH_BATCH];
+	while ( Count < MaxEvents )
+	{
+		int32 Batch = Min<int32>( MaxEvents - Count, DISPATCH_BATCH);
+		int32 Result = epoll_wait( Handle, Ready, Batch, Count ? 0 : TimeoutMS);
+		if ( Result < 0 )
+		{
+			if ( errno == EINTR )
+				break;
+			return Count ? Count : -1;
+		}
+		for ( int32 i=0 ; i<Result ; i++ )
+		{
+			int32 Slot = (int32)Ready[i].data.u64;
+			if ( (Slot < EntryCount) && Entries[Slot].Socket )
+			{
+				Event& Out   = OutEvents[Count++];
+				Out.Socket   = Entries[Slot].Socket;
+				Out.UserData = Entries[Slot].UserData;
+				Out.Flags    = FromNativeEpoll( Ready[i].events);
+				Out.Slot     = Slot;
+			}
+		}
+		if ( Result < Batch )
+			break;
+	}
+#else
+	if ( !Active ) //WSAPoll fails on an empty set
+	{
+		if ( TimeoutMS > 0 )
+			Sleep( TimeoutMS);
+		return 0;
+	}
+	pollfd* Native = (pollfd*)PollFDs;
+	int32 Result = poll( Native, EntryCount, TimeoutMS);
+	if ( Result < 0 )
+		return (CSocket::ErrorCode() == EINTR) ? 0 : -1;
+	for ( int32 Slot=0 ; (Slot < EntryCount) && (Count < MaxEvents) && Result ; Slot++ )
+		if ( Native[Slot].revents && Entries[Slot].Socket )
+		{
+			Event& Out   = OutEvents[Count++];
+			Out.Socket   = Entries[Slot].Socket;
+			Out.UserData = Entries[Slot].UserData;
+			Out.Flags    = FromNativePoll( Native[Slot].revents);
+			Out.Slot     = Slot;
+			Result--;
+		}
+#endif
+	return Count;
+}
+//========= CSocketPoller::Wait - end ==========//
+
+int32 CSocketPoller::Dispatch( double WaitTime)
+{
+	Event Ready[DISPATCH_BATCH];
+	int32 Count = Wait( Ready, DISPATCH_BATCH, WaitTime);
+	for ( int32 i=0 ; i<Count ; i++ )
+	{
+		// An earlier callback may have removed this socket
+		if ( Callback && (Entries[Ready[i].Slot].Socket == Ready[i].Socket) )
+			(*Callback)( this, Ready[i]);
+	}
+	return Count;
+}
+
+int32 CSocketPoller::DispatchFor( double Time)
+{
+	double EndTime = FPlatformTime::Seconds() + Time;
+	int32 Total = 0;
+	do
+	{
+		int32 Count = Dispatch( Time);
+		if ( Count < 0 )
+			return Total ? Total : -1;
+		Total += Count;
+		Time = EndTime - FPlatformTime::Seconds();
+	} while ( Time >= 0.001 ); //Timeouts are in milliseconds, caller handles the rest
+	return Total;
+}
+
+
 /*----------------------------------------------------------------------------
 	Other.
 ----------------------------------------------------------------------------*/
@@ -0,0 +1,766 @@
+/*=============================================================================
+	Parser/Binary.cpp:
+	Compact binary serialization for the CField property system.
+	Author: Fernando Velzquez
+=============================================================================*/
+
+#include "../CacusLibPrivate.h"
+
+#include "CacusString.h"
+#include "DebugCallback.h"
+#include "Parser/Binary.h"
+
+#if USES_CACUS_FIELD
+
+static const CName NAME_Class("Class");
+static const uint8 BINARY_Magic[4] = { 'C', 'B', 'I', 'N' };
+static const uint8 DELTA_Magic[4]  = { 'C', 'D', 'L', 'T' };
+
+static FORCEINLINE void StoreLE32( uint8* Dest, uint32 Value)
+{
+	Dest[0] = (uint8)Value;
+	Dest[1] = (uint8)(Value >> 8);
+	Dest[2] = (uint8)(Value >> 16);
+	Dest[3] = (uint8)(Value >> 24);
+}
+
+static FORCEINLINE uint32 LoadLE32( const uint8* Src)
+{
+	return (uint32)Src[0] | ((uint32)Src[1] << 8) | ((uint32)Src[2] << 16) | ((uint32)Src[3] << 24);
+}
+
+// Delta values are only written for properties the other end can import
+static bool IsDeltaProperty( const CProperty* Property, void* Object)
+{
+	return (Property->NameHandle != NAME_Class) && !(Property->PropertyFlags & PF_NoImport) && Property->ShouldExport( Object);
+}
+
+// Destroys the object referenced by a struct pointer property
+static void ResetPointer( const CProperty* Property, const CStruct* Struct, void* Into, void* Object)
+{
+	CProperty* ClassProp = Struct->FindProperty( NAME_Class);
+	CStruct* RealStruct = ClassProp ? GetStruct( ClassProp->String( Object)) : nullptr;
+	(*(RealStruct ? RealStruct : Struct)->DefaultDestructor)( Object);
+	*AddressOffset<void*>( Into, Property->Offset) = nullptr;
+}
+
+
+//========= Schema hash - begin ==========//
+//
+// FNV-1a over the names, types and nesting of properties.
+// A struct reached again while its own layout is being hashed (self
+// referencing pointers) contributes its name only.
+// Only hashes computed from the root are cached in the CStruct, as
+// nested results depend on the path they were reached from.
+//
+struct CSchemaVisit
+{
+	const CStruct* Struct;
+	const CSchemaVisit* Prev;
+};
+
+static uint32 HashText( uint32 Hash, const char* Text)
+{
+	while ( *Text )
+		Hash = (Hash ^ (uint8)*Text++) * 16777619u;
+	return (Hash ^ 0xFF) * 16777619u; //Separator
+}
+
+static uint32 HashProperty( uint32 Hash, const CProperty* Property, const CSchemaVisit* Visit);
+
+static uint32 HashStruct( uint32 Hash, CStruct* Struct, const CSchemaVisit* Visit)
+{
+	for ( const CSchemaVisit* Link=Visit ; Link ; Link=Link->Prev )
+		if ( Link->Struct == Struct )
+			return HashText( Hash, Struct->Name);
+
+	uint32 StructHash = Visit ? 0 : Struct->SchemaHash;
+	if ( !StructHash )
+	{
+		CSchemaVisit Current = { Struct, Visit };
+		StructHash = HashText( 2166136261u, Struct->Name);
+		for ( uint32 i=0 ; i<Struct->PropertyCount ; i++ )
+			StructHash = HashProperty( HashText( StructHash, Struct->PropertyTable[i]->Name), Struct->PropertyTable[i], &Current);
+		if ( !Visit )
+			Struct->SchemaHash = StructHash;
+	}
+	return (Hash ^ StructHash) * 16777619u;
+}
+
+static uint32 HashProperty( uint32 Hash, const CProperty* Property, const CSchemaVisit* Visit)
+{
+	Hash = HashText( Hash, Property->TypeName());
+	if ( Property->GetInner() )
+		Hash = HashProperty( Hash, Property->GetInner(), Visit);
+	else if ( Property->IsTypeA("PropertyStruct") )
+		Hash = HashStruct( Hash, ((const PropertyStruct*)Property)->Model, Visit);
+	else if ( Property->IsTypeA("PropertyStructPtr") )
+		Hash = HashStruct( Hash, ((const PropertyStructPtr*)Property)->Model, Visit);
+	else if ( Property->IsTypeA("PropertyEnum") ) //Enums are written as indices
+	{
+		const PropertyEnum* Enum = (const PropertyEnum*)Property;
+		for ( uint32 i=0 ; i<Enum->EnumCount ; i++ )
+			Hash = HashText( Hash, Enum->EnumLiterals[i]);
+	}
+	return Hash;
+}
+
+uint32 BinarySchemaHash( const CProperty* Outer)
+{
+	return HashProperty( 2166136261u, Outer, nullptr);
+}
+//========= Schema hash - end ==========//
+
+
+//========= CBinaryWriter - begin ==========//
+CBinaryWriter::CBinaryWriter( std::string& InOut, bool bInDelta)
+	: Out(InOut)
+	, bDelta(bInDelta)
+{
+}
+
+void CBinaryWriter::WriteRoot( const CProperty* Outer, void* From)
+{
+	size_t Start = Out.length();
+	Out.append( HEADER_SIZE, '\0');
+	WriteValue( Outer, From);
+	WriteHeader( Start, BINARY_Magic, Outer);
+}
+
+void CBinaryWriter::WriteHeader( size_t Start, const uint8* Magic, const CProperty* Outer)
+{
+	uint8* Header = (uint8*)&Out[Start];
+	CMemcpy( Header, Magic, 4);
+	StoreLE32( Header + 4, BinarySchemaHash(Outer));
+	StoreLE32( Header + 8, (uint32)(Out.length() - Start - HEADER_SIZE));
+}
+
+void CBinaryWriter::WriteValue( const CProperty* Property, void* From)
+{
+	void* Object;
+	size_t Count;
+	const CStruct* Struct = Property->ExportObject( From, Object);
+	if ( Struct )
+	{
+		if ( Property->IsPointer() )
+			Out += (char)(Object != nullptr);
+		if ( Object )
+			WriteObject( Struct, Object);
+	}
+	else if ( Property->ExportArray( From, Count) )
+	{
+		const CProperty* Inner = Property->GetInner();
+		WriteVarint( Count);
+		for ( size_t i=0 ; i<Count ; i++ )
+			WriteValue( Inner, Property->ExportArrayElement( From, i));
+	}
+	else
+		Property->WriteBinary( From, *this);
+}
+
+void CBinaryWriter::WriteObject( const CStruct* Struct, void* Object)
+{
+	CProperty* ClassProp = Struct->FindProperty( NAME_Class);
+	if ( ClassProp ) //Polymorphic object, property ids depend on real class
+	{
+		const char* ClassName = ClassProp->String( Object);
+		CStruct* RealStruct = GetStruct( ClassName);
+		if ( RealStruct )
+			Struct = RealStruct;
+		WriteString( ClassName, RealStruct ? CStrlen(ClassName) : 0);
+	}
+
+	uint32 LastId = 0;
+	for ( uint32 i=0 ; i<Struct->PropertyCount ; i++ )
+	{
+		const CProperty* Link = Struct->PropertyTable[i];
+		if ( (Link->NameHandle != NAME_Class) && Link->ShouldExport( Object, bDelta ? Link->Parent->DefaultObject : nullptr) )
+		{
+			WriteVarint( i + 1 - LastId);
+			LastId = i + 1;
+			WriteValue( Link, Object);
+		}
+	}
+	Out += '\0';
+}
+
+void CBinaryWriter::WriteDeltaRoot( const CProperty* Outer, void* Base, void* From)
+{
+	size_t Start = Out.length();
+	Out.append( HEADER_SIZE, '\0');
+	WriteDelta( Outer, Base, From);
+	WriteHeader( Start, DELTA_Magic, Outer);
+}
+
+bool CBinaryWriter::WriteDelta( const CProperty* Property, void* Base, void* From)
+{
+	if ( Base && Property->Identical( Base, From) )
+		return false;
+
+	void* Object;
+	size_t Count;
+	const CStruct* Struct = Property->ExportObject( From, Object);
+	if ( Struct )
+	{
+		void* BaseObject = nullptr;
+		if ( Base )
+			Property->ExportObject( Base, BaseObject);
+		if ( Property->IsPointer() )
+			Out += (char)(Object != nullptr);
+		if ( Object )
+			WriteDeltaObject( Struct, BaseObject, Object);
+	}
+	else if ( Property->ExportArray( From, Count) )
+	{
+		size_t BaseCount;
+		if ( !Base || !Property->ExportArray( Base, BaseCount) || (BaseCount != Count) )
+		{
+			Out += '\0';
+			WriteValue( Property, From);
+		}
+		else //Same size, write changed elements
+		{
+			const CProperty* Inner = Property->GetInner();
+			Out += '\1';
+			WriteVarint( Count);
+			size_t MaskStart = Out.length();
+			Out.append( (Count + 7) / 8, '\0');
+			for ( size_t i=0 ; i<Count ; i++ )
+				if ( WriteDelta( Inner, Property->ExportArrayElement( Base, i), Property->ExportArrayElement( From, i)) )
+					Out[MaskStart + i / 8] |= (char)(1 << (i & 7));
+		}
+	}
+	else
+		Property->WriteBinary( From, *this);
+	return true;
+}
+
+void CBinaryWriter::WriteDeltaObject( const CStruct* Struct, void* BaseObject, void* Object)
+{
+	CProperty* ClassProp = Struct->FindProperty( NAME_Class);
+	if ( ClassProp ) //Objects of another class are written in full
+	{
+		const char* ClassName = ClassProp->String( Object);
+		CStruct* RealStruct = GetStruct( ClassName);
+		if ( RealStruct )
+			Struct = RealStruct;
+		WriteString( ClassName, RealStruct ? CStrlen(ClassName) : 0);
+		if ( BaseObject && (GetStruct( ClassProp->String( BaseObject)) != RealStruct) )
+			BaseObject = nullptr;
+	}
+
+	size_t MaskStart = Out.length();
+	Out.append( (Struct->PropertyCount + 7) / 8, '\0');
+	for ( uint32 i=0 ; i<Struct->PropertyCount ; i++ )
+	{
+		const CProperty* Link = Struct->PropertyTable[i];
+		if ( IsDeltaProperty( Link, Object) && WriteDelta( Link, BaseObject, Object) )
+			Out[MaskStart + i / 8] |= (char)(1 << (i & 7));
+	}
+}
+
+void CBinaryWriter::WriteVarint( uint64 Value)
+{
+	char Buffer[10];
+	size_t Len = 0;
+	for ( ; Value >= 0x80 ; Value >>= 7 )
+		Buffer[Len++] = (char)(Value | 0x80);
+	Buffer[Len++] = (char)Value;
+	Out.append( Buffer, Len);
+}
+
+void CBinaryWriter::WriteSigned( int64 Value)
+{
+	WriteVarint( ((uint64)Value << 1) ^ (uint64)(Value >> 63) ); //Zigzag
+}
+
+void CBinaryWriter::WriteFixed32( uint32 Value)
+{
+	uint8 Buffer[4];
+	StoreLE32( Buffer, Value);
+	Out.append( (const char*)Buffer, 4);
+}
+
+void CBinaryWriter::WriteBytes( const void* Data, size_t Len)
+{
+	Out.append( (const char*)Data, Len);
+}
+
+void CBinaryWriter::WriteString( const char* Text, size_t Len)
+{
+	WriteVarint( Len);
+	Out.append( Text, Len);
+}
+//========= CBinaryWriter - end ==========//
+
+
+//========= CBinaryReader - begin ==========//
+CBinaryReader::CBinaryReader( const void* InData, size_t InLen)
+	: Pos( (const uint8*)InData)
+	, End( (const uint8*)InData + InLen)
+	, Depth(0)
+	, bError(false)
+{
+}
+
+size_t CBinaryReader::PeekSize( const void* Data, size_t Len)
+{
+	const uint8* Header = (const uint8*)Data;
+	if ( Len < CBinaryWriter::HEADER_SIZE || (memcmp( Header, BINARY_Magic, 4) && memcmp( Header, DELTA_Magic, 4)) )
+		return 0;
+	return CBinaryWriter::HEADER_SIZE + LoadLE32( Header + 8);
+}
+
+bool CBinaryReader::ReadHeader( const uint8* Magic, const CProperty* Outer)
+{
+	if ( End - Pos < CBinaryWriter::HEADER_SIZE || memcmp( Pos, Magic, 4) )
+		return Error( (Magic == DELTA_Magic) ? "Not a delta" : "Not binary data");
+	if ( LoadLE32( Pos + 4) != BinarySchemaHash(Outer) )
+		return Error( "Schema mismatch");
+	size_t PayloadSize = LoadLE32( Pos + 8);
+	Pos += CBinaryWriter::HEADER_SIZE;
+	if ( PayloadSize > (size_t)(End - Pos) )
+		return Error( "Truncated data");
+	End = Pos + PayloadSize;
+	return true;
+}
+
+bool CBinaryReader::ReadRoot( const CProperty* Outer, void* Into)
+{
+	if ( !ReadHeader( BINARY_Magic, Outer) || !ReadValue( Outer, Into) )
+		return false;
+	return (Pos == End) || Error( "Trailing data");
+}
+
+bool CBinaryReader::ReadValue( const CProperty* Property, void* Into)
+{
+	void* Object;
+	const CStruct* Struct = Property->ExportObject( Into, Object); //Identifies objects without creating them
+	if ( Struct )
+	{
+		const char* Present;
+		if ( Property->IsPointer() && (!ReadBytes( Present, 1) || !*Present) )
+			return !bError; //Null pointers are left untouched
+
+		const char* ClassName;
+		if ( !ReadClassName( Struct, ClassName) )
+			return false;
+		Object = Property->ImportObject( Into, Struct, ClassName);
+		if ( Object )
+			return ReadObject( Struct, Object);
+
+		//Existing object of a different class, read and discard
+		void* Temp = (*Struct->DefaultCreator)();
+		bool Result = ReadObject( Struct, Temp);
+		(*Struct->DefaultDestructor)( Temp);
+		return Result;
+	}
+	else if ( Property->ImportArray( Into) )
+	{
+		uint64 Count;
+		if ( !ReadVarint( Count) )
+			return false;
+		if ( Count > (uint64)(End - Pos) ) //Every element takes at least one byte
+			return Error( "Invalid array size");
+		const CProperty* Inner = Property->GetInner();
+		for ( size_t i=0 ; i<(size_t)Count ; i++ )
+			if ( !ReadValue( Inner, Property->ImportArrayElement( Into, i)) )
+				return false;
+		Property->ImportArrayEnd( Into, (size_t)Count);
+		return true;
+	}
+	return Property->ReadBinary( Into, *this);
+}
+
+bool CBinaryReader::ReadObject( const CStruct* Struct, void* Object)
+{
+	if ( Depth >= MAX_DEPTH )
+		return Error( "Nesting too deep");
+
+	Depth++;
+	uint64 Id = 0;
+	uint64 Tag;
+	while ( ReadVarint( Tag) && Tag )
+	{
+		Id += Tag;
+		if ( Id > Struct->PropertyCount )
+			Error( "Invalid property tag");
+		else
+		{
+			const CProperty* Link = Struct->PropertyTable[Id-1];
+			if ( Link->PropertyFlags & PF_NoImport )
+				Discard( Link, Link->Parent);
+			else
+				ReadValue( Link, Object);
+		}
+		if ( bError )
+			break;
+	}
+	Depth--;
+
+	if ( bError )
+		return false;
+	if ( Struct->PostParseFunction )
+		(*Struct->PostParseFunction)( Object);
+	return true;
+}
+
+bool CBinaryReader::ReadDeltaRoot( const CProperty* Outer, void* Into)
+{
+	if ( !ReadHeader( DELTA_Magic, Outer) )
+		return false;
+	if ( Pos == End ) //No changes
+		return true;
+	if ( !ReadDelta( Outer, Into) )
+		return false;
+	return (Pos == End) || Error( "Trailing data");
+}
+
+bool CBinaryReader::ReadDelta( const CProperty* Property, void* Into)
+{
+	void* Object;
+	size_t Count;
+	const CStruct* Struct = Property->ExportObject( Into, Object);
+	if ( Struct )
+	{
+		const char* ClassName;
+		const char* Present;
+		if ( Property->IsPointer() )
+		{
+			if ( !ReadBytes( Present, 1) )
+				return false;
+			if ( !*Present )
+			{
+				if ( Object )
+					ResetPointer( Property, Struct, Into, Object);
+				return true;
+			}
+		}
+		if ( !ReadClassName( Struct, ClassName) )
+			return false;
+		const CStruct* ImportStruct = Struct;
+		Object = Property->ImportObject( Into, ImportStruct, ClassName);
+		if ( !Object && Property->IsPointer() ) //Replace object of a different class
+		{
+			Property->ExportObject( Into, Object);
+			ResetPointer( Property, Struct, Into, Object);
+			ImportStruct = Struct;
+			Object = Property->ImportObject( Into, ImportStruct, ClassName);
+		}
+		if ( Object )
+			return ReadDeltaObject( ImportStruct, Object);
+
+		//Existing value of a different class, read and discard
+		void* Temp = (*ImportStruct->DefaultCreator)();
+		bool Result = ReadDeltaObject( ImportStruct, Temp);
+		(*ImportStruct->DefaultDestructor)( Temp);
+		return Result;
+	}
+	else if ( Property->ExportArray( Into, Count) )
+	{
+		const char* Mode;
+		if ( !ReadBytes( Mode, 1) )
+			return false;
+		if ( !*Mode )
+			return ReadValue( Property, Into);
+
+		uint64 BaseCount;
+		if ( !ReadVarint( BaseCount) )
+			return false;
+		if ( BaseCount != Count )
+			return Error( "Array size doesn't match delta base");
+		const char* Mask;
+		if ( !ReadBytes( Mask, (Count + 7) / 8) )
+			return false;
+		const CProperty* Inner = Property->GetInner();
+		for ( size_t i=0 ; i<Count ; i++ )
+			if ( (Mask[i / 8] & (1 << (i & 7))) && !ReadDelta( Inner, Property->ExportArrayElement( Into, i)) )
+				return false;
+		return true;
+	}
+	return Property->ReadBinary( Into, *this);
+}
+
+bool CBinaryReader::ReadDeltaObject( const CStruct* Struct, void* Object)
+{
+	if ( Depth >= MAX_DEPTH )
+		return Error( "Nesting too deep");
+
+	const char* Mask;
+	if ( !ReadBytes( Mask, (Struct->PropertyCount + 7) / 8) )
+		return false;
+
+	Depth++;
+	for ( uint32 i=0 ; (i<Struct->PropertyCount) && !bError ; i++ )
+		if ( Mask[i / 8] & (1 << (i & 7)) )
+		{
+			const CProperty* Link = Struct->PropertyTable[i];
+			if ( Link->PropertyFlags & PF_NoImport )
+				Error( "Invalid property mask");
+			else
+				ReadDelta( Link, Object);
+		}
+	Depth--;
+
+	if ( bError )
+		return false;
+	if ( Struct->PostParseFunction )
+		(*Struct->PostParseFunction)( Object);
+	return true;
+}
+
+bool CBinaryReader::ReadVarint( uint64& Value)
+{
+	Value = 0;
+	for ( uint32 Shift=0 ; Shift<64 ; Shift+=7 )
+	{
+		if ( Pos >= End )
+			return Error( "Truncated data");
+		uint8 Byte = *Pos++;
+		Value |= (uint64)(Byte & 0x7F) << Shift;
+		if ( !(Byte & 0x80) )
+			return true;
+	}
+	return Error( "Invalid varint");
+}
+
+bool CBinaryReader::ReadSigned( int64& Value)
+{
+	uint64 Zigzag;
+	if ( !ReadVarint( Zigzag) )
+		return false;
+	Value = (int64)(Zigzag >> 1) ^ -(int64)(Zigzag & 1);
+	return true;
+}
+
+bool CBinaryReader::ReadFixed32( uint32& Value)
+{
+	if ( End - Pos < 4 )
+		return Error( "Truncated data");
+	Value = LoadLE32( Pos);
+	Pos += 4;
+	return true;
+}
+
+bool CBinaryReader::ReadBytes( const char*& OutData, size_t Len)
+{
+	if ( Len > (size_t)(End - Pos) )
+		return Error( "Truncated data");
+	OutData = (const char*)Pos;
+	Pos += Len;
+	return true;
+}
+
+bool CBinaryReader::ReadString( const char*& OutText, size_t& OutLen)
+{
+	uint64 Len;
+	if ( !ReadVarint( Len) )
+		return false;
+	if ( Len > (uint64)(End - Pos) )
+		return Error( "Truncated data");
+	OutLen = (size_t)Len;
+	return ReadBytes( OutText, OutLen);
+}
+
+const char* CBinaryReader::ReadText()
+{
+	const char* Text;
+	size_t Len;
+	if ( !ReadString( Text, Len) )
+		return nullptr;
+	Scratch.assign( Text, Len);
+	return Scratch.c_str();
+}
+
+bool CBinaryReader::ReadClassName( const CStruct* Struct, const char*& OutClassName)
+{
+	OutClassName = nullptr;
+	if ( Struct->FindProperty( NAME_Class) )
+	{
+		const char* ClassName = ReadText();
+		if ( !ClassName )
+			return false;
+		if ( *ClassName && !GetStruct( ClassName) )
+			return Error( CSprintf( "Unknown class %s", ClassName));
+		if ( *ClassName )
+			OutClassName = ClassName;
+	}
+	return true;
+}
+
+bool CBinaryReader::Error( const char* Message)
+{
+	bError = true;
+	DebugCallback( CSprintf("CBinaryReader -> %s", Message), CACUS_CALLBACK_PARSER );
+	return false;
+}
+
+// Reads a property into a temporary object of the struct that declares it
+bool CBinaryReader::Discard( const CProperty* Property, const CStruct* Owner)
+{
+	void* Temp = (*Owner->DefaultCreator)();
+	bool Result = ReadValue( Property, Temp);
+	(*Owner->DefaultDestructor)( Temp);
+	return Result;
+}
+//========= CBinaryReader - end ==========//
+
+
+//========= Property serializers - begin ==========//
+void CProperty::WriteBinary( void* From, CBinaryWriter& Writer) const
+{
+	const char* Text = String( From);
+	Writer.WriteString( Text, CStrlen(Text));
+}
+
+bool CProperty::ReadBinary( void* Into, CBinaryReader& Reader) const
+{
+	const char* Text = Reader.ReadText();
+	if ( !Text )
+		return false;
+	Parse( Into, Text);
+	return true;
+}
+
+void PropertyStdString::WriteBinary( void* From, CBinaryWriter& Writer) const
+{
+	Primitive& Prop = GetProp<Primitive>(From);
+	Writer.WriteString( Prop.data(), Prop.length());
+}
+
+bool PropertyStdString::ReadBinary( void* Into, CBinaryReader& Reader) const
+{
+	const char* Text;
+	size_t Len;
+	if ( !Reader.ReadString( Text, Len) )
+		return false;
+	GetProp<Primitive>(Into).assign( Text, Len);
+	return true;
+}
+
+void PropertyC8TextBase::WriteBinary( void* From, CBinaryWriter& Writer) const
+{
+	const char* Text = GetAddr<char>(From);
+	size_t Len = 0;
+	while ( (Len < BufSize) && Text[Len] )
+		Len++;
+	Writer.WriteString( Text, Len);
+}
+
+bool PropertyC8TextBase::ReadBinary( void* Into, CBinaryReader& Reader) const
+{
+	const char* Text;
+	size_t Len;
+	if ( !Reader.ReadString( Text, Len) )
+		return false;
+	char* Prop = GetAddr<char>(Into);
+	Len = Min<size_t>( Len, BufSize - 1);
+	CMemcpy( Prop, Text, Len);
+	Prop[Len] = '\0';
+	return true;
+}
+
+void PropertyC16TextBase::WriteBinary( void* From, CBinaryWriter& Writer) const
+{
+	const char16* Text = GetAddr<char16>(From);
+	size_t Len = 0;
+	while ( (Len < BufSize) && Text[Len] )
+		Len++;
+	Writer.WriteVarint( Len);
+	for ( size_t i=0 ; i<Len ; i++ )
+		Writer.WriteVarint( (uint16)Text[i]);
+}
+
+bool PropertyC16TextBase::ReadBinary( void* Into, CBinaryReader& Reader) const
+{
+	uint64 Len, Char;
+	if ( !Reader.ReadVarint( Len) )
+		return false;
+	char16* Prop = GetAddr<char16>(Into);
+	size_t Copy = 0;
+	for ( uint64 i=0 ; i<Len ; i++ )
+	{
+		if ( !Reader.ReadVarint( Char) )
+			return false;
+		if ( Copy < BufSize - 1 )
+			Prop[Copy++] = (char16)Char;
+	}
+	Prop[Copy] = 0;
+	return true;
+}
+
+void PropertyInt32::WriteBinary( void* From, CBinaryWriter& Writer) const
+{
+	Writer.WriteSigned( GetProp<Primitive>(From));
+}
+
+bool PropertyInt32::ReadBinary( void* Into, CBinaryReader& Reader) const
+{
+	int64 Value;
+	if ( !Reader.ReadSigned( Value) )
+		return false;
+	GetProp<Primitive>(Into) = (Primitive)Value;
+	return true;
+}
+
+void PropertyUInt32::WriteBinary( void* From, CBinaryWriter& Writer) const
+{
+	Writer.WriteVarint( GetProp<Primitive>(From));
+}
+
+bool PropertyUInt32::ReadBinary( void* Into, CBinaryReader& Reader) const
+{
+	uint64 Value;
+	if ( !Reader.ReadVarint( Value) )
+		return false;
+	GetProp<Primitive>(Into) = (Primitive)Value;
+	return true;
+}
+
+void PropertyFloat::WriteBinary( void* From, CBinaryWriter& Writer) const
+{
+	uint32 Bits;
+	CMemcpy( &Bits, GetAddr<Primitive>(From), sizeof(Bits));
+	Writer.WriteFixed32( Bits);
+}
+
+bool PropertyFloat::ReadBinary( void* Into, CBinaryReader& Reader) const
+{
+	uint32 Bits;
+	if ( !Reader.ReadFixed32( Bits) )
+		return false;
+	CMemcpy( GetAddr<Primitive>(Into), &Bits, sizeof(Bits));
+	return true;
+}
+
+void PropertyBool::WriteBinary( void* From, CBinaryWriter& Writer) const
+{
+	Writer.WriteVarint( GetProp<Primitive>(From) ? 1 : 0);
+}
+
+bool PropertyBool::ReadBinary( void* Into, CBinaryReader& Reader) const
+{
+	uint64 Value;
+	if ( !Reader.ReadVarint( Value) )
+		return false;
+	GetProp<Primitive>(Into) = (Value != 0);
+	return true;
+}
+
+void PropertyEnum::WriteBinary( void* From, CBinaryWriter& Writer) const
+{
+	Writer.WriteVarint( (uint32)GetProp<Primitive>(From));
+}
+
+bool PropertyEnum::ReadBinary( void* Into, CBinaryReader& Reader) const
+{
+	uint64 Value;
+	if ( !Reader.ReadVarint( Value) )
+		return false;
+	if ( Value < EnumCount )
+		GetProp<Primitive>(Into) = (Primitive)Value;
+	return true;
+}
+//========= Property serializers - end ==========//
+
+#endif
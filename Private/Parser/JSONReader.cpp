@@ -0,0 +1,435 @@
+/*=============================================================================
+	Parser/JSONReader.cpp:
+	Streaming JSON reader bound to the CField property system.
+	Author: Fernando Velzquez
+=============================================================================*/
+
+#include "../CacusLibPrivate.h"
+
+#include "CacusString.h"
+#include "DebugCallback.h"
+#include "Parser/JSONReader.h"
+
+#if USES_CACUS_FIELD
+
+#include "Internal/CParser.h"
+
+static const CName NAME_Class("Class");
+
+static FORCEINLINE bool IsJSONSpace( char C)
+{
+	return (C == ' ') || (C == '\t') || (C == '\r') || (C == '\n');
+}
+
+// Same character set as CJSONParser::ParseLiteral
+static FORCEINLINE bool IsJSONLiteral( char C)
+{
+	return (C >= 'a' && C <= 'z') || (C >= '0' && C <= '9') || (C == '-') || (C == '+') || (C == '.') || (C == 'E');
+}
+
+//
+// Finds the closing quote of a string, bEscape carries a trailing
+// backslash into the next chunk.
+//
+static const char* FindStringEnd( const char* Pos, const char* End, bool& bEscape)
+{
+	if ( bEscape && (Pos < End) )
+	{
+		bEscape = false;
+		Pos++;
+	}
+	while ( Pos < End )
+	{
+		const char* Quote = (const char*)memchr( Pos, '\x22', End - Pos);
+		const char* Slash = (const char*)memchr( Pos, '\\', (Quote ? Quote : End) - Pos);
+		if ( !Slash )
+			return Quote;
+		if ( Slash + 1 >= End )
+		{
+			bEscape = true;
+			return nullptr;
+		}
+		Pos = Slash + 2;
+	}
+	return nullptr;
+}
+
+
+CJSONReader::CJSONReader( void* InInto, CProperty* InOuter)
+	: Depth(0)
+	, Expect(EXPECT_Value)
+	, bError(false)
+	, bClassValue(false)
+	, bCarryEscape(false)
+	, ValueProperty(InOuter)
+	, ValueContainer(InInto)
+	, Carry(nullptr)
+	, CarryLen(0)
+	, CarrySize(0)
+	, Scratch(nullptr)
+	, ScratchSize(0)
+{
+}
+
+CJSONReader::~CJSONReader()
+{
+	if ( Carry )
+		CFree( Carry);
+	if ( Scratch )
+		CFree( Scratch);
+}
+
+bool CJSONReader::Feed( const char* Data, size_t Len)
+{
+	if ( bError )
+		return false;
+	const char* End = Data + Len;
+
+	if ( CarryLen ) //Complete token started in a previous chunk
+	{
+		const char* TokenEnd;
+		if ( Carry[0] == '\x22' )
+		{
+			TokenEnd = FindStringEnd( Data, End, bCarryEscape);
+			if ( TokenEnd )
+				TokenEnd++;
+		}
+		else
+		{
+			for ( TokenEnd=Data ; (TokenEnd < End) && IsJSONLiteral(*TokenEnd) ; TokenEnd++ );
+			if ( TokenEnd == End )
+				TokenEnd = nullptr;
+		}
+		if ( !AppendCarry( Data, TokenEnd ? TokenEnd : End) )
+			return false;
+		if ( !TokenEnd )
+			return true;
+
+		size_t TokenLen = CarryLen;
+		CarryLen = 0;
+		if ( !((Carry[0] == '\x22') ? String( Carry + 1, TokenLen - 2) : Literal( Carry, TokenLen)) )
+			return false;
+		Data = TokenEnd;
+	}
+
+	while ( Data < End )
+	{
+		char C = *Data;
+		if ( IsJSONSpace(C) )
+			Data++;
+		else if ( C == '\x22' )
+		{
+			bool bEscape = false;
+			const char* Close = FindStringEnd( Data + 1, End, bEscape);
+			if ( !Close )
+			{
+				bCarryEscape = bEscape;
+				return AppendCarry( Data, End);
+			}
+			if ( !String( Data + 1, (size_t)(Close - Data - 1)) )
+				return false;
+			Data = Close + 1;
+		}
+		else if ( IsJSONLiteral(C) )
+		{
+			const char* LiteralEnd = Data + 1;
+			while ( (LiteralEnd < End) && IsJSONLiteral(*LiteralEnd) )
+				LiteralEnd++;
+			if ( LiteralEnd == End ) //May continue in next chunk
+				return AppendCarry( Data, End);
+			if ( !Literal( Data, (size_t)(LiteralEnd - Data)) )
+				return false;
+			Data = LiteralEnd;
+		}
+		else if ( Structural(C) )
+			Data++;
+		else
+			return false;
+	}
+	return true;
+}
+
+bool CJSONReader::Finish()
+{
+	if ( CarryLen && !bError )
+	{
+		if ( Carry[0] == '\x22' )
+			Error( "Unterminated string");
+		else
+		{
+			size_t TokenLen = CarryLen;
+			CarryLen = 0;
+			Literal( Carry, TokenLen);
+		}
+	}
+	if ( !bError && (Expect != EXPECT_Done) )
+		Error( "Unexpected end of data");
+	return IsDone();
+}
+
+
+bool CJSONReader::Structural( char C)
+{
+	switch ( C )
+	{
+	case '{':
+	case '[':
+	{
+		if ( !BeginValue() )
+			return false;
+		if ( Depth >= MAX_DEPTH )
+			return Error( "Nesting too deep");
+		CFrame& Frame = Stack[Depth++];
+		Frame.Property  = ValueProperty;
+		Frame.Container = ValueContainer;
+		Frame.Struct    = nullptr;
+		Frame.Object    = nullptr;
+		Frame.Count     = 0;
+		Frame.bArray    = (C == '[');
+		if ( Frame.bArray )
+		{
+			Frame.bPending = 0;
+			Frame.bIgnore  = !ValueProperty || !ValueProperty->ImportArray( ValueContainer);
+			Expect = EXPECT_ValueOrEnd;
+		}
+		else
+		{
+			Frame.bPending = (ValueProperty != nullptr);
+			Frame.bIgnore  = (ValueProperty == nullptr);
+			Expect = EXPECT_KeyOrEnd;
+		}
+		return true;
+	}
+	case '}':
+	{
+		if ( (Expect != EXPECT_KeyOrEnd && Expect != EXPECT_CommaOrEnd) || Stack[Depth-1].bArray )
+			break;
+		CFrame& Frame = Stack[--Depth];
+		if ( Frame.bPending )
+			Resolve( Frame, nullptr);
+		if ( !Frame.bIgnore && Frame.Struct->PostParseFunction )
+			(*Frame.Struct->PostParseFunction)( Frame.Object);
+		EndValue();
+		return true;
+	}
+	case ']':
+	{
+		if ( (Expect != EXPECT_ValueOrEnd && Expect != EXPECT_CommaOrEnd) || !Stack[Depth-1].bArray )
+			break;
+		CFrame& Frame = Stack[--Depth];
+		if ( !Frame.bIgnore )
+			Frame.Property->ImportArrayEnd( Frame.Container, Frame.Count);
+		EndValue();
+		return true;
+	}
+	case ',':
+		if ( Expect != EXPECT_CommaOrEnd )
+			break;
+		Expect = Stack[Depth-1].bArray ? EXPECT_Value : EXPECT_Key;
+		return true;
+	case ':':
+		if ( Expect != EXPECT_Colon )
+			break;
+		Expect = EXPECT_Value;
+		return true;
+	default:
+		break;
+	}
+	return Error( CSprintf( "Unexpected character '%c'", C));
+}
+
+bool CJSONReader::String( const char* Start, size_t Len)
+{
+	if ( Expect == EXPECT_Key || Expect == EXPECT_KeyOrEnd )
+	{
+		CFrame& Frame = Stack[Depth-1];
+		const char* Key = Start;
+		if ( memchr( Start, '\\', Len) )
+		{
+			if ( (Key=ScratchValue( Start, Len)) == nullptr )
+				return false;
+			Len = CStrlen( Key);
+		}
+		CName KeyName( Key, Len, CNAME_Find);
+
+		ValueProperty = nullptr;
+		if ( Frame.bPending )
+		{
+			if ( KeyName == NAME_Class )
+				bClassValue = true;
+			else
+				Resolve( Frame, nullptr);
+		}
+		if ( !Frame.bIgnore && !bClassValue && (Len == 0 || !KeyName.IsNone()) )
+		{
+			CProperty* Property = Frame.Struct->FindProperty( KeyName);
+			if ( Property && !(Property->PropertyFlags & PF_NoImport) )
+			{
+				ValueProperty = Property;
+				ValueContainer = Frame.Object;
+			}
+		}
+		if ( !ValueProperty && !Frame.bIgnore && !bClassValue && (KeyName != NAME_Class) )
+			DebugCallback( CSprintf("CJSONReader: property not found %s", CopyToBuffer(Key,Len)), CACUS_CALLBACK_PARSER );
+		Frame.Count++;
+		Expect = EXPECT_Colon;
+		return true;
+	}
+
+	if ( !BeginValue( true) )
+		return false;
+	const char* Value = ScratchValue( Start, Len);
+	if ( !Value )
+		return false;
+	if ( bClassValue )
+	{
+		bClassValue = false;
+		Resolve( Stack[Depth-1], Value);
+	}
+	else
+		ImportValue( Value);
+	EndValue();
+	return true;
+}
+
+bool CJSONReader::Literal( const char* Start, size_t Len)
+{
+	if ( !BeginValue() )
+		return false;
+	if ( (Len == 4) && !CStrncmp( Start, "null", 4) )
+	{
+		if ( ValueProperty )
+			ValueProperty->Parse( ValueContainer, ""); //Same as an empty element
+	}
+	else
+	{
+		const char* Value = ScratchValue( Start, Len);
+		if ( !Value )
+			return false;
+		ImportValue( Value);
+	}
+	EndValue();
+	return true;
+}
+
+//
+// Validates value position and sets up the import destination of array elements.
+// A non-string 'Class' value resolves the pending object with its default class.
+//
+bool CJSONReader::BeginValue( bool bString)
+{
+	if ( Expect != EXPECT_Value && Expect != EXPECT_ValueOrEnd )
+		return Error( "Unexpected value");
+	if ( Depth > 0 )
+	{
+		CFrame& Frame = Stack[Depth-1];
+		if ( Frame.bArray )
+		{
+			size_t Index = Frame.Count++;
+			ValueProperty = nullptr;
+			if ( !Frame.bIgnore && (ValueContainer=Frame.Property->ImportArrayElement( Frame.Container, Index)) != nullptr )
+				ValueProperty = Frame.Property->GetInner();
+		}
+		else if ( bClassValue && !bString )
+		{
+			bClassValue = false;
+			Resolve( Frame, nullptr);
+			ValueProperty = nullptr;
+		}
+	}
+	return true;
+}
+
+void CJSONReader::EndValue()
+{
+	Expect = Depth ? EXPECT_CommaOrEnd : EXPECT_Done;
+}
+
+void CJSONReader::ImportValue( const char* Value)
+{
+	if ( ValueProperty && !ValueProperty->Parse( ValueContainer, Value) )
+		DebugCallback( CSprintf("Import failed for element [%s] with value %s", ValueProperty->Name, Value), CACUS_CALLBACK_PARSER );
+}
+
+void CJSONReader::Resolve( CFrame& Frame, const char* ClassName)
+{
+	Frame.bPending = 0;
+	Frame.Object = Frame.Property->ImportObject( Frame.Container, Frame.Struct, ClassName);
+	if ( !Frame.Object )
+		Frame.bIgnore = 1;
+}
+
+bool CJSONReader::Error( const char* Message)
+{
+	bError = true;
+	DebugCallback( CSprintf("CJSONReader -> %s", Message), CACUS_CALLBACK_PARSER );
+	Unwind();
+	return false;
+}
+
+//
+// Closes arrays left open by an error or a truncated document, fixed
+// arrays grow ahead of the elements read and need trimming.
+//
+void CJSONReader::Unwind()
+{
+	while ( Depth > 0 )
+	{
+		CFrame& Frame = Stack[--Depth];
+		if ( Frame.bArray && !Frame.bIgnore )
+			Frame.Property->ImportArrayEnd( Frame.Container, Frame.Count);
+	}
+}
+
+bool CJSONReader::AppendCarry( const char* Start, const char* End)
+{
+	size_t Len = (size_t)(End - Start);
+	if ( CarryLen + Len > CarrySize )
+	{
+		size_t NewSize = Max<size_t>( CarryLen + Len, Max<size_t>( CarrySize * 2, 256));
+		char* NewCarry = (char*)CRealloc( Carry, NewSize);
+		if ( !NewCarry )
+			return Error( "Out of memory");
+		Carry = NewCarry;
+		CarrySize = NewSize;
+	}
+	CMemcpy( Carry + CarryLen, Start, Len);
+	CarryLen += Len;
+	return true;
+}
+
+//
+// Copies a token into the scratch buffer as a null terminated string,
+// decoding escape sequences if present.
+//
+const char* CJSONReader::ScratchValue( const char* Start, size_t Len)
+{
+	if ( Len + 1 > ScratchSize )
+	{
+		size_t NewSize = Max<size_t>( Len + 1, Max<size_t>( ScratchSize * 2, 256));
+		char* NewScratch = (char*)CRealloc( Scratch, NewSize);
+		if ( !NewScratch )
+		{
+			Error( "Out of memory");
+			return nullptr;
+		}
+		Scratch = NewScratch;
+		ScratchSize = NewSize;
+	}
+	if ( memchr( Start, '\\', Len) )
+	{
+		if ( CJSONParser::Unescape( Scratch, Start, Len) == NPOS )
+		{
+			Error( "Malformed escape sequence");
+			return nullptr;
+		}
+	}
+	else
+	{
+		CMemcpy( Scratch, Start, Len);
+		Scratch[Len] = '\0';
+	}
+	return Scratch;
+}
+
+#endif
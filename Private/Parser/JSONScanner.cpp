@@ -0,0 +1,237 @@
+/*=============================================================================
+	Parser/JSONScanner.cpp:
+	Stage 1 JSON structural scanner.
+	Author: Fernando Velzquez
+
+	Character classification uses AVX2 or SSE2 compares where available,
+	the rest of the work is plain 64 bit arithmetic with one bit per byte.
+	See 'Parsing Gigabytes of JSON per Second' (Langdale, Lemire) for the
+	escape and string mask derivations.
+=============================================================================*/
+
+#include "../CacusLibPrivate.h"
+
+#include "Internal/CJSONScanner.h"
+
+#if defined(__AVX2__)
+	#include "immintrin.h"
+	#define JSON_SCAN_AVX2 1
+#elif (__i386__ || _M_IX86 || __x86_64__ || _M_X64) && ((_MSC_VER >= 1600) || (__GNUC__ >= 4))
+	#include "emmintrin.h"
+	#define JSON_SCAN_SSE2 1
+#endif
+
+#if defined(__PCLMUL__) && (__x86_64__ || _M_X64)
+	#include "wmmintrin.h"
+	#define JSON_SCAN_CLMUL 1
+#endif
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+#define EVEN_BITS 0x5555555555555555ULL
+
+
+//========= Bit helpers - begin ==========//
+//
+static FORCEINLINE uint32 CountTrailingZeros64( uint64 Value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return (uint32)__builtin_ctzll( Value);
+#elif defined(_M_X64)
+	unsigned long Result;
+	_BitScanForward64( &Result, Value);
+	return (uint32)Result;
+#else
+	unsigned long Result;
+	if ( (uint32)Value )
+	{
+		_BitScanForward( &Result, (uint32)Value);
+		return (uint32)Result;
+	}
+	_BitScanForward( &Result, (uint32)(Value >> 32));
+	return (uint32)Result + 32;
+#endif
+}
+
+//
+// Bit i of result is the xor of bits 0 to i of Value.
+// Turns a quote mask into a mask of string interiors.
+//
+static FORCEINLINE uint64 PrefixXor( uint64 Value)
+{
+#if JSON_SCAN_CLMUL
+	__m128i Result = _mm_clmulepi64_si128( _mm_set_epi64x( 0, (int64)Value), _mm_set1_epi8( (char)0xFF), 0);
+	return (uint64)_mm_cvtsi128_si64( Result);
+#else
+	Value ^= Value << 1;
+	Value ^= Value << 2;
+	Value ^= Value << 4;
+	Value ^= Value << 8;
+	Value ^= Value << 16;
+	Value ^= Value << 32;
+	return Value;
+#endif
+}
+
+//
+// Marks characters preceded by an odd length sequence of backslashes.
+// PrevOdd carries a sequence that ends the previous block.
+//
+static FORCEINLINE uint64 FindEscaped( uint64 Backslash, uint64& PrevOdd)
+{
+	uint64 StartEdges = Backslash & ~(Backslash << 1);
+	uint64 EvenStartMask = EVEN_BITS ^ PrevOdd;
+	uint64 EvenStarts = StartEdges & EvenStartMask;
+	uint64 OddStarts = StartEdges & ~EvenStartMask;
+	uint64 EvenCarries = Backslash + EvenStarts;
+	uint64 OddCarries = Backslash + OddStarts;
+	bool bEndsOdd = OddCarries < Backslash; //Sequence runs into next block
+	OddCarries |= PrevOdd;
+	PrevOdd = bEndsOdd ? 1 : 0;
+	uint64 EvenCarryEnds = EvenCarries & ~Backslash;
+	uint64 OddCarryEnds = OddCarries & ~Backslash;
+	return (EvenCarryEnds & ~EVEN_BITS) | (OddCarryEnds & EVEN_BITS);
+}
+//========= Bit helpers - end ==========//
+
+
+//========= Classification - begin ==========//
+//
+// Produces one bit per byte for each character class.
+// '{' and '[' (also '}' and ']') only differ by 0x20 so they're matched
+// with a single compare after setting that bit.
+// Null characters count as whitespace, in-situ parsing writes them over
+// whitespace before this has had a chance to scan it.
+//
+struct CJSONBlockMasks
+{
+	uint64 Quote;
+	uint64 Backslash;
+	uint64 Op;
+	uint64 Space;
+};
+
+#if JSON_SCAN_AVX2
+static FORCEINLINE void ClassifyBlock( const char* Block, CJSONBlockMasks& Masks)
+{
+	const __m256i Bit20 = _mm256_set1_epi8( 0x20);
+	Masks.Quote = Masks.Backslash = Masks.Op = Masks.Space = 0;
+	for ( uint32 i=0 ; i<64 ; i+=32 )
+	{
+		__m256i V = _mm256_loadu_si256( (const __m256i*)(Block + i));
+		__m256i V20 = _mm256_or_si256( V, Bit20);
+		__m256i Op = _mm256_or_si256(
+			_mm256_or_si256( _mm256_cmpeq_epi8( V20, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8( V20, _mm256_set1_epi8('}'))),
+			_mm256_or_si256( _mm256_cmpeq_epi8( V, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8( V, _mm256_set1_epi8(','))) );
+		__m256i Space = _mm256_or_si256(
+			_mm256_or_si256( _mm256_cmpeq_epi8( V, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8( V, _mm256_set1_epi8('\t'))),
+			_mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( V, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8( V, _mm256_set1_epi8('\n'))),
+			                 _mm256_cmpeq_epi8( V, _mm256_setzero_si256())) );
+		Masks.Quote     |= (uint64)(uint32)_mm256_movemask_epi8( _mm256_cmpeq_epi8( V, _mm256_set1_epi8('\x22'))) << i;
+		Masks.Backslash |= (uint64)(uint32)_mm256_movemask_epi8( _mm256_cmpeq_epi8( V, _mm256_set1_epi8('\\'))) << i;
+		Masks.Op        |= (uint64)(uint32)_mm256_movemask_epi8( Op) << i;
+		Masks.Space     |= (uint64)(uint32)_mm256_movemask_epi8( Space) << i;
+	}
+}
+#elif JSON_SCAN_SSE2
+static FORCEINLINE void ClassifyBlock( const char* Block, CJSONBlockMasks& Masks)
+{
+	const __m128i Bit20 = _mm_set1_epi8( 0x20);
+	Masks.Quote = Masks.Backslash = Masks.Op = Masks.Space = 0;
+	for ( uint32 i=0 ; i<64 ; i+=16 )
+	{
+		__m128i V = _mm_loadu_si128( (const __m128i*)(Block + i));
+		__m128i V20 = _mm_or_si128( V, Bit20);
+		__m128i Op = _mm_or_si128(
+			_mm_or_si128( _mm_cmpeq_epi8( V20, _mm_set1_epi8('{')), _mm_cmpeq_epi8( V20, _mm_set1_epi8('}'))),
+			_mm_or_si128( _mm_cmpeq_epi8( V, _mm_set1_epi8(':')), _mm_cmpeq_epi8( V, _mm_set1_epi8(','))) );
+		__m128i Space = _mm_or_si128(
+			_mm_or_si128( _mm_cmpeq_epi8( V, _mm_set1_epi8(' ')), _mm_cmpeq_epi8( V, _mm_set1_epi8('\t'))),
+			_mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( V, _mm_set1_epi8('\r')), _mm_cmpeq_epi8( V, _mm_set1_epi8('\n'))),
+			              _mm_cmpeq_epi8( V, _mm_setzero_si128())) );
+		Masks.Quote     |= (uint64)(uint32)_mm_movemask_epi8( _mm_cmpeq_epi8( V, _mm_set1_epi8('\x22'))) << i;
+		Masks.Backslash |= (uint64)(uint32)_mm_movemask_epi8( _mm_cmpeq_epi8( V, _mm_set1_epi8('\\'))) << i;
+		Masks.Op        |= (uint64)(uint32)_mm_movemask_epi8( Op) << i;
+		Masks.Space     |= (uint64)(uint32)_mm_movemask_epi8( Space) << i;
+	}
+}
+#else
+static FORCEINLINE void ClassifyBlock( const char* Block, CJSONBlockMasks& Masks)
+{
+	Masks.Quote = Masks.Backslash = Masks.Op = Masks.Space = 0;
+	for ( uint32 i=0 ; i<64 ; i++ )
+	{
+		uint64 Bit = 1ULL << i;
+		switch ( Block[i] )
+		{
+		case '\x22': Masks.Quote |= Bit;     break;
+		case '\\':   Masks.Backslash |= Bit; break;
+		case '{': case '}': case '[': case ']': case ':': case ',':
+		             Masks.Op |= Bit;        break;
+		case ' ': case '\t': case '\r': case '\n': case '\0':
+		             Masks.Space |= Bit;     break;
+		default:                             break;
+		}
+	}
+}
+#endif
+//========= Classification - end ==========//
+
+
+CJSONScanner::CJSONScanner( const char* InBase, size_t InLen)
+	: Base(InBase)
+	, Len(InBase ? InLen : 0)
+	, ScanOffset(0)
+	, PrevEscaped(0)
+	, PrevInString(0)
+	, PrevScalar(0)
+	, Pos(0)
+	, Count(0)
+{
+}
+
+//
+// Returns the token start mask of a 64 byte block.
+//
+uint64 CJSONScanner::ScanBlock( const char* Block)
+{
+	CJSONBlockMasks Masks;
+	ClassifyBlock( Block, Masks);
+
+	uint64 Quote = Masks.Quote & ~FindEscaped( Masks.Backslash, PrevEscaped);
+	uint64 InString = PrefixXor( Quote) ^ PrevInString; //Includes opening quote, excludes closing quote
+	PrevInString = (uint64)((int64)InString >> 63);
+
+	uint64 Scalar = ~(Masks.Op | Masks.Space | Quote);
+	uint64 ScalarStart = Scalar & ~((Scalar << 1) | PrevScalar);
+	PrevScalar = Scalar >> 63;
+
+	return ((Masks.Op | ScalarStart) & ~InString) | Quote;
+}
+
+//
+// Scans blocks until the index window is full or the text ends.
+// The last block is padded with whitespace.
+//
+bool CJSONScanner::Refill()
+{
+	Pos = Count = 0;
+	while ( (ScanOffset < Len) && (Count <= INDEX_SIZE - 64) )
+	{
+		const char* Start = Base + ScanOffset;
+		const char* Block = Start;
+		char Tail[64];
+		if ( Len - ScanOffset < 64 )
+		{
+			memset( Tail, ' ', sizeof(Tail));
+			CMemcpy( Tail, Start, Len - ScanOffset);
+			Block = Tail;
+		}
+		for ( uint64 Tokens=ScanBlock(Block) ; Tokens ; Tokens&=Tokens-1 )
+			Indices[Count++] = Start + CountTrailingZeros64( Tokens);
+		ScanOffset += 64;
+	}
+	return Count != 0;
+}
@@ -0,0 +1,229 @@
+/*=============================================================================
+	Parser/JSONWriter.cpp:
+	Direct JSON writer for the CField property system.
+	Author: Fernando Velzquez
+=============================================================================*/
+
+#include "../CacusLibPrivate.h"
+
+#include "CacusString.h"
+#include "Parser/JSONWriter.h"
+
+#if USES_CACUS_FIELD
+
+static const CName NAME_Class("Class");
+
+#define JSON_BATCH_SIZE 64 //Array elements converted per ExportPrimitives call
+
+//
+// Escape sequence for every byte, zero if the byte is written as is.
+// Control characters without a short form are written as \u00XX.
+//
+static const char JSON_EscapeTable[256] =
+{
+	'u','u','u','u','u','u','u','u','b','t','n','u','f','r','u','u',
+	'u','u','u','u','u','u','u','u','u','u','u','u','u','u','u','u',
+	 0,  0, '\x22',0, 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, '\\', 0,  0,  0,
+};
+
+// Values that can be written without quotes (numbers, true, false)
+static bool JSON_IsLiteral( const char* Text)
+{
+	if ( !*Text )
+		return false;
+	for ( ; *Text ; Text++ )
+	{
+		char C = *Text;
+		if ( !((C >= 'a' && C <= 'z') || (C >= '0' && C <= '9') || (C == '-') || (C == '+') || (C == '.') || (C == 'E')) )
+			return false;
+	}
+	return true;
+}
+
+
+CJSONWriter::CJSONWriter( std::string& InOut, bool bInDelta)
+	: Out(InOut)
+	, bDelta(bInDelta)
+{
+}
+
+void CJSONWriter::WriteString( std::string& Out, const char* Text, size_t Len)
+{
+	static const char HexDigits[] = "0123456789abcdef";
+	Out += '\x22';
+	const char* Run = Text;
+	const char* End = Text + Len;
+	for ( ; Text<End ; Text++ )
+	{
+		char Escape = JSON_EscapeTable[(uint8)*Text];
+		if ( Escape )
+		{
+			Out.append( Run, Text - Run);
+			Out += '\\';
+			Out += Escape;
+			if ( Escape == 'u' )
+			{
+				Out += "00";
+				Out += HexDigits[(uint8)*Text >> 4];
+				Out += HexDigits[(uint8)*Text & 15];
+			}
+			Run = Text + 1;
+		}
+	}
+	Out.append( Run, End - Run);
+	Out += '\x22';
+}
+
+void CJSONWriter::WriteValue( const CProperty* Property, void* From)
+{
+	void* Object;
+	size_t Count;
+	const CStruct* Struct = Property->ExportObject( From, Object);
+	if ( Struct )
+		WriteObject( Struct, Object);
+	else if ( Property->ExportArray( From, Count) )
+	{
+		const CProperty* Inner = Property->GetInner();
+		Out += '[';
+		if ( !Count || !WriteStructArray( Property, From, Count) )
+			for ( size_t i=0 ; i<Count ; i++ )
+			{
+				if ( i )
+					Out += ',';
+				WriteValue( Inner, Property->ExportArrayElement( From, i));
+			}
+		Out += ']';
+	}
+	else
+		WriteText( Property, Property->String( From));
+}
+
+void CJSONWriter::WriteObject( const CStruct* Struct, void* Object)
+{
+	Out += '{';
+	if ( Object )
+	{
+		bool bFirst = true;
+		CProperty* ClassProp = Struct->FindProperty( NAME_Class);
+		if ( ClassProp ) //Polymorphic object, write real class first
+		{
+			const char* ClassName = ClassProp->String( Object);
+			CStruct* RealStruct = GetStruct( ClassName);
+			if ( RealStruct )
+				Struct = RealStruct;
+			if ( ClassProp->ShouldExport( Object) )
+			{
+				WriteKey( NAME_Class, bFirst);
+				WriteString( Out, ClassName, CStrlen(ClassName));
+			}
+		}
+		size_t Row = ExportPrimitives( Struct, Object, 0, 1);
+		WriteStructProperties( Struct, Object, bFirst, Row);
+		Scratch.resize( Row);
+	}
+	Out += '}';
+}
+
+//
+// Arrays of non polymorphic structs held by value convert the primitive
+// properties of a batch of elements at once.
+//
+bool CJSONWriter::WriteStructArray( const CProperty* Property, void* From, size_t Count)
+{
+	const CProperty* Inner = Property->GetInner();
+	if ( Inner->IsPointer() )
+		return false;
+	void* First;
+	uint8* FirstElement = (uint8*)Property->ExportArrayElement( From, 0);
+	const CStruct* Struct = Inner->ExportObject( FirstElement, First);
+	if ( !Struct || !Struct->PrimitiveGroupEnd[PRIMITIVE_MAX-1] || Struct->FindProperty( NAME_Class) )
+		return false;
+	size_t Stride = Inner->ElementSize;
+	if ( (uint8*)Property->ExportArrayElement( From, Count - 1) != FirstElement + Stride * (Count - 1) ) //Not contiguous
+		return false;
+
+	size_t RowSize = Struct->PropertyCount * CStruct::PRIMITIVE_TEXT_SIZE;
+	for ( size_t Start=0 ; Start<Count ; Start+=JSON_BATCH_SIZE )
+	{
+		size_t BatchCount = Min<size_t>( Count - Start, JSON_BATCH_SIZE);
+		uint8* Objects = (uint8*)First + Stride * Start;
+		size_t Rows = ExportPrimitives( Struct, Objects, Stride, BatchCount);
+		for ( size_t i=0 ; i<BatchCount ; i++ )
+		{
+			if ( Start + i )
+				Out += ',';
+			Out += '{';
+			bool bFirst = true;
+			WriteStructProperties( Struct, Objects + Stride * i, bFirst, Rows + RowSize * i);
+			Out += '}';
+		}
+		Scratch.resize( Rows);
+	}
+	return true;
+}
+
+// Converts primitive properties into text rows at the end of Scratch, returns the first row's offset
+size_t CJSONWriter::ExportPrimitives( const CStruct* Struct, void* Objects, size_t Stride, size_t Count)
+{
+	size_t Rows = Scratch.size();
+	if ( Struct->PrimitiveGroupEnd[PRIMITIVE_MAX-1] )
+	{
+		Scratch.resize( Rows + Count * Struct->PropertyCount * CStruct::PRIMITIVE_TEXT_SIZE);
+		Struct->ExportPrimitives( Objects, Stride, Count, &Scratch[Rows]);
+	}
+	return Rows;
+}
+
+void CJSONWriter::WriteStructProperties( const CStruct* Struct, void* Object, bool& bFirst, size_t Row)
+{
+	for ( uint32 i=0 ; i<Struct->PropertyCount ; i++ )
+	{
+		const CProperty* Link = Struct->PropertyTable[i];
+		if ( Struct->PrimitiveTypes[i] ) //Text already in row
+		{
+			if ( bDelta ? Link->ShouldExport( Object, Link->Parent->DefaultObject) : !(Link->PropertyFlags & PF_NoExport) )
+			{
+				const char* Text = &Scratch[Row + i * CStruct::PRIMITIVE_TEXT_SIZE];
+				WriteKey( Link->NameHandle, bFirst);
+				if ( JSON_IsLiteral( Text) )
+					Out += Text;
+				else
+					WriteString( Out, Text, CStrlen(Text));
+			}
+		}
+		else if ( (Link->NameHandle != NAME_Class) && Link->ShouldExport( Object, bDelta ? Link->Parent->DefaultObject : nullptr) )
+		{
+			WriteKey( Link->NameHandle, bFirst);
+			WriteValue( Link, Object);
+		}
+	}
+}
+
+void CJSONWriter::WriteKey( const CName& Key, bool& bFirst)
+{
+	if ( !bFirst )
+		Out += ',';
+	bFirst = false;
+	WriteString( Out, *Key, Key.Len());
+	Out += ':';
+}
+
+void CJSONWriter::WriteText( const CProperty* Property, const char* Text)
+{
+	if ( !*Text )
+	{
+		if ( Property->IsText() && !(Property->PropertyFlags & PF_NullDefault) )
+			Out += "\x22\x22";
+		else
+			Out += "null";
+	}
+	else if ( !Property->IsText() && JSON_IsLiteral( Text) )
+		Out += Text;
+	else
+		WriteString( Out, Text, CStrlen(Text));
+}
+
+#endif
@@ -12,48 +12,202 @@
 #include "CacusMem.h"
 #include "Parser/Line.h"
 
-static const char* DefaultLineBreaks8[] =
+#if (__i386__ || _M_IX86 || __x86_64__ || _M_X64) && ((_MSC_VER >= 1600) || (__GNUC__ >= 4))
+	#include "emmintrin.h"
+	#define LINE_SCAN_SSE2 1
+#endif
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+//
+// Default line breaks in every supported width.
+//
+template<typename CHAR> struct TDefaultLineBreaks
 {
-	"\r\n",
-	"\n",
-	"\r",
+	static const CHAR* Array[3];
 };
+template<> const char*    TDefaultLineBreaks<char>::Array[3]    = {  "\r\n",  "\n",  "\r" };
+template<> const char16*  TDefaultLineBreaks<char16>::Array[3]  = { u"\r\n", u"\n", u"\r" };
+template<> const char32*  TDefaultLineBreaks<char32>::Array[3]  = { U"\r\n", U"\n", U"\r" };
+template<> const wchar_t* TDefaultLineBreaks<wchar_t>::Array[3] = { L"\r\n", L"\n", L"\r" };
 
-static const char* DefaultLineArray[] =
+// Empty results, shared by all widths
+static const void* DefaultLineArray[] =
 {
 	nullptr
 };
 
+static const struct
+{
+	const void* Start;
+	size_t      Len;
+} DefaultViewArray[] =
+{
+	{ nullptr, 0 }
+};
 
+// Character value, not sign extended
+template<typename CHAR> static FORCEINLINE uint32 LineCharCode( CHAR C)
+{
+	return (sizeof(CHAR) == 1) ? (uint32)(uint8)C : (sizeof(CHAR) == 2) ? (uint32)(uint16)C : (uint32)C;
+}
 
+
+
+//========= Line break matcher - begin ==========//
 //
-// Checks if the Token matches the start of the String
+// Line breaks are compiled into a table holding the breaks that start
+// with each character (by low byte for wider chars), so only those are
+// tested at a position.
+// The scanner skips to the next character that may start a break or end
+// the text, with SSE2 compares of 16 bytes at once if there's up to
+// four of them (the default set needs '\r', '\n' and '\0').
 //
-template<typename CHAR> inline bool templ_strcmp_token( const CHAR* String, const CHAR* Token)
+#define LINE_MAX_MATCHED_BREAKS 31
+#define LINE_TERMINATOR_BIT     0x80000000
+
+static FORCEINLINE uint32 CountTrailingZeros32( uint32 Value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return (uint32)__builtin_ctz( Value);
+#else
+	unsigned long Result;
+	_BitScanForward( &Result, Value);
+	return (uint32)Result;
+#endif
+}
+
+template<typename CHAR> CLineBreakMatcher::CLineBreakMatcher( const CHAR** Breaks, size_t BreakCount)
+{
+	Compile( Breaks, BreakCount);
+}
+
+template<typename CHAR> void CLineBreakMatcher::Compile( const CHAR** Breaks, size_t BreakCount)
 {
-	while ( *Token != '\0' )
+	ScanCharCount = 0;
+	bMatchAll = (BreakCount > LINE_MAX_MATCHED_BREAKS);
+	memset( StartMask, 0, sizeof(StartMask));
+	StartMask[0] = LINE_TERMINATOR_BIT;
+	ScanChars[0] = 0;
+	uint32 CharCount = 1;
+	for ( size_t i=0 ; i<BreakCount ; i++ )
 	{
-		if( *String != *Token )
-			return false;
-		String++;
-		Token++;
+		if ( !*Breaks[i] ) //Empty breaks never match
+			continue;
+		uint32 Code = LineCharCode( *Breaks[i]);
+		StartMask[Code & 0xFF] |= bMatchAll ? LINE_TERMINATOR_BIT : (1u << i);
+
+		bool bKnown = false;
+		for ( uint32 j=0 ; j<Min<uint32>( CharCount, ARRAY_COUNT(ScanChars)) ; j++ )
+			bKnown |= (ScanChars[j] == Code);
+		if ( !bKnown && (CharCount++ < ARRAY_COUNT(ScanChars)) )
+			ScanChars[CharCount-1] = Code;
+	}
+	if ( CharCount <= ARRAY_COUNT(ScanChars) )
+	{
+		ScanCharCount = CharCount;
+		for ( uint32 i=CharCount ; i<ARRAY_COUNT(ScanChars) ; i++ ) //Pad with repeats
+			ScanChars[i] = ScanChars[0];
 	}
-	return true;
 }
 
+//
+// Returns the first character at or after Text that may start a line
+// break or is a null terminator, End if there's none.
+//
+template<typename CHAR> const CHAR* CLineBreakMatcher::Find( const CHAR* Text, const CHAR* End) const
+{
+#if LINE_SCAN_SSE2
+	if ( ScanCharCount )
+	{
+		const uint32 Width = (uint32)sizeof(CHAR);
+		const uint32 BlockChars = 16 / Width;
+		__m128i Chars[4];
+		for ( uint32 i=0 ; i<4 ; i++ )
+			Chars[i] = (Width == 1) ? _mm_set1_epi8( (char)ScanChars[i])
+			         : (Width == 2) ? _mm_set1_epi16( (short)ScanChars[i])
+			         :                _mm_set1_epi32( (int)ScanChars[i]);
+		for ( ; (size_t)(End - Text) >= BlockChars ; Text += BlockChars )
+		{
+			__m128i Block = _mm_loadu_si128( (const __m128i*)Text);
+			__m128i Match;
+			if ( Width == 1 )
+				Match = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( Block, Chars[0]), _mm_cmpeq_epi8( Block, Chars[1]))
+				                    , _mm_or_si128( _mm_cmpeq_epi8( Block, Chars[2]), _mm_cmpeq_epi8( Block, Chars[3])) );
+			else if ( Width == 2 )
+				Match = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi16( Block, Chars[0]), _mm_cmpeq_epi16( Block, Chars[1]))
+				                    , _mm_or_si128( _mm_cmpeq_epi16( Block, Chars[2]), _mm_cmpeq_epi16( Block, Chars[3])) );
+			else
+				Match = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi32( Block, Chars[0]), _mm_cmpeq_epi32( Block, Chars[1]))
+				                    , _mm_or_si128( _mm_cmpeq_epi32( Block, Chars[2]), _mm_cmpeq_epi32( Block, Chars[3])) );
+			uint32 Mask = (uint32)_mm_movemask_epi8( Match);
+			if ( Mask )
+				return Text + CountTrailingZeros32( Mask) / Width;
+		}
+	}
+#endif
+	for ( ; Text < End ; Text++ )
+		if ( StartMask[LineCharCode(*Text) & 0xFF] )
+			return Text;
+	return End;
+}
 
+//
+// Tests the breaks that start with the character at Text, in order.
+// Returns the index of the first one that matches, MATCH_None or
+// MATCH_Partial if the text ends before a break can be ruled out (only
+// if more text may follow).
+//
+template<typename CHAR> int32 CLineBreakMatcher::Match( const CHAR** Breaks, size_t BreakCount, const CHAR* Text, const CHAR* End, bool bFinal) const
+{
+	uint32 Candidates = StartMask[LineCharCode(*Text) & 0xFF] & ~LINE_TERMINATOR_BIT;
+	for ( size_t i=0 ; bMatchAll ? (i<BreakCount) : (Candidates != 0) ; i++ )
+	{
+		if ( !bMatchAll )
+		{
+			i = CountTrailingZeros32( Candidates);
+			Candidates &= Candidates - 1;
+		}
+		const CHAR* Break = Breaks[i];
+		if ( !*Break )
+			continue;
+		const CHAR* Pos = Text;
+		for ( ; *Break && (Pos < End) && (*Pos == *Break) ; Pos++, Break++ );
+		if ( !*Break )
+			return (int32)i;
+		if ( (Pos == End) && !bFinal )
+			return MATCH_Partial;
+	}
+	return MATCH_None;
+}
+
+#define LINE_INSTANTIATE_MATCHER(CHAR) \
+	template CLineBreakMatcher::CLineBreakMatcher( const CHAR** Breaks, size_t BreakCount); \
+	template void CLineBreakMatcher::Compile( const CHAR** Breaks, size_t BreakCount); \
+	template const CHAR* CLineBreakMatcher::Find( const CHAR* Text, const CHAR* End) const; \
+	template int32 CLineBreakMatcher::Match( const CHAR** Breaks, size_t BreakCount, const CHAR* Text, const CHAR* End, bool bFinal) const;
+LINE_INSTANTIATE_MATCHER(char)
+LINE_INSTANTIATE_MATCHER(char16)
+LINE_INSTANTIATE_MATCHER(char32)
+LINE_INSTANTIATE_MATCHER(wchar_t)
+//========= Line break matcher - end ==========//
 
-CParserFastLine8::CParserFastLine8()
+
+
+template<typename CHAR> CParserFastLine<CHAR>::CParserFastLine()
 	: LineCount(0)
-	, LineArray(DefaultLineArray)
+	, LineArray((const CHAR**)DefaultLineArray)
+	, ViewArray((const LineView*)DefaultViewArray)
 	, Data(nullptr)
-	, LineBreakCount(ArrayCount(DefaultLineBreaks8))
-	, LineBreakArray(DefaultLineBreaks8)
+	, LineBreakCount(ArrayCount(TDefaultLineBreaks<CHAR>::Array))
+	, LineBreakArray(TDefaultLineBreaks<CHAR>::Array)
 {
 }
 
 
-CParserFastLine8::~CParserFastLine8()
+template<typename CHAR> CParserFastLine<CHAR>::~CParserFastLine()
 {
 	if ( Data )
 	{
@@ -66,23 +220,48 @@ CParserFastLine8::~CParserFastLine8()
 // 
 // Replaces tokens used to separate lines.
 //
-void CParserFastLine8::SetLineBreaks( const char** NewLineBreakArray, size_t NewLineBreakCount)
+template<typename CHAR> void CParserFastLine<CHAR>::SetLineBreaks( const CHAR** NewLineBreakArray, size_t NewLineBreakCount)
 {
 	LineBreakArray = NewLineBreakArray;
 	LineBreakCount = NewLineBreakCount;
 }
 
 
-//========= CParserFastLine8::Parse - begin ==========//
+//========= CParserFastLine::Parse - begin ==========//
 // 
 // Parses given Text into a line array of char streams.
 // The parser uses a single memory allocation to store all of the resulting data.
 // 
 // <bool> return value - Parsing finished without errors.
 //
-bool CParserFastLine8::Parse( const char* Text)
+template<typename CHAR> bool CParserFastLine<CHAR>::Parse( const CHAR* Text)
+{
+	return ParseLines( Text, Text ? CStrlen(Text) : 0, RESULT_Copy);
+}
+
+template<typename CHAR> bool CParserFastLine<CHAR>::Parse( const CHAR* Text, size_t Len)
+{
+	return ParseLines( Text, Len, RESULT_Copy);
+}
+
+//
+// Lines are spans into Text, nothing is copied.
+//
+template<typename CHAR> bool CParserFastLine<CHAR>::ParseView( const CHAR* Text, size_t Len)
+{
+	return ParseLines( Text, Len, RESULT_View);
+}
+
+//
+// Line breaks in Text are replaced with null terminators.
+//
+template<typename CHAR> bool CParserFastLine<CHAR>::ParseInSitu( CHAR* Text)
+{
+	return ParseLines( Text, Text ? CStrlen(Text) : 0, RESULT_InSitu);
+}
+
+template<typename CHAR> bool CParserFastLine<CHAR>::ParseLines( const CHAR* Text, size_t Len, EResultMode Mode)
 {
-	typedef char CHAR;
 	struct LineInfo
 	{
 		LineInfo*   Next;
@@ -92,36 +271,44 @@ bool CParserFastLine8::Parse( const char* Text)
 
 	// Set defaults
 	LineCount = 0;
-	LineArray = DefaultLineArray;
+	LineArray = (const CHAR**)DefaultLineArray;
+	ViewArray = (const LineView*)DefaultViewArray;
 	if ( Data )
 		CFree(Data);
 	Data = nullptr;
 
-	if ( !Text || (*Text == '\0') )
+	if ( !Text || !Len || (*Text == '\0') )
 		return false;
 
 	CMemExStack MemStack;
 	LineInfo* LineInfoChain = nullptr;
 
 	const CHAR* CurLineStart = Text;
+	const CHAR* End = Text + Len;
+
+	CLineBreakMatcher Matcher( LineBreakArray, LineBreakCount);
 
 NEXT_CHAR:
+	Text = Matcher.Find( Text, End);
+
 	// End of text
-	if ( *Text == '\0')
+	if ( (Text == End) || (*Text == '\0') )
 	{
 		LineInfoChain = new(MemStack) LineInfo{LineInfoChain, CurLineStart, Text};
 		goto END_OF_TEXT;
 	}
 
 	// Token
-	for ( size_t i=0; i<LineBreakCount; i++)
-		if ( templ_strcmp_token(Text, LineBreakArray[i]) )
+	{
+		int32 Break = Matcher.Match( LineBreakArray, LineBreakCount, Text, End, true);
+		if ( Break >= 0 )
 		{
 			LineInfoChain = new(MemStack) LineInfo{LineInfoChain, CurLineStart, Text};
-			Text += CStrlen(LineBreakArray[i]);
+			Text += CStrlen(LineBreakArray[Break]);
 			CurLineStart = Text;
 			goto NEXT_CHAR;
 		}
+	}
 
 	Text++;
 	goto NEXT_CHAR;
@@ -134,11 +321,47 @@ END_OF_TEXT:
 	{
 		LineInfoCount++;
 
-		size_t RequiredMemory = (((size_t)Link->LineEnd) - ((size_t)Link->LineStart)) + sizeof(CHAR);
-		LineMemorySize = Align(LineMemorySize + RequiredMemory, EALIGN_PLATFORM_PTR);
+		if ( Mode == RESULT_Copy )
+		{
+			size_t RequiredMemory = (((size_t)Link->LineEnd) - ((size_t)Link->LineStart)) + sizeof(CHAR);
+			LineMemorySize = Align(LineMemorySize + RequiredMemory, EALIGN_PLATFORM_PTR);
+		}
 	}
-	LineMemorySize += EALIGN_PLATFORM_PTR * (LineInfoCount+1+1); // Add space for LineArray, and safety padding
 
+	// Views and in-situ lines only need the array
+	if ( Mode != RESULT_Copy )
+	{
+		size_t EntrySize = (Mode == RESULT_View) ? sizeof(LineView) : sizeof(CHAR*);
+		CScopeMem NewData( EntrySize * (LineInfoCount+1));
+		LineView* NewViewArray = NewData.GetArray<LineView>();
+		CHAR** NewLineArray = NewData.GetArray<CHAR*>();
+		size_t i = LineInfoCount;
+		if ( Mode == RESULT_View )
+			NewViewArray[i] = LineView{ nullptr, 0};
+		else
+			NewLineArray[i] = nullptr;
+		for ( LineInfo* Link=LineInfoChain; Link; Link=Link->Next)
+		{
+			i--;
+			if ( Mode == RESULT_View )
+				NewViewArray[i] = LineView{ Link->LineStart, (size_t)(Link->LineEnd - Link->LineStart)};
+			else
+			{
+				CHAR* LineEnd = (CHAR*)Link->LineEnd;
+				*LineEnd = '\0';
+				NewLineArray[i] = (CHAR*)Link->LineStart;
+			}
+		}
+		LineCount = LineInfoCount;
+		if ( Mode == RESULT_View )
+			ViewArray = NewViewArray;
+		else
+			LineArray = (const CHAR**)NewLineArray;
+		Data = NewData.Detach();
+		return true;
+	}
+
+	LineMemorySize += EALIGN_PLATFORM_PTR * (LineInfoCount+1+1); // Add space for LineArray, and safety padding
 	// Prepare data chunk
 	// Uses ScopedMemory for automatic deallocation upon failure
 	CScopeMem NewData(LineMemorySize);
@@ -176,8 +399,182 @@ END_OF_TEXT:
 
 
 	LineCount = LineInfoCount;
-	LineArray = (const char**)NewLineArray;
+	LineArray = (const CHAR**)NewLineArray;
 	Data = NewData.Detach();
 	return true;
 }
-//========= CParserFastLine8::Parse - end ==========//
+//========= CParserFastLine::Parse - end ==========//
+
+template class CParserFastLine<char>;
+template class CParserFastLine<char16>;
+template class CParserFastLine<char32>;
+template class CParserFastLine<wchar_t>;
+
+
+/*-----------------------------------------------------------------------------
+	CParserStreamLine8.
+-----------------------------------------------------------------------------*/
+
+CParserStreamLine8::CParserStreamLine8()
+	: Matcher(TDefaultLineBreaks<char>::Array, ArrayCount(TDefaultLineBreaks<char>::Array))
+	, LineBreakCount(ArrayCount(TDefaultLineBreaks<char>::Array))
+	, LineBreakArray(TDefaultLineBreaks<char>::Array)
+	, MaxBreakLen(2)
+	, Pos(nullptr)
+	, End(nullptr)
+	, Carry(nullptr)
+	, CarryLen(0)
+	, CarrySize(0)
+	, CarryScan(0)
+	, CarryConsumed(0)
+	, bFinished(false)
+{
+}
+
+CParserStreamLine8::~CParserStreamLine8()
+{
+	if ( Carry )
+		CFree( Carry);
+}
+
+void CParserStreamLine8::SetLineBreaks( const char** NewLineBreakArray, size_t NewLineBreakCount)
+{
+	LineBreakArray = NewLineBreakArray;
+	LineBreakCount = NewLineBreakCount;
+	Matcher.Compile( LineBreakArray, LineBreakCount);
+	MaxBreakLen = 1; //Null terminators are found even without breaks, always take them
+	for ( size_t i=0 ; i<LineBreakCount ; i++ )
+		MaxBreakLen = Max<size_t>( MaxBreakLen, CStrlen(LineBreakArray[i]));
+}
+
+//
+// Unread data of the previous chunk is moved into the carry.
+//
+void CParserStreamLine8::Feed( const char* Data, size_t Len)
+{
+	if ( Pos < End )
+	{
+		if ( !CarryLen )
+			CarryScan = 0;
+		AppendCarry( Pos, End - Pos);
+	}
+	Pos = Data;
+	End = Data + Len;
+}
+
+void CParserStreamLine8::Finish()
+{
+	bFinished = true;
+}
+
+void CParserStreamLine8::Reset()
+{
+	Pos = End = nullptr;
+	CarryLen = CarryScan = CarryConsumed = 0;
+	bFinished = false;
+}
+
+//========= CParserStreamLine8::Next - begin ==========//
+//
+// Lines fully contained in the chunk are returned in place.
+// Otherwise the chunk is moved into the carry up to the next character
+// that may start a line break (and as many characters as the longest
+// break), until the carry holds a complete line or the chunk runs out.
+//
+bool CParserStreamLine8::Next( const char*& OutLine, size_t& OutLen)
+{
+	if ( CarryConsumed ) //Remove line returned by last call
+	{
+		CarryLen -= CarryConsumed;
+		memmove( Carry, Carry + CarryConsumed, CarryLen);
+		CarryConsumed = 0;
+		CarryScan = 0;
+	}
+
+	const char* LineEnd;
+	const char* NextLine;
+	const char* Resume;
+	if ( !CarryLen && (Pos < End) )
+	{
+		if ( ScanLine( Pos, End, bFinished, LineEnd, NextLine, Resume) )
+		{
+			OutLine = Pos;
+			OutLen = LineEnd - Pos;
+			Pos = NextLine;
+			return true;
+		}
+		AppendCarry( Pos, End - Pos);
+		CarryScan = Resume - Pos;
+		Pos = End;
+	}
+
+	while ( CarryLen )
+	{
+		if ( ScanLine( Carry + CarryScan, Carry + CarryLen, bFinished && (Pos == End), LineEnd, NextLine, Resume) )
+		{
+			Carry[LineEnd - Carry] = '\0'; //Overwrites the line break
+			OutLine = Carry;
+			OutLen = LineEnd - Carry;
+			CarryConsumed = NextLine - Carry;
+			return true;
+		}
+		CarryScan = Resume - Carry;
+		if ( Pos == End )
+			break;
+		const char* Found = Matcher.Find( Pos, End);
+		size_t Take = (Found - Pos) + Min<size_t>( End - Found, MaxBreakLen);
+		AppendCarry( Pos, Take);
+		Pos += Take;
+	}
+
+	if ( bFinished && CarryLen ) //Last line has no line break
+	{
+		AppendCarry( "", 1);
+		OutLine = Carry;
+		OutLen = --CarryLen;
+		CarryConsumed = CarryLen;
+		return true;
+	}
+	return false;
+}
+//========= CParserStreamLine8::Next - end ==========//
+
+//
+// Finds the first line break in Text, OutResume is set to the position
+// where the search must resume once more text is available.
+//
+bool CParserStreamLine8::ScanLine( const char* Text, const char* TextEnd, bool bFinal, const char*& OutLineEnd, const char*& OutNext, const char*& OutResume) const
+{
+	for ( ; ; Text++ )
+	{
+		Text = Matcher.Find( Text, TextEnd);
+		if ( Text == TextEnd )
+		{
+			OutResume = TextEnd;
+			return false;
+		}
+		int32 Break = Matcher.Match( LineBreakArray, LineBreakCount, Text, TextEnd, bFinal);
+		if ( Break >= 0 )
+		{
+			OutLineEnd = Text;
+			OutNext = Text + CStrlen(LineBreakArray[Break]);
+			return true;
+		}
+		if ( Break == CLineBreakMatcher::MATCH_Partial )
+		{
+			OutResume = Text;
+			return false;
+		}
+	}
+}
+
+void CParserStreamLine8::AppendCarry( const char* Start, size_t Len)
+{
+	if ( CarryLen + Len > CarrySize )
+	{
+		CarrySize = Max<size_t>( CarryLen + Len, Max<size_t>( CarrySize * 2, 256));
+		Carry = (char*)CRealloc( Carry, CarrySize);
+	}
+	CMemcpy( Carry + CarryLen, Start, Len);
+	CarryLen += Len;
+}
@@ -40,6 +40,8 @@
 #include "CacusMem.h"
 #include "Parser/Base.h"
 #include "Parser/XML.h"
+#include "CacusThread.h"
+#include "DebugCallback.h"
 
 #include <tuple>
 
@@ -73,8 +75,8 @@ namespace XMLParser
 		bool ParseAttributeValue( const CHAR*& Stream);
 		bool ProcessSpecialCharacters( CMemExStack& Mem);
 
-		size_t Length()       { return (size_t) (End - Start); }
-		size_t OutputMemory() { return (Length()+1) * sizeof(CHAR); }
+		size_t Length() const { return (size_t) (End - Start); }
+		size_t OutputMemory() const { return (Length()+1) * sizeof(CHAR); }
 		CHAR* OutputToBlock( CHAR*& StringBlock);
 
 
@@ -101,6 +103,8 @@ namespace XMLParser
 		{}
 	};
 
+	struct Counter;
+
 	// Used to represent an element and keep track of tree structure
 	template <typename CHAR> struct Element
 	{
@@ -124,12 +128,36 @@ namespace XMLParser
 		{}
 
 		bool AttachTo( Element<CHAR>* NewParent);
-		void ParseAttributes( const CHAR*& Stream, CMemExStack& Mem);
+		bool ParseAttributes( const CHAR*& Stream, CMemExStack& Mem, Counter& Count);
+	};
+
+	// Running totals checked against the parser limits while the tree is built
+	struct Counter
+	{
+		const CParserFastXML::CLimits& Limits;
+		uint32 Depth;
+		size_t Nodes;
+		size_t Attributes;
+		size_t Memory;
+
+		Counter( const CParserFastXML::CLimits& InLimits)
+			: Limits(InLimits)
+			, Depth(0)
+			, Nodes(0)
+			, Attributes(0)
+			, Memory(0)
+		{}
+
+		bool AddDepth();
+		bool AddNode( size_t Bytes);
+		bool AddAttribute( size_t Bytes);
+		bool AddMemory( size_t Bytes);
 	};
 
 	template <typename CHAR> bool IsAttributeSeparator( const CHAR C);
 	template <typename CHAR> uint32 ParseDecCharacter( const CHAR* Token);
 	template <typename CHAR> uint32 ParseHexCharacter( const CHAR* Token);
+	template <typename CHAR> size_t EncodeCharacter( CHAR* Out, uint32 C);
 };
 
 
@@ -149,30 +177,161 @@ void CParserFastXML::Empty()
 		CFree(Data);
 		Data = nullptr;
 	}
+	if ( IndexData )
+	{
+		CFree(IndexData);
+		IndexData = nullptr;
+	}
 	Root = nullptr;
+	CharSize = 0;
+	NodeCount = 0;
+}
+
+
+//========= CParserFastXML::BuildIndex - begin ==========//
+//
+// Builds a (parent,name) hash table pointing to the first child element
+// with each name and links siblings with the same name, so browser steps
+// don't scan sibling lists.
+// Names are hashed from the element text (case-insensitive, like the
+// linear search) so the index doesn't depend on the global name table.
+// Nodes are laid out in document order, so processing them backwards
+// leaves the table pointing at the first sibling of each name.
+//
+template <typename CHAR> static FORCEINLINE uint32 XMLNameHash( const CHAR* Name)
+{
+	uint32 Hash = 2166136261u; //FNV-1a
+	for ( ; *Name; Name++)
+		Hash = (Hash ^ (uint32)CChrToUpper(*Name)) * 16777619u;
+	return Hash;
+}
+
+static FORCEINLINE uint32 XMLIndexHash( uint32 Parent, uint32 NameHash)
+{
+	return (Parent * 0x9E3779B1) ^ (NameHash * 0x85EBCA6B);
+}
+
+bool CParserFastXML::BuildIndex()
+{
+	if ( IndexData )
+		return true;
+	if ( !Root )
+		return false;
+
+	uint32 TableSize = 16;
+	while ( TableSize < NodeCount * 2 )
+		TableSize *= 2;
+	CScopeMem NewData( (NodeCount * 3 + TableSize) * sizeof(uint32));
+	IndexParent   = NewData.GetArray<uint32>();
+	IndexNextSame = IndexParent + NodeCount;
+	IndexNameHash = IndexNextSame + NodeCount;
+	IndexTable    = IndexNameHash + NodeCount;
+	IndexMask     = TableSize - 1;
+	memset( IndexTable, 0xFF, TableSize * sizeof(uint32));
+
+	switch ( CharSize )
+	{
+	case sizeof(char):   LinkIndex<char>();   break;
+	case sizeof(char16): LinkIndex<char16>(); break;
+	default:             LinkIndex<char32>(); break;
+	}
+
+	IndexData = NewData.Detach();
+	return true;
+}
+
+template <typename CHAR> void CParserFastXML::LinkIndex()
+{
+	const Node<CHAR>* Nodes = (const Node<CHAR>*)Root;
+	for ( const Node<CHAR>* Link=Nodes; Link; Link=Link->Next)
+		IndexParent[Link - Nodes] = 0;
+	for ( size_t i=0; i<NodeCount; i++)
+		for ( const Node<CHAR>* Link=Nodes[i].Child; Link; Link=Link->Next)
+			IndexParent[Link - Nodes] = (uint32)i + 1;
+
+	for ( size_t i=NodeCount; i>0; i--)
+	{
+		uint32 NodeIndex = (uint32)i - 1;
+		IndexNextSame[NodeIndex] = INDEX_None;
+		IndexNameHash[NodeIndex] = 0;
+		if ( Nodes[NodeIndex].Type != NT_Element )
+			continue;
+		uint32 Parent = IndexParent[NodeIndex];
+		uint32 NameHash = IndexNameHash[NodeIndex] = XMLNameHash( Nodes[NodeIndex].Content);
+		uint32 Slot = XMLIndexHash( Parent, NameHash) & IndexMask;
+		for ( ; IndexTable[Slot] != INDEX_None; Slot=(Slot+1) & IndexMask)
+		{
+			uint32 Other = IndexTable[Slot];
+			if ( (IndexParent[Other] == Parent) && (IndexNameHash[Other] == NameHash) && !CStricmp( Nodes[Other].Content, Nodes[NodeIndex].Content) )
+			{
+				IndexNextSame[NodeIndex] = Other;
+				break;
+			}
+		}
+		IndexTable[Slot] = NodeIndex;
+	}
 }
 
+template <typename CHAR> uint32 CParserFastXML::IndexFindChild( uint32 Parent, const CHAR* Name) const
+{
+	const Node<CHAR>* Nodes = GetRoot<CHAR>();
+	if ( Nodes && Name && *Name )
+	{
+		uint32 NameHash = XMLNameHash( Name);
+		for ( uint32 Slot=XMLIndexHash( Parent, NameHash) & IndexMask; IndexTable[Slot] != INDEX_None; Slot=(Slot+1) & IndexMask)
+		{
+			uint32 Other = IndexTable[Slot];
+			if ( (IndexParent[Other] == Parent) && (IndexNameHash[Other] == NameHash) && !CStricmp( Nodes[Other].Content, Name) )
+				return Other;
+		}
+	}
+	return INDEX_None;
+}
+
+template <typename CHAR> uint32 CParserFastXML::IndexFindSibling( uint32 NodeIndex, const CHAR* Name, bool bAfter) const
+{
+	const Node<CHAR>* Nodes = GetRoot<CHAR>();
+	if ( !Nodes || !Name || !*Name )
+		return INDEX_None;
+	if ( (Nodes[NodeIndex].Type == NT_Element) && !CStricmp( Nodes[NodeIndex].Content, Name) )
+		return bAfter ? IndexNextSame[NodeIndex] : NodeIndex;
+	uint32 Found = IndexFindChild( IndexParent[NodeIndex], Name);
+	while ( (Found != INDEX_None) && (Found < NodeIndex) )
+		Found = IndexNextSame[Found];
+	return Found;
+}
+
+template uint32 CParserFastXML::IndexFindChild( uint32 Parent, const char* Name) const;
+template uint32 CParserFastXML::IndexFindChild( uint32 Parent, const char16* Name) const;
+template uint32 CParserFastXML::IndexFindChild( uint32 Parent, const char32* Name) const;
+template uint32 CParserFastXML::IndexFindChild( uint32 Parent, const wchar_t* Name) const;
+template uint32 CParserFastXML::IndexFindSibling( uint32 NodeIndex, const char* Name, bool bAfter) const;
+template uint32 CParserFastXML::IndexFindSibling( uint32 NodeIndex, const char16* Name, bool bAfter) const;
+template uint32 CParserFastXML::IndexFindSibling( uint32 NodeIndex, const char32* Name, bool bAfter) const;
+template uint32 CParserFastXML::IndexFindSibling( uint32 NodeIndex, const wchar_t* Name, bool bAfter) const;
+//========= CParserFastXML::BuildIndex - end ==========//
+
 
 /*----------------------------------------------------------------------------
 	CParserFastXML::Browser
 ----------------------------------------------------------------------------*/
 
-struct RecursiveNodeStringBuilder
+template <typename CHAR> struct RecursiveNodeStringBuilder
 {
 	size_t Length;
-	wchar_t* Output;
-	wchar_t* WritePosition;
+	CHAR* Output;
+	CHAR* WritePosition;
 
-	const wchar_t* GetString( const CParserFastXML::Node<wchar_t>* BaseNode)
+	const CHAR* GetString( const CParserFastXML::Node<CHAR>* BaseNode)
 	{
 		if ( BaseNode->Type == CParserFastXML::NT_Comment || BaseNode->Type == CParserFastXML::NT_String )
-			return BaseNode->Content ? BaseNode->Content : L"";
+			return BaseNode->Content ? BaseNode->Content : _text(CHAR,"");
 
 		if ( (BaseNode->Type == CParserFastXML::NT_Element) && BaseNode->Child )
 		{
 			Length = 0;
 			CountCharsInnerRecurse(BaseNode->Child);
-			Output = (wchar_t*)CStringBuffer( (Length+1)*sizeof(wchar_t) );
+			Output = (CHAR*)CStringBuffer( (Length+1)*sizeof(CHAR) );
 			if ( Output )
 			{
 				WritePosition = Output;
@@ -182,7 +341,7 @@ struct RecursiveNodeStringBuilder
 			}
 		}
 
-		return L"";
+		return _text(CHAR,"");
 	}
 
 
@@ -190,7 +349,7 @@ private:
 	//
 	// Note: content-less nodes are intentionally skipped
 	//
-	void CountCharsInnerRecurse( const CParserFastXML::Node<wchar_t>* Node)
+	void CountCharsInnerRecurse( const CParserFastXML::Node<CHAR>* Node)
 	{
 		for ( ; Node; Node=Node->Next)
 			if ( Node->Content )
@@ -206,26 +365,26 @@ private:
 			}
 	}
 
-	void PrintCharsInnerRecurse( const CParserFastXML::Node<wchar_t>* Node)
+	void PrintCharsInnerRecurse( const CParserFastXML::Node<CHAR>* Node)
 	{
 		for ( ; Node; Node=Node->Next)
 			if ( Node->Content )
 			{
 				if ( Node->Type == CParserFastXML::NT_Element )
 				{
-					*this << L"<" << Node->Content << L">";
+					*this << _text(CHAR,"<") << Node->Content << _text(CHAR,">");
 					if ( Node->Child )
 						PrintCharsInnerRecurse(Node->Child);
-					*this << L"</" << Node->Content << L">";
+					*this << _text(CHAR,"</") << Node->Content << _text(CHAR,">");
 				}
 				else if ( Node->Type == CParserFastXML::NT_String )
 					*this << Node->Content;
 			}
 	}
 
-	RecursiveNodeStringBuilder& operator<<(const wchar_t* In)
+	RecursiveNodeStringBuilder& operator<<(const CHAR* In)
 	{
-		wchar_t* Out = WritePosition;
+		CHAR* Out = WritePosition;
 		while ( *In )
 			*Out++ = *In++;
 		WritePosition = Out;
@@ -233,12 +392,32 @@ private:
 	}
 };
 
-const wchar_t* CParserFastXML::Browser::operator*()
+template <typename CHAR> const CHAR* CParserFastXML::TBrowser<CHAR>::operator*()
 {
-	RecursiveNodeStringBuilder Builder;
+	RecursiveNodeStringBuilder<CHAR> Builder;
 	return Builder.GetString(Position);
 }
 
+template <typename CHAR> bool CParserFastXML::TBrowser<CHAR>::Query( const CHAR* Path)
+{
+	for ( bool bFirst=true; Position && *Path; bFirst=false)
+	{
+		const CHAR* Separator = Path;
+		while ( *Separator && (*Separator != '/') )
+			Separator++;
+		const CHAR* ElementName = CopyToBuffer( Path, Separator - Path);
+		if ( !(bFirst ? Start(ElementName) : Down(ElementName)) )
+			return false;
+		Path = *Separator ? Separator + 1 : Separator;
+	}
+	return Position != nullptr;
+}
+
+template class CParserFastXML::TBrowser<char>;
+template class CParserFastXML::TBrowser<char16>;
+template class CParserFastXML::TBrowser<char32>;
+template class CParserFastXML::TBrowser<wchar_t>;
+
 
 /*----------------------------------------------------------------------------
 	CParserFastXML internals.
@@ -270,7 +449,22 @@ template <> void LogElements<char>( const XMLParser::Element<char>& Element, int
 {
 }
 
-template <typename CHAR> bool templ_parse( const CHAR*& Stream, XMLParser::Element<CHAR>*& RootElement, CMemExStack& MemTree)
+//
+// Memory counted per element and attribute: the temporary tree objects
+// plus the final node or attribute and its string.
+//
+template <typename CHAR> size_t templ_element_memory( const XMLParser::String<CHAR>& Text)
+{
+	return sizeof(XMLParser::Element<CHAR>) + sizeof(XMLParser::String<CHAR>) + sizeof(CParserFastXML::Node<CHAR>) + Align(Text.OutputMemory(),EALIGN_PLATFORM_PTR);
+}
+
+template <typename CHAR> size_t templ_attribute_memory( const XMLParser::String<CHAR>& Key, const XMLParser::String<CHAR>& Value)
+{
+	return sizeof(XMLParser::Attribute<CHAR>) + sizeof(XMLParser::String<CHAR>) * 2 + sizeof(CParserFastXML::Attrib<CHAR>)
+		+ Align(Key.OutputMemory(),EALIGN_PLATFORM_PTR) + Align(Value.OutputMemory(),EALIGN_PLATFORM_PTR);
+}
+
+template <typename CHAR> bool templ_parse( const CHAR*& Stream, XMLParser::Element<CHAR>*& RootElement, CMemExStack& MemTree, const CParserFastXML::CLimits& Limits)
 {
 	static const CHAR* SkipChars       = _text(CHAR," \r\n	");
 	static const CHAR* PostElementSkip = _text(CHAR,"\r\n");
@@ -303,6 +497,7 @@ template <typename CHAR> bool templ_parse( const CHAR*& Stream, XMLParser::Eleme
 		return false;
 
 	XMLParser::Element<CHAR>*  CurElement     = nullptr;
+	XMLParser::Counter         Count(Limits);
 	do
 	{
 		// Element definition begin
@@ -320,6 +515,7 @@ template <typename CHAR> bool templ_parse( const CHAR*& Stream, XMLParser::Eleme
 					break;
 				// SKIP SPACES BEFORE '>' ?
 				CurElement = CurElement->Parent;
+				Count.Depth--;
 				AdvanceThrough(Stream, PostElementSkip);
 				continue;
 			}
@@ -329,17 +525,24 @@ template <typename CHAR> bool templ_parse( const CHAR*& Stream, XMLParser::Eleme
 			XMLParser::String<CHAR> OpeningName;
 			if ( !OpeningName.ParseElementName(Stream) ) // Error
 				break;
+			if ( !Count.AddNode(templ_element_memory(OpeningName)) ) // Limit
+				break;
 
 			XMLParser::Element<CHAR>* NewElement = new(MemTree) XMLParser::Element<CHAR>;
 			NewElement->ElementName = new(MemTree) XMLParser::String<CHAR>(OpeningName);
-			NewElement->ParseAttributes(Stream, MemTree);
+			if ( !NewElement->ParseAttributes(Stream, MemTree, Count) ) // Limit
+				break;
 			if ( !NewElement->AttachTo(CurElement) )
 				RootElement = NewElement; // No parent means New is Root
 
 			// Element is not being immediately closed, traverse down tree
 			XMLParser::Stage = "Close Element Statement";
 			if ( EatChar(Stream,'>') )
+			{
+				if ( !Count.AddDepth() ) // Limit
+					break;
 				CurElement = NewElement;
+			}
 			else if ( !EatChar(Stream,'/') || !EatChar(Stream,'>') ) // Error
 				break;
 			AdvanceThrough(Stream, PostElementSkip);
@@ -350,10 +553,13 @@ template <typename CHAR> bool templ_parse( const CHAR*& Stream, XMLParser::Eleme
 		// String element
 		else
 		{
-			XMLParser::Element<CHAR>* NewStringElement = new(MemTree) XMLParser::Element<CHAR>;
-			NewStringElement->ElementText = new(MemTree) XMLParser::String<CHAR>;
-			if ( !NewStringElement->ElementText->ParseElementText(Stream) ) // Error
+			XMLParser::String<CHAR> Text;
+			if ( !Text.ParseElementText(Stream) ) // Error
+				break;
+			if ( !Count.AddNode(templ_element_memory(Text)) ) // Limit
 				break;
+			XMLParser::Element<CHAR>* NewStringElement = new(MemTree) XMLParser::Element<CHAR>;
+			NewStringElement->ElementText = new(MemTree) XMLParser::String<CHAR>(Text);
 			NewStringElement->AttachTo(CurElement);
 		}
 	} while ( CurElement != nullptr );
@@ -363,57 +569,93 @@ template <typename CHAR> bool templ_parse( const CHAR*& Stream, XMLParser::Eleme
 }
 
 
-template <typename CHAR> void templ_preprocess_elements( CMemExStack& Mem, const XMLParser::Element<CHAR>* RootElement, size_t& TotalElements, size_t& TotalAttributes, size_t& TotalStringMemory)
+// Memory taken by a group of elements once laid out
+struct XMLLayoutSize
 {
-	// Traverse all elements
-	TotalElements = 0;
-	TotalAttributes = 0;
-	TotalStringMemory = 0;
-	const XMLParser::Element<CHAR>* Element = RootElement;
-	while ( Element )
+	size_t Elements;
+	size_t Attributes;
+	size_t StringMemory;
+};
+
+template <typename CHAR> void templ_preprocess_element( CMemExStack& Mem, const XMLParser::Element<CHAR>* Element, XMLLayoutSize& Size)
+{
+	Size.Elements++;
+	if ( Element->ElementName )
 	{
-		TotalElements++;
-		if ( Element->ElementName )
-		{
-			Element->ElementName->ProcessSpecialCharacters(Mem);
-			TotalStringMemory += Align(Element->ElementName->OutputMemory(),EALIGN_PLATFORM_PTR);
-		}
-		if ( Element->ElementText )
-		{
-			Element->ElementText->ProcessSpecialCharacters(Mem);
-			TotalStringMemory += Align(Element->ElementText->OutputMemory(),EALIGN_PLATFORM_PTR);
-		}
+		Element->ElementName->ProcessSpecialCharacters(Mem);
+		Size.StringMemory += Align(Element->ElementName->OutputMemory(),EALIGN_PLATFORM_PTR);
+	}
+	if ( Element->ElementText )
+	{
+		Element->ElementText->ProcessSpecialCharacters(Mem);
+		Size.StringMemory += Align(Element->ElementText->OutputMemory(),EALIGN_PLATFORM_PTR);
+	}
 
-		// Traverse all attributes
-		for ( const XMLParser::Attribute<CHAR>* Attribute=Element->Attribute; Attribute; Attribute=Attribute->Next)
-		{
-			TotalAttributes++;
-			Attribute->Key->ProcessSpecialCharacters(Mem);
-			Attribute->Value->ProcessSpecialCharacters(Mem);
-			TotalStringMemory += Align(Attribute->Key->OutputMemory(),EALIGN_PLATFORM_PTR);
-			TotalStringMemory += Align(Attribute->Value->OutputMemory(),EALIGN_PLATFORM_PTR);
-		}
+	// Traverse all attributes
+	for ( const XMLParser::Attribute<CHAR>* Attribute=Element->Attribute; Attribute; Attribute=Attribute->Next)
+	{
+		Size.Attributes++;
+		Attribute->Key->ProcessSpecialCharacters(Mem);
+		Attribute->Value->ProcessSpecialCharacters(Mem);
+		Size.StringMemory += Align(Attribute->Key->OutputMemory(),EALIGN_PLATFORM_PTR);
+		Size.StringMemory += Align(Attribute->Value->OutputMemory(),EALIGN_PLATFORM_PTR);
+	}
+}
+
+// Traverses an element and its descendants, siblings of SubtreeRoot are not visited
+template <typename CHAR> void templ_preprocess_subtree( CMemExStack& Mem, const XMLParser::Element<CHAR>* SubtreeRoot, XMLLayoutSize& Size)
+{
+	const XMLParser::Element<CHAR>* Element = SubtreeRoot;
+	while ( true )
+	{
+		templ_preprocess_element(Mem, Element, Size);
 
 		if ( Element->Child )
 			Element = Element->Child;
-		else if ( Element->Next )
-			Element = Element->Next;
 		else
 		{
-			traverse_parent:
-			Element = Element->Parent;
-			if ( !Element )
+			while ( (Element != SubtreeRoot) && !Element->Next )
+				Element = Element->Parent;
+			if ( Element == SubtreeRoot )
 				break;
-			if ( !Element->Next )
-				goto traverse_parent;
 			Element = Element->Next;
 		}
 	}
 }
 
-template <typename CHAR> void templ_process_elements( const XMLParser::Element<CHAR>* RootElement, CParserFastXML::Node<CHAR>* NodeArray, CParserFastXML::Attrib<CHAR>* AttributeArray, CHAR* StringBlock)
+template <typename CHAR> void templ_process_node( const XMLParser::Element<CHAR>* Element, CParserFastXML::Node<CHAR>* Node, CParserFastXML::Attrib<CHAR>*& AttributeArray, CHAR*& StringBlock)
+{
+	Node->Child  = nullptr;
+	Node->Next   = nullptr;
+	if ( Element->ElementName )
+	{
+		Node->Type = CParserFastXML::NT_Element;
+		Node->Content = Element->ElementName->OutputToBlock(StringBlock);
+		Node->Name = CName( Node->Content, CNAME_Find); //Unknown names are matched by text
+	}
+	else if ( Element->ElementText )
+	{
+		Node->Type = CParserFastXML::NT_String;
+		Node->Content = Element->ElementText->OutputToBlock(StringBlock);
+		Node->Name = CName();
+	}
+
+	// Traverse all attributes
+	CParserFastXML::Attrib<CHAR>** AttribPtr = &Node->Attribute;
+	for ( const XMLParser::Attribute<CHAR>* Attribute=Element->Attribute; Attribute; Attribute=Attribute->Next)
+	{
+		*AttribPtr = AttributeArray;
+		AttributeArray->Name  = Attribute->Key->OutputToBlock(StringBlock);
+		AttributeArray->Value = Attribute->Value->OutputToBlock(StringBlock);
+		AttribPtr = &AttributeArray->Next;
+		AttributeArray++;
+	}
+	*AttribPtr = nullptr;
+}
+
+// Writes an element and its descendants in document order, the Next link of SubtreeRoot is left empty
+template <typename CHAR> void templ_process_subtree( const XMLParser::Element<CHAR>* SubtreeRoot, size_t NodeCount, CParserFastXML::Node<CHAR>* NodeArray, CParserFastXML::Attrib<CHAR>* AttributeArray, CHAR* StringBlock)
 {
-	size_t NodeCount = (const XMLParser::Element<CHAR>*)NodeArray - RootElement; //Ugly, but gives Root count
 	struct ParentLink
 	{
 		ParentLink* Parent;
@@ -425,33 +667,61 @@ template <typename CHAR> void templ_process_elements( const XMLParser::Element<C
 	ParentLinks[0].Node   = NodeArray;
 
 	// Traverse all elements
-	const XMLParser::Element<CHAR>* Element = RootElement;
-	while ( Element )
+	const XMLParser::Element<CHAR>* Element = SubtreeRoot;
+	while ( true )
 	{
-		NodeArray->Child  = nullptr;
-		NodeArray->Next   = nullptr;
-		if ( Element->ElementName )
+		templ_process_node(Element, NodeArray, AttributeArray, StringBlock);
+		NodeArray++;
+
+		if ( Element->Child )
 		{
-			NodeArray->Type = CParserFastXML::NT_Element;
-			NodeArray->Content = Element->ElementName->OutputToBlock(StringBlock);
+			Element = Element->Child;
+			ParentLinks[1].Parent = ParentLinks;
+			ParentLinks[1].Node   = NodeArray;
+			ParentLinks[0].Node->Child = NodeArray;
+			ParentLinks++;
 		}
-		else if ( Element->ElementText )
+		else
 		{
-			NodeArray->Type = CParserFastXML::NT_String;
-			NodeArray->Content = Element->ElementText->OutputToBlock(StringBlock);
+			while ( (Element != SubtreeRoot) && !Element->Next )
+			{
+				Element = Element->Parent;
+				ParentLinks = ParentLinks[0].Parent;
+			}
+			if ( Element == SubtreeRoot )
+				break;
+			Element = Element->Next;
+			ParentLinks[0].Node->Next = NodeArray;
+			ParentLinks[0].Node = NodeArray;
 		}
+	}
+}
 
-		// Traverse all attributes
-		CParserFastXML::Attrib<CHAR>** AttribPtr = &NodeArray->Attribute;
-		for ( const XMLParser::Attribute<CHAR>* Attribute=Element->Attribute; Attribute; Attribute=Attribute->Next)
-		{
-			*AttribPtr = AttributeArray;
-			AttributeArray->Name  = Attribute->Key->OutputToBlock(StringBlock);
-			AttributeArray->Value = Attribute->Value->OutputToBlock(StringBlock);
-			AttribPtr = &AttributeArray->Next;
-			AttributeArray++;
-		}
-		*AttribPtr = nullptr;
+// Single threaded layout, all top level elements and their descendants in one pass
+template <typename CHAR> void templ_preprocess_elements( CMemExStack& Mem, const XMLParser::Element<CHAR>* RootElement, XMLLayoutSize& Total)
+{
+	Total = XMLLayoutSize{0,0,0};
+	for ( const XMLParser::Element<CHAR>* Top=RootElement; Top; Top=Top->Next)
+		templ_preprocess_subtree(Mem, Top, Total);
+}
+
+template <typename CHAR> void templ_process_elements( const XMLParser::Element<CHAR>* RootElement, size_t NodeCount, CParserFastXML::Node<CHAR>* NodeArray, CParserFastXML::Attrib<CHAR>* AttributeArray, CHAR* StringBlock)
+{
+	struct ParentLink
+	{
+		ParentLink* Parent;
+		CParserFastXML::Node<CHAR>* Node;
+	};
+	CScopeMem ParentLinkMem(NodeCount * sizeof(ParentLink));
+	ParentLink* ParentLinks = ParentLinkMem.GetArray<ParentLink>();
+	ParentLinks[0].Parent = nullptr;
+	ParentLinks[0].Node   = NodeArray;
+
+	// Traverse all elements
+	const XMLParser::Element<CHAR>* Element = RootElement;
+	while ( Element )
+	{
+		templ_process_node(Element, NodeArray, AttributeArray, StringBlock);
 		NodeArray++;
 
 		if ( Element->Child )
@@ -485,50 +755,309 @@ template <typename CHAR> void templ_process_elements( const XMLParser::Element<C
 }
 
 
+//========= Node layout - begin ==========//
+//
+// The final tree is split into jobs: every top level element alone and
+// every child subtree of a top level element.
+// Job sizes are known after preprocessing, so each job gets its own range
+// of nodes, attributes and strings and can be written independently of the
+// others, in any order and on any thread.
+// Nodes end up in document order regardless of how the jobs are run.
+//
+#define XML_LAYOUT_MAX_THREADS 32
+#define XML_LAYOUT_MIN_NODES   4096 //Smaller trees aren't worth waking workers
+
+//
+// Layout workers are started on first use and kept waiting on their own
+// event, a parse wakes as many as it needs and waits on Done until the
+// last one finishes.
+// Only one parse uses the workers at a time, others lay out on their own
+// thread meanwhile. Workers are told to quit when the pool is destroyed
+// at exit, those already gone with the process are left alone.
+//
+struct XMLLayoutPool
+{
+	typedef void (*WORK_FUNC)(void*);
 
+	struct Worker
+	{
+		CThread        Thread;
+		CEvent         Wake;
+		XMLLayoutPool* Pool;
+	};
+
+	Worker*        Workers[XML_LAYOUT_MAX_THREADS-1];
+	uint32         WorkerCount;
+	CEvent         Done;
+	WORK_FUNC      Work;
+	void*          WorkArg;
+	volatile int32 Running;
+	volatile int32 Busy;
+	volatile int32 Quit;
+
+	static XMLLayoutPool& Get()
+	{
+		static XMLLayoutPool Pool;
+		return Pool;
+	}
+
+	static uint32 WorkerEntry( void* Arg, CThread* Handler)
+	{
+		Worker* Self = (Worker*)Arg;
+		XMLLayoutPool* Pool = Self->Pool;
+		for ( ; ; )
+		{
+			Self->Wake.Wait();
+			if ( Pool->Quit )
+				break;
+			(*Pool->Work)(Pool->WorkArg);
+			if ( CPlatformAtomics::InterlockedDecrement(&Pool->Running) == 0 )
+				Pool->Done.Signal();
+		}
+		return THREAD_END_OK;
+	}
+
+	// Runs InWork on this thread and up to Helpers workers, false if another parse is using them
+	bool Run( WORK_FUNC InWork, void* InWorkArg, uint32 Helpers)
+	{
+		if ( CPlatformAtomics::InterlockedCompareExchange(&Busy, 1, 0) )
+			return false;
+		while ( WorkerCount < Helpers )
+		{
+			Worker* NewWorker = new Worker;
+			NewWorker->Pool = this;
+			if ( !NewWorker->Thread.Run(&WorkerEntry, NewWorker) )
+			{
+				delete NewWorker;
+				break;
+			}
+			Workers[WorkerCount++] = NewWorker;
+		}
+		Helpers = Min<uint32>(Helpers, WorkerCount);
+
+		Work = InWork;
+		WorkArg = InWorkArg;
+		Running = (int32)Helpers + 1;
+		for ( uint32 i=0; i<Helpers; i++)
+			Workers[i]->Wake.Signal();
+		(*Work)(WorkArg);
+		if ( CPlatformAtomics::InterlockedDecrement(&Running) != 0 )
+			Done.Wait();
+		CPlatformAtomics::InterlockedCompareExchange(&Busy, 0, 1); //Full barrier, InterlockedExchange only acquires on GCC
+		return true;
+	}
+
+private:
+	XMLLayoutPool()
+		: WorkerCount(0)
+		, Work(nullptr)
+		, WorkArg(nullptr)
+		, Running(0)
+		, Busy(0)
+		, Quit(0)
+	{}
+
+	~XMLLayoutPool()
+	{
+		Quit = 1;
+		for ( uint32 i=0; i<WorkerCount; i++)
+			Workers[i]->Wake.Signal();
+		for ( uint32 i=0; i<WorkerCount; i++)
+			if ( Workers[i]->Thread.WaitFinish(1.0f) ) //Threads may have been terminated without ending
+				delete Workers[i];
+	}
+};
+
+template <typename CHAR> struct XMLLayoutJob
+{
+	const XMLParser::Element<CHAR>* Element;
+	bool                            bSubtree;
+	XMLLayoutSize                   Size;
+	CParserFastXML::Node<CHAR>*     Node;
+	CParserFastXML::Attrib<CHAR>*   Attrib;
+	CHAR*                           String;
+};
+
+template <typename CHAR> struct XMLLayoutQueue
+{
+	XMLLayoutJob<CHAR>* Jobs;
+	int32               JobCount;
+	volatile int32      NextJob;
+
+	void Work()
+	{
+		int32 i;
+		while ( (i=CPlatformAtomics::InterlockedIncrement(&NextJob)-1) < JobCount )
+		{
+			XMLLayoutJob<CHAR>& Job = Jobs[i];
+			if ( Job.bSubtree )
+				templ_process_subtree(Job.Element, Job.Size.Elements, Job.Node, Job.Attrib, Job.String);
+			else
+				templ_process_node(Job.Element, Job.Node, Job.Attrib, Job.String);
+		}
+	}
+
+	static void Entry( void* Arg)
+	{
+		((XMLLayoutQueue<CHAR>*)Arg)->Work();
+	}
+};
+
+template <typename CHAR> int32 templ_layout_jobs( const XMLParser::Element<CHAR>* RootElement)
+{
+	int32 JobCount = 0;
+	for ( const XMLParser::Element<CHAR>* Top=RootElement; Top; Top=Top->Next)
+	{
+		JobCount++;
+		for ( const XMLParser::Element<CHAR>* Child=Top->Child; Child; Child=Child->Next)
+			JobCount++;
+	}
+	return JobCount;
+}
+
+template <typename CHAR> void templ_preprocess_jobs( CMemExStack& Mem, const XMLParser::Element<CHAR>* RootElement, XMLLayoutJob<CHAR>* Jobs, XMLLayoutSize& Total)
+{
+	Total = XMLLayoutSize{0,0,0};
+	for ( const XMLParser::Element<CHAR>* Top=RootElement; Top; Top=Top->Next)
+	{
+		for ( const XMLParser::Element<CHAR>* Element=Top; Element; Element=(Element == Top) ? Top->Child : Element->Next)
+		{
+			Jobs->Element = Element;
+			Jobs->bSubtree = (Element != Top);
+			Jobs->Size = XMLLayoutSize{0,0,0};
+			if ( Jobs->bSubtree )
+				templ_preprocess_subtree(Mem, Element, Jobs->Size);
+			else
+				templ_preprocess_element(Mem, Element, Jobs->Size);
+			Total.Elements     += Jobs->Size.Elements;
+			Total.Attributes   += Jobs->Size.Attributes;
+			Total.StringMemory += Jobs->Size.StringMemory;
+			Jobs++;
+		}
+	}
+}
+
+template <typename CHAR> void templ_process_jobs( XMLLayoutJob<CHAR>* Jobs, int32 JobCount, uint32 Threads, CParserFastXML::Node<CHAR>* NodeArray, CParserFastXML::Attrib<CHAR>* AttributeArray, CHAR* StringBlock)
+{
+	// Give each job its range
+	for ( int32 i=0; i<JobCount; i++)
+	{
+		Jobs[i].Node   = NodeArray;
+		Jobs[i].Attrib = AttributeArray;
+		Jobs[i].String = StringBlock;
+		NodeArray      += Jobs[i].Size.Elements;
+		AttributeArray += Jobs[i].Size.Attributes;
+		StringBlock     = AddressOffset<CHAR>(StringBlock, Jobs[i].Size.StringMemory);
+	}
+
+	XMLLayoutQueue<CHAR> Queue;
+	Queue.Jobs = Jobs;
+	Queue.JobCount = JobCount;
+	Queue.NextJob = 0;
+	Threads = Min<uint32>(Threads, Min<uint32>(JobCount, XML_LAYOUT_MAX_THREADS));
+	if ( (Threads <= 1) || !XMLLayoutPool::Get().Run(&XMLLayoutQueue<CHAR>::Entry, &Queue, Threads-1) )
+		Queue.Work();
+
+	// Link top level elements and their children
+	CParserFastXML::Node<CHAR>* Top = nullptr;
+	CParserFastXML::Node<CHAR>* Prev = nullptr;
+	for ( int32 i=0; i<JobCount; i++)
+	{
+		CParserFastXML::Node<CHAR>* Node = Jobs[i].Node;
+		if ( !Jobs[i].bSubtree )
+		{
+			if ( Top )
+				Top->Next = Node;
+			Top = Node;
+			Prev = nullptr;
+		}
+		else
+		{
+			if ( Prev )
+				Prev->Next = Node;
+			else
+				Top->Child = Node;
+			Prev = Node;
+		}
+	}
+}
+//========= Node layout - end ==========//
+
+bool CParserFastXML::Parse( const char* Input)
+{
+	// Skip UTF-8 byte order mark
+	if ( Input && (Input[0] == '\xEF') && (Input[1] == '\xBB') && (Input[2] == '\xBF') )
+		Input += 3;
+	return ParseText(Input);
+}
+
+bool CParserFastXML::Parse( const char16* Input)
+{
+	return ParseText(Input);
+}
 
+bool CParserFastXML::Parse( const char32* Input)
+{
+	return ParseText(Input);
+}
 
 bool CParserFastXML::Parse( const wchar_t* Input)
+{
+	return ParseText(Input);
+}
+
+template <typename CHAR> bool CParserFastXML::ParseText( const CHAR* Input)
 {
 	Empty();
+	if ( !Input )
+		return false;
 
 	// This stack contains all pointers to original stream data
 	CMemExStack TreeStack(4096);
 
-	XMLParser::Element<wchar_t>* RootElement = nullptr;
+	XMLParser::Element<CHAR>* RootElement = nullptr;
 
-	const wchar_t* Stream = (const wchar_t*)Input;
-	if ( !templ_parse(Stream, RootElement, TreeStack) )
+	const CHAR* Stream = Input;
+	if ( !templ_parse(Stream, RootElement, TreeStack, Limits) )
 	{
-		printf("Stream parse error at %s\r\n\r\n", XMLParser::Stage);
+		DebugCallback( CSprintf("CParserFastXML -> parse error at %s", XMLParser::Stage), CACUS_CALLBACK_PARSER );
 		return false;
 	}
 
-	size_t Elements, Attributes, StringMemory;
-	templ_preprocess_elements(TreeStack, RootElement, Elements, Attributes, StringMemory);
+	// Single threaded parses skip the job split
+	int32 JobCount = (LayoutThreads != 1) ? templ_layout_jobs(RootElement) : 0;
+	CScopeMem JobMem(JobCount * sizeof(XMLLayoutJob<CHAR>));
+	XMLLayoutJob<CHAR>* Jobs = JobMem.GetArray<XMLLayoutJob<CHAR>>();
+	XMLLayoutSize Total;
+	if ( JobCount )
+		templ_preprocess_jobs(TreeStack, RootElement, Jobs, Total);
+	else
+		templ_preprocess_elements(TreeStack, RootElement, Total);
+	size_t Elements = Total.Elements;
 
 	if ( RootElement )
 		LogElements(*RootElement);
 
 	// Prepare single allocation block.
-	size_t NodeMemory   = Elements   * sizeof(CParserFastXML::Node<wchar_t>);
-	size_t AttribMemory = Attributes * sizeof(CParserFastXML::Attrib<wchar_t>);
-	Data = CMalloc(NodeMemory + AttribMemory + StringMemory + 32);
-
-	CParserFastXML::Node<wchar_t>*   NodeArray   = AddressOffset<CParserFastXML::Node<wchar_t>>(Data, 0);
-	CParserFastXML::Attrib<wchar_t>* AttribArray = AddressOffset<CParserFastXML::Attrib<wchar_t>>(NodeArray, NodeMemory);
-	wchar_t*                         StringBlock = AddressOffset<wchar_t>(AttribArray, AttribMemory);
-	templ_process_elements(RootElement, NodeArray, AttribArray, StringBlock);
-
-	for ( size_t i=0; i<Elements; i++)
-	{
-		wprintf(L"Node contents %i: %s\r\n", (int)i, NodeArray[i].Content);
-		for ( auto* AttribLink=NodeArray[i].Attribute; AttribLink; AttribLink=AttribLink->Next)
-			wprintf(L"With attribute %s = %s\r\n", AttribLink->Name, AttribLink->Value);
-	}
+	size_t NodeMemory   = Elements         * sizeof(CParserFastXML::Node<CHAR>);
+	size_t AttribMemory = Total.Attributes * sizeof(CParserFastXML::Attrib<CHAR>);
+	Data = CMalloc(NodeMemory + AttribMemory + Total.StringMemory + 32);
+
+	CParserFastXML::Node<CHAR>*   NodeArray   = AddressOffset<CParserFastXML::Node<CHAR>>(Data, 0);
+	CParserFastXML::Attrib<CHAR>* AttribArray = AddressOffset<CParserFastXML::Attrib<CHAR>>(NodeArray, NodeMemory);
+	CHAR*                         StringBlock = AddressOffset<CHAR>(AttribArray, AttribMemory);
+	uint32 Threads = (JobCount && (Elements >= XML_LAYOUT_MIN_NODES)) ? (LayoutThreads ? LayoutThreads : CGetProcessorCount()) : 1;
+	if ( Threads > 1 )
+		templ_process_jobs(Jobs, JobCount, Threads, NodeArray, AttribArray, StringBlock);
+	else
+		templ_process_elements(RootElement, Elements, NodeArray, AttribArray, StringBlock);
 
 	if ( Elements > 0 )
+	{
 		Root = NodeArray;
+		CharSize = sizeof(CHAR);
+		NodeCount = Elements;
+	}
 
 	return true;
 }
@@ -707,6 +1236,52 @@ next:
 }
 
 
+//
+// Writes a code point as UTF-8 or UTF-16 depending on char width,
+// returns the number of chars written (never more than the shortest
+// character reference for it).
+//
+template<typename CHAR>
+size_t XMLParser::EncodeCharacter( CHAR* Out, uint32 C)
+{
+	if ( sizeof(CHAR) == 1 )
+	{
+		if ( C < 0x80 )
+		{
+			Out[0] = (CHAR)C;
+			return 1;
+		}
+		if ( C < 0x800 )
+		{
+			Out[0] = (CHAR)(0xC0 | (C >> 6));
+			Out[1] = (CHAR)(0x80 | (C & 0x3F));
+			return 2;
+		}
+		if ( C < 0x10000 )
+		{
+			Out[0] = (CHAR)(0xE0 | (C >> 12));
+			Out[1] = (CHAR)(0x80 | ((C >> 6) & 0x3F));
+			Out[2] = (CHAR)(0x80 | (C & 0x3F));
+			return 3;
+		}
+		Out[0] = (CHAR)(0xF0 | (C >> 18));
+		Out[1] = (CHAR)(0x80 | ((C >> 12) & 0x3F));
+		Out[2] = (CHAR)(0x80 | ((C >> 6) & 0x3F));
+		Out[3] = (CHAR)(0x80 | (C & 0x3F));
+		return 4;
+	}
+	if ( (sizeof(CHAR) == 2) && (C >= 0x10000) )
+	{
+		C -= 0x10000;
+		Out[0] = (CHAR)(0xD800 | (C >> 10));
+		Out[1] = (CHAR)(0xDC00 | (C & 0x3FF));
+		return 2;
+	}
+	Out[0] = (CHAR)C;
+	return 1;
+}
+
+
 template <typename CHAR>
 bool XMLParser::String<CHAR>::ProcessSpecialCharacters( CMemExStack& Mem)
 {
@@ -714,7 +1289,7 @@ bool XMLParser::String<CHAR>::ProcessSpecialCharacters( CMemExStack& Mem)
 	const size_t Len = Length();
 	if ( CStrnchr(Start, '&', Len+1) )
 	{
-		CHAR* NewStart = (CHAR*)Mem.PushBytes(Length());
+		CHAR* NewStart = (CHAR*)Mem.PushBytes(Length() * sizeof(CHAR));
 		CHAR* NewEnd   = NewStart;
 
 		const CHAR* Stream = Start;
@@ -739,7 +1314,7 @@ bool XMLParser::String<CHAR>::ProcessSpecialCharacters( CMemExStack& Mem)
 						uint32 C = (NewEnd[2] == 'x') ? XMLParser::ParseHexCharacter(NewEnd+3) : XMLParser::ParseDecCharacter(NewEnd+2);
 						if ( C )
 						{
-							*NewEnd++ = (CHAR)C;
+							NewEnd += XMLParser::EncodeCharacter(NewEnd, C);
 							continue;
 						}
 					}
@@ -789,7 +1364,7 @@ bool XMLParser::Element<CHAR>::AttachTo( Element<CHAR>* NewParent)
 }
 
 template <typename CHAR>
-void XMLParser::Element<CHAR>::ParseAttributes( const CHAR*& Stream, CMemExStack& Mem)
+bool XMLParser::Element<CHAR>::ParseAttributes( const CHAR*& Stream, CMemExStack& Mem, Counter& Count)
 {
 	XMLParser::Stage = "Element Attribute Parser";
 	XMLParser::Attribute<CHAR>** AttributePtr = &Attribute;
@@ -809,6 +1384,8 @@ void XMLParser::Element<CHAR>::ParseAttributes( const CHAR*& Stream, CMemExStack
 		XMLParser::String<CHAR> _value;
 		if ( _key.ParseAttributeName(Stream) && _value.ParseAttributeValue(Stream) )
 		{
+			if ( !Count.AddAttribute(templ_attribute_memory(_key, _value)) )
+				return false;
 			XMLParser::Attribute<CHAR>* NewAttribute = new(Mem) XMLParser::Attribute<CHAR>();
 			NewAttribute->Key   = new(Mem) XMLParser::String<CHAR>(_key);
 			NewAttribute->Value = new(Mem) XMLParser::String<CHAR>(_value);
@@ -816,6 +1393,55 @@ void XMLParser::Element<CHAR>::ParseAttributes( const CHAR*& Stream, CMemExStack
 			AttributePtr = &NewAttribute->Next;
 		}
 	}
+	return true;
+}
+
+//*****************************************************
+//****************** Limit counters *******************
+//*****************************************************
+
+bool XMLParser::Counter::AddDepth()
+{
+	if ( Limits.MaxDepth && (Depth >= Limits.MaxDepth) )
+	{
+		XMLParser::Stage = "Depth limit";
+		return false;
+	}
+	Depth++;
+	return true;
+}
+
+bool XMLParser::Counter::AddNode( size_t Bytes)
+{
+	if ( Limits.MaxNodes && (Nodes >= Limits.MaxNodes) )
+	{
+		XMLParser::Stage = "Node count limit";
+		return false;
+	}
+	Nodes++;
+	return AddMemory(Bytes);
+}
+
+bool XMLParser::Counter::AddAttribute( size_t Bytes)
+{
+	if ( Limits.MaxAttributes && (Attributes >= Limits.MaxAttributes) )
+	{
+		XMLParser::Stage = "Attribute count limit";
+		return false;
+	}
+	Attributes++;
+	return AddMemory(Bytes);
+}
+
+bool XMLParser::Counter::AddMemory( size_t Bytes)
+{
+	Memory += Bytes;
+	if ( Limits.MaxMemory && (Memory > Limits.MaxMemory) )
+	{
+		XMLParser::Stage = "Memory limit";
+		return false;
+	}
+	return true;
 }
 
 //*****************************************************
@@ -830,3 +1456,506 @@ inline bool XMLParser::IsAttributeSeparator( const CHAR C)
 		|| C == '\n'
 		|| C == '\x9';
 }
+
+
+/*----------------------------------------------------------------------------
+	CParserStreamXML8
+----------------------------------------------------------------------------*/
+
+// Markup closed by a sequence instead of '>'
+static const struct
+{
+	const char* Open;
+	const char* Close;
+} XMLSections[] =
+{
+	{ "<!--"      , "-->" },
+	{ "<![CDATA[" , "]]>" },
+	{ "<?"        , "?>"  },
+};
+
+static const struct
+{
+	const char* Name;
+	char        Value;
+} XMLEntities[] =
+{
+	{ "amp;"  , '&'    },
+	{ "lt;"   , '<'    },
+	{ "gt;"   , '>'    },
+	{ "apos;" , '\x27' },
+	{ "quot;" , '\x22' },
+};
+
+static inline bool XMLIsSpace( char C)
+{
+	return (C == ' ') || (C == '\r') || (C == '\n') || (C == '\t');
+}
+
+//
+// Returns 1 if Text starts with Prefix, 0 if it doesn't and -1 if the
+// text ends before it can be decided.
+//
+static int32 XMLStartsWith( const char* Text, const char* TextEnd, const char* Prefix)
+{
+	for ( ; *Prefix ; Text++, Prefix++ )
+	{
+		if ( Text == TextEnd )
+			return -1;
+		if ( *Text != *Prefix )
+			return 0;
+	}
+	return 1;
+}
+
+//
+// Decodes entities and character references (as UTF-8) into Out,
+// unknown or malformed ones are kept as is.
+// The result is never longer than the input.
+//
+static size_t XMLDecodeEntities( char* Out, const char* Text, size_t Len)
+{
+	char* Start = Out;
+	const char* End = Text + Len;
+	while ( Text < End )
+	{
+		const char* Semicolon = (*Text == '&') ? (const char*)memchr( Text, ';', Min<size_t>( End - Text, 12)) : nullptr;
+		if ( Semicolon && (Text[1] == '#') )
+		{
+			bool bHex = (Text[2] == 'x');
+			const char* Digit = Text + (bHex ? 3 : 2);
+			uint32 Code = 0;
+			for ( ; (Digit < Semicolon) && (Code <= 0x10FFFF) ; Digit++ )
+			{
+				char D = *Digit | 0x20; //Lower case letters
+				uint32 Value = (*Digit >= '0' && *Digit <= '9') ? (uint32)(*Digit - '0') : (bHex && D >= 'a' && D <= 'f') ? (uint32)(D - 'a' + 10) : 16;
+				if ( Value == 16 )
+					break;
+				Code = Code * (bHex ? 16 : 10) + Value;
+			}
+			if ( (Digit == Semicolon) && Code && (Code <= 0x10FFFF) )
+			{
+				Out += XMLParser::EncodeCharacter( Out, Code);
+				Text = Semicolon + 1;
+				continue;
+			}
+		}
+		else if ( Semicolon )
+		{
+			size_t i = 0;
+			size_t NameLen = Semicolon - Text;
+			while ( (i < ARRAY_COUNT(XMLEntities)) && ((CStrlen(XMLEntities[i].Name) != NameLen) || CStrncmp( Text + 1, XMLEntities[i].Name, NameLen)) )
+				i++;
+			if ( i < ARRAY_COUNT(XMLEntities) )
+			{
+				*Out++ = XMLEntities[i].Value;
+				Text = Semicolon + 1;
+				continue;
+			}
+		}
+		*Out++ = *Text++;
+	}
+	return Out - Start;
+}
+
+
+CParserStreamXML8::CParserStreamXML8()
+	: MaxTokenSize(0)
+	, Carry(nullptr)
+	, CarrySize(0)
+	, Names(nullptr)
+	, NamesSize(0)
+	, Scratch(nullptr)
+	, ScratchSize(0)
+{
+	Reset();
+}
+
+CParserStreamXML8::~CParserStreamXML8()
+{
+	if ( Carry )
+		CFree( Carry);
+	if ( Names )
+		CFree( Names);
+	if ( Scratch )
+		CFree( Scratch);
+}
+
+//
+// Unread data of the previous chunk is moved into the carry.
+//
+void CParserStreamXML8::Feed( const char* Data, size_t Len)
+{
+	if ( Pos < End )
+	{
+		AppendCarry( Pos, End - Pos);
+		Pos = End;
+	}
+	Pos = Data;
+	End = Data + Len;
+}
+
+void CParserStreamXML8::Finish()
+{
+	bFinished = true;
+}
+
+void CParserStreamXML8::Reset()
+{
+	Pos = End = nullptr;
+	CarryLen = CarryRead = 0;
+	ScanOffset = 0;
+	ScanQuote = 0;
+	ScanBrackets = 0;
+	Depth = 0;
+	AttrPos = AttrEnd = nullptr;
+	bEmptyElement = false;
+	Name = Value = "";
+	ValueLen = 0;
+	bPopName = false;
+	bFinished = false;
+	bDone = false;
+	bError = false;
+}
+
+//========= CParserStreamXML8::Next - begin ==========//
+//
+// Pending attributes and the end of a self closing element are sent
+// first, then tokens are read until one produces an event.
+//
+CParserStreamXML8::EEvent CParserStreamXML8::Next()
+{
+	if ( bError )
+		return XML_Error;
+	if ( bPopName )
+	{
+		bPopName = false;
+		bDone = (--Depth == 0);
+	}
+	if ( bDone )
+		return XML_Done;
+
+	if ( AttrPos )
+	{
+		if ( NextAttribute() )
+			return XML_Attribute;
+		if ( bError )
+			return XML_Error;
+		AttrPos = nullptr;
+		if ( bEmptyElement )
+		{
+			bEmptyElement = false;
+			bPopName = true;
+			Name = Names + NameStart[Depth-1];
+			return XML_EndElement;
+		}
+	}
+
+	const char* Start;
+	const char* TokenEnd;
+	while ( NextToken( Start, TokenEnd) )
+	{
+		size_t Len = TokenEnd - Start;
+		if ( *Start != '<' ) //Text
+		{
+			const char* C = Start;
+			while ( (C < TokenEnd) && XMLIsSpace(*C) )
+				C++;
+			if ( C == TokenEnd )
+				continue;
+			if ( !Depth )
+				return Error( "Text outside of root element");
+			Value = ScratchValue( 0, Start, Len, true);
+			return Value ? XML_Text : XML_Error;
+		}
+		if ( XMLStartsWith( Start, TokenEnd, XMLSections[0].Open) > 0 ) //Comment
+		{
+			Value = ScratchValue( 0, Start + 4, Len - 7, false);
+			return Value ? XML_Comment : XML_Error;
+		}
+		if ( XMLStartsWith( Start, TokenEnd, XMLSections[1].Open) > 0 ) //CDATA
+		{
+			if ( !Depth )
+				return Error( "CDATA outside of root element");
+			Value = ScratchValue( 0, Start + 9, Len - 12, false);
+			return Value ? XML_Text : XML_Error;
+		}
+		if ( (Start[1] == '?') || (Start[1] == '!') ) //Declarations and processing instructions
+			continue;
+		if ( Start[1] == '/' )
+			return EndElement( Start, TokenEnd);
+		return StartElement( Start, TokenEnd);
+	}
+
+	if ( bError )
+		return XML_Error;
+	if ( bFinished )
+		return Error( Depth ? "Unexpected end of document" : "No root element");
+	return XML_NeedData;
+}
+//========= CParserStreamXML8::Next - end ==========//
+
+//
+// Returns the next complete token (text or markup), from the carry if
+// it has unread data.
+// An incomplete token is moved into the carry along with the rest of
+// the chunk so it can be completed by the next one, tokens over the
+// size limit are rejected as soon as they're known to be.
+//
+bool CParserStreamXML8::NextToken( const char*& OutStart, const char*& OutEnd)
+{
+	for ( ; ; )
+	{
+		bool bCarry = (CarryRead < CarryLen);
+		const char* Text    = bCarry ? Carry + CarryRead : Pos;
+		const char* TextEnd = bCarry ? Carry + CarryLen : End;
+		if ( Text == TextEnd )
+			return false;
+
+		bool bFinal = bFinished && (!bCarry || (Pos == End));
+		const char* TokenEnd = FindTokenEnd( Text, TextEnd, bFinal);
+		if ( MaxTokenSize && ((size_t)((TokenEnd ? TokenEnd : TextEnd) - Text) > MaxTokenSize) )
+		{
+			Error( "Token too long");
+			return false;
+		}
+		if ( TokenEnd )
+		{
+			if ( bCarry )
+				CarryRead += TokenEnd - Text;
+			else
+				Pos = TokenEnd;
+			ScanOffset = 0;
+			ScanQuote = 0;
+			ScanBrackets = 0;
+			OutStart = Text;
+			OutEnd = TokenEnd;
+			return true;
+		}
+		if ( bFinal )
+		{
+			Error( "Unexpected end of document");
+			return false;
+		}
+		if ( Pos == End )
+			return false;
+		if ( !AppendCarry( Pos, End - Pos) )
+			return false;
+		Pos = End;
+	}
+}
+
+//
+// Returns the end of the token that starts at Text, null if the text
+// ends first. The search resumes where it stopped on the next call.
+//
+const char* CParserStreamXML8::FindTokenEnd( const char* Text, const char* TextEnd, bool bFinal)
+{
+	size_t Len = TextEnd - Text;
+	if ( *Text != '<' ) //Text runs up to the next markup
+	{
+		const char* Markup = (const char*)memchr( Text + ScanOffset, '<', Len - ScanOffset);
+		ScanOffset = Len;
+		return Markup ? Markup : (bFinal ? TextEnd : nullptr);
+	}
+
+	for ( size_t i=0 ; i<ARRAY_COUNT(XMLSections) ; i++ )
+	{
+		int32 Starts = XMLStartsWith( Text, TextEnd, XMLSections[i].Open);
+		if ( Starts < 0 )
+			return nullptr;
+		if ( Starts )
+		{
+			const char* Close = XMLSections[i].Close;
+			size_t CloseLen = CStrlen( Close);
+			for ( const char* C=Text+Max( ScanOffset, CStrlen(XMLSections[i].Open)+CloseLen-1) ; C<TextEnd ; C++ )
+				if ( (*C == '>') && !CStrncmp( C - (CloseLen - 1), Close, CloseLen) )
+					return C + 1;
+			ScanOffset = Max( ScanOffset, Len);
+			return nullptr;
+		}
+	}
+
+	// Tags and declarations, '>' may be quoted or inside a DOCTYPE internal subset
+	for ( const char* C=Text+Max<size_t>( ScanOffset, 1) ; C<TextEnd ; C++ )
+	{
+		if ( ScanQuote )
+		{
+			if ( *C == ScanQuote )
+				ScanQuote = 0;
+		}
+		else if ( (*C == '\x22') || (*C == '\x27') )
+			ScanQuote = *C;
+		else if ( *C == '[' )
+			ScanBrackets++;
+		else if ( *C == ']' )
+			ScanBrackets--;
+		else if ( (*C == '>') && (ScanBrackets <= 0) )
+			return C + 1;
+	}
+	ScanOffset = Len;
+	return nullptr;
+}
+
+CParserStreamXML8::EEvent CParserStreamXML8::StartElement( const char* Start, const char* TokenEnd)
+{
+	const char* NameEnd = Start + 1;
+	while ( (NameEnd < TokenEnd) && !XMLIsSpace(*NameEnd) && (*NameEnd != '/') && (*NameEnd != '>') )
+		NameEnd++;
+	if ( NameEnd == Start + 1 )
+		return Error( "Missing element name");
+	if ( !PushName( Start + 1, NameEnd - (Start + 1)) )
+		return XML_Error;
+
+	bEmptyElement = (TokenEnd[-2] == '/');
+	AttrPos = NameEnd;
+	AttrEnd = TokenEnd - (bEmptyElement ? 2 : 1);
+	Name = Names + NameStart[Depth-1];
+	return XML_StartElement;
+}
+
+CParserStreamXML8::EEvent CParserStreamXML8::EndElement( const char* Start, const char* TokenEnd)
+{
+	const char* NameEnd = Start + 2;
+	while ( (NameEnd < TokenEnd) && !XMLIsSpace(*NameEnd) && (*NameEnd != '>') )
+		NameEnd++;
+	size_t Len = NameEnd - (Start + 2);
+	if ( !Depth )
+		return Error( "Closing tag without open element");
+	const char* Open = Names + NameStart[Depth-1];
+	if ( (CStrlen(Open) != Len) || CStrncmp( Open, Start + 2, Len) )
+		return Error( CSprintf( "Closing tag doesn't match <%s>", Open));
+	Name = Open;
+	bPopName = true;
+	return XML_EndElement;
+}
+
+//
+// Reads the next attribute of the start tag, false if there's none left.
+//
+bool CParserStreamXML8::NextAttribute()
+{
+	const char* C = AttrPos;
+	while ( (C < AttrEnd) && XMLIsSpace(*C) )
+		C++;
+	if ( C == AttrEnd )
+		return false;
+
+	const char* KeyStart = C;
+	while ( (C < AttrEnd) && (*C != '=') && !XMLIsSpace(*C) )
+		C++;
+	size_t KeyLen = C - KeyStart;
+	while ( (C < AttrEnd) && XMLIsSpace(*C) )
+		C++;
+	if ( !KeyLen || (C == AttrEnd) || (*C++ != '=') )
+	{
+		Error( "Malformed attribute");
+		return false;
+	}
+	while ( (C < AttrEnd) && XMLIsSpace(*C) )
+		C++;
+	const char* ValueEnd = ((C < AttrEnd) && ((*C == '\x22') || (*C == '\x27'))) ? (const char*)memchr( C + 1, *C, AttrEnd - (C + 1)) : nullptr;
+	if ( !ValueEnd )
+	{
+		Error( "Unquoted attribute value");
+		return false;
+	}
+
+	AttrPos = ValueEnd + 1;
+	if ( !ScratchValue( 0, KeyStart, KeyLen, false) || !ScratchValue( KeyLen + 1, C + 1, ValueEnd - (C + 1), true) )
+		return false;
+	Name = Scratch;
+	Value = Scratch + KeyLen + 1;
+	return true;
+}
+
+CParserStreamXML8::EEvent CParserStreamXML8::Error( const char* Message)
+{
+	bError = true;
+	DebugCallback( CSprintf("CParserStreamXML8 -> %s", Message), CACUS_CALLBACK_PARSER );
+	return XML_Error;
+}
+
+//
+// Drops the part of the carry that has been read and appends new data.
+//
+bool CParserStreamXML8::AppendCarry( const char* Start, size_t Len)
+{
+	if ( CarryRead )
+	{
+		CarryLen -= CarryRead;
+		memmove( Carry, Carry + CarryRead, CarryLen);
+		CarryRead = 0;
+	}
+	if ( CarryLen + Len > CarrySize )
+	{
+		size_t NewSize = Max<size_t>( CarryLen + Len, Max<size_t>( CarrySize * 2, 256));
+		char* NewCarry = (char*)CRealloc( Carry, NewSize);
+		if ( !NewCarry )
+		{
+			Error( "Out of memory");
+			return false;
+		}
+		Carry = NewCarry;
+		CarrySize = NewSize;
+	}
+	CMemcpy( Carry + CarryLen, Start, Len);
+	CarryLen += Len;
+	return true;
+}
+
+bool CParserStreamXML8::PushName( const char* Start, size_t Len)
+{
+	if ( Depth >= MAX_DEPTH )
+	{
+		Error( "Nesting too deep");
+		return false;
+	}
+	size_t Offset = Depth ? NameStart[Depth-1] + CStrlen(Names + NameStart[Depth-1]) + 1 : 0;
+	if ( Offset + Len + 1 > NamesSize )
+	{
+		size_t NewSize = Max<size_t>( Offset + Len + 1, Max<size_t>( NamesSize * 2, 256));
+		char* NewNames = (char*)CRealloc( Names, NewSize);
+		if ( !NewNames )
+		{
+			Error( "Out of memory");
+			return false;
+		}
+		Names = NewNames;
+		NamesSize = NewSize;
+	}
+	CMemcpy( Names + Offset, Start, Len);
+	Names[Offset + Len] = '\0';
+	NameStart[Depth++] = Offset;
+	return true;
+}
+
+//
+// Copies text into the scratch buffer at Offset as a null terminated
+// string, decoding entities if requested.
+//
+char* CParserStreamXML8::ScratchValue( size_t Offset, const char* Start, size_t Len, bool bDecode)
+{
+	if ( Offset + Len + 1 > ScratchSize )
+	{
+		size_t NewSize = Max<size_t>( Offset + Len + 1, Max<size_t>( ScratchSize * 2, 256));
+		char* NewScratch = (char*)CRealloc( Scratch, NewSize);
+		if ( !NewScratch )
+		{
+			Error( "Out of memory");
+			return nullptr;
+		}
+		Scratch = NewScratch;
+		ScratchSize = NewSize;
+	}
+	char* Out = Scratch + Offset;
+	if ( bDecode && memchr( Start, '&', Len) )
+		ValueLen = XMLDecodeEntities( Out, Start, Len);
+	else
+	{
+		CMemcpy( Out, Start, Len);
+		ValueLen = Len;
+	}
+	Out[ValueLen] = '\0';
+	return Out;
+}
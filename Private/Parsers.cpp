@@ -13,7 +13,12 @@ bool CProperty::CParserLog = false;
 // PARSER ROOT
 
 #include "Internal/CParser.h"
-#define JSON_SKIP " \r\n"
+#include "Parser/JSONReader.h"
+#include "Parser/JSONWriter.h"
+#include "Parser/Binary.h"
+#define JSON_SKIP " \t\r\n"
+
+static const CName NAME_Class("Class");
 
 #ifdef _STRING_
 
@@ -44,6 +49,14 @@ void CParserElement::ExportAs( std::string& String, EParseType ExportType)
 
 bool DataToObject( const char* Data, void* Into, CProperty* Outer, EParseType ImportType)
 {
+	if ( ImportType == PARSE_JSON ) //Import directly without building an element tree
+		return DataViewToObject( Data, CStrlen(Data), Into, Outer, ImportType);
+	if ( ImportType == PARSE_Binary ) //The header can't be trusted to size the buffer
+	{
+		DebugCallback( "DataToObject: binary data requires its length, use DataViewToObject", CACUS_CALLBACK_PARSER );
+		return false;
+	}
+
 	CParser* Parser = CreateParser( Data, ImportType);
 	bool Result = Parser->Parse();
 	if ( Result )
@@ -52,10 +65,51 @@ bool DataToObject( const char* Data, void* Into, CProperty* Outer, EParseType Im
 	return Result;
 }
 
+//
+// Imports Len bytes of data that may not be null terminated.
+// JSON and binary data are read in place, other formats build an element
+// tree from a null terminated copy.
+//
+bool DataViewToObject( const char* Data, size_t Len, void* Into, CProperty* Outer, EParseType ImportType)
+{
+	if ( ImportType == PARSE_JSON )
+	{
+		CJSONReader Reader( Into, Outer);
+		return Reader.Feed( Data, Len) && Reader.Finish();
+	}
+	if ( ImportType == PARSE_Binary )
+	{
+		CBinaryReader Reader( Data, Len);
+		return Reader.ReadRoot( Outer, Into);
+	}
+
+	char* Text = (char*)CMalloc( Len + 1);
+	CMemcpy( Text, Data, Len);
+	Text[Len] = '\0';
+	bool Result = DataToObject( Text, Into, Outer, ImportType);
+	CFree( Text);
+	return Result;
+}
+
 void ObjectToData( std::string& OutData, void* From, CProperty* Outer, EParseType ExportType, int Delta)
 {
 	OutData.clear();
-	CParserElement ElementList(PEF_Root);
+	if ( ExportType == PARSE_JSON ) //Write directly without building an element tree
+	{
+		OutData.reserve(2048);
+		CJSONWriter Writer( OutData, Delta != 0);
+		Writer.WriteValue( Outer, From);
+		return;
+	}
+	if ( ExportType == PARSE_Binary )
+	{
+		CBinaryWriter Writer( OutData, Delta != 0);
+		Writer.WriteRoot( Outer, From);
+		return;
+	}
+
+	CMemExStack Mem(16384);
+	CParserElement ElementList(PEF_Root,Mem);
 	if ( Delta )
 		ElementList.Flags |= PEF_DeltaExport;
 	OutData.reserve(2048);
@@ -66,9 +120,27 @@ void ObjectToData( std::string& OutData, void* From, CProperty* Outer, EParseTyp
 	ElementList.ExportAs( OutData, ExportType);
 }
 
+void ObjectToDelta( std::string& OutDelta, void* Base, void* From, CProperty* Outer)
+{
+	OutDelta.clear();
+	CBinaryWriter Writer( OutDelta);
+	Writer.WriteDeltaRoot( Outer, Base, From);
+}
+
+bool DeltaToObject( const char* Delta, size_t Len, void* Into, CProperty* Outer)
+{
+	CBinaryReader Reader( Delta, Len); //Header size is checked against Len
+	return Reader.ReadDeltaRoot( Outer, Into);
+}
+
 bool DataToData( const char* InData, std::string& OutData, EParseType InFormat, EParseType OutFormat)
 {
 	OutData.clear();
+	if ( (InFormat == PARSE_Binary) || (OutFormat == PARSE_Binary) ) //Binary data can't be read without its properties
+	{
+		DebugCallback( "DataToData: binary format requires an object", CACUS_CALLBACK_PARSER );
+		return false;
+	}
 	CParser* Parser = CreateParser( InData, InFormat);
 	bool Result = Parser->Parse();
 	OutData = "";
@@ -81,9 +153,46 @@ bool DataToData( const char* InData, std::string& OutData, EParseType InFormat,
 	return Result;
 }
 
+//
+// Objects are copied through the copy plan of the destination struct if
+// it's the same as the source struct, or a non polymorphic super struct.
+//
+static bool CopyObject( void* From, void* Into, CProperty* FromOuter, CProperty* IntoOuter)
+{
+	void* FromObject = nullptr;
+	void* IntoObject = nullptr;
+	const CStruct* FromStruct = FromOuter->ExportObject( From, FromObject);
+	const CStruct* IntoStruct = IntoOuter->ExportObject( Into, IntoObject);
+	if ( !FromStruct || !FromObject || !IntoStruct )
+		return false;
+
+	CProperty* ClassProp = FromStruct->FindProperty( NAME_Class);
+	if ( FromStruct != IntoStruct )
+	{
+		if ( ClassProp )
+			return false;
+		while ( FromStruct && (FromStruct != IntoStruct) )
+			FromStruct = FromStruct->SuperStruct;
+		if ( !FromStruct )
+			return false;
+	}
+
+	if ( FromObject != IntoObject )
+	{
+		IntoObject = IntoOuter->ImportObject( Into, IntoStruct, ClassProp ? ClassProp->String( FromObject) : nullptr);
+		if ( IntoObject )
+			IntoStruct->CopyProperties( FromObject, IntoObject);
+	}
+	return true;
+}
+
 void ObjectToObject( void* From, void* Into, CProperty* FromOuter, CProperty* IntoOuter)
 {
-	CParserElement ElementList(PEF_Root);
+	if ( CopyObject( From, Into, FromOuter, IntoOuter) )
+		return;
+
+	CMemExStack Mem(16384);
+	CParserElement ElementList(PEF_Root,Mem);
 	FromOuter->Export( From, ElementList);
 	IntoOuter->Import( Into, ElementList);
 }
@@ -92,10 +201,83 @@ void ObjectToObject( void* From, void* Into, CProperty* FromOuter, CProperty* In
 //*******************************************************************
 // PARSER ELEMENT
 
-CParserElement::~CParserElement()
+//
+// Keys from parsed text are only looked up, otherwise untrusted input
+// could fill the name table with names that are never released.
+//
+void CParserElement::SetKey( const char* InKey, size_t InLen)
+{
+	Key = CName( InKey, InLen, CNAME_Find);
+	KeyText = nullptr;
+	if ( Key.IsNone() && InLen )
+	{
+		char* Text = (char*)Mem->PushBytes( InLen + 1, EALIGN_Byte);
+		CMemcpy( Text, InKey, InLen);
+		Text[InLen] = '\0';
+		KeyText = Text;
+	}
+}
+
+//
+// InText is the spelling of InKey, compared against keys kept as text
+// (their name may have been added after parsing).
+//
+bool CParserElement::MatchesKey( CName InKey, const char* InText) const
+{
+	if ( KeyText )
+		return InText && !CStricmp( KeyText, InText);
+	return (Key == InKey) && (!InKey.IsNone() || !InText || !*InText);
+}
+
+void CParserElement::SetValue( const char* InValue)
 {
-	LinkedListDelete(Children);
-	LinkedListDelete(Next);
+	SetValue( InValue, InValue ? CStrlen(InValue) : 0);
+}
+
+void CParserElement::SetValue( const char* InValue, size_t InLen)
+{
+	if ( InLen )
+	{
+		char* Text = (char*)Mem->PushBytes( InLen + 1, EALIGN_Byte);
+		CMemcpy( Text, InValue, InLen);
+		Text[InLen] = '\0';
+		Value = Text;
+	}
+	else
+		Value = "";
+	ValueLen = InLen;
+	Flags &= ~PEF_ValueView;
+}
+
+//
+// The end of a view may be the end of its buffer (mapped files), so
+// views are never read past ValueLen.
+//
+void CParserElement::SetValueView( const char* InValue, size_t InLen, bool bTerminated)
+{
+	Value = InValue;
+	ValueLen = InLen;
+	if ( bTerminated )
+		Flags &= ~PEF_ValueView;
+	else
+		Flags |= PEF_ValueView;
+}
+
+const char* CParserElement::GetValue() const
+{
+	if ( !(Flags & PEF_ValueView) )
+		return Value;
+	return CopyToBuffer( Value, ValueLen);
+}
+
+const char* CParserElement::GetArenaValue() const
+{
+	if ( !(Flags & PEF_ValueView) )
+		return Value;
+	char* Copy = (char*)Mem->PushBytes( ValueLen + 1, 1);
+	CMemcpy( Copy, Value, ValueLen);
+	Copy[ValueLen] = '\0';
+	return Copy;
 }
 
 void CParserElement::LogTokens( uint32 Depth)
@@ -107,9 +289,13 @@ void CParserElement::LogTokens( uint32 Depth)
 		std::string Text;
 		for ( i=0 ; i<Depth ; i++ )
 			Text += "  ";
-		Text += "Key " + Element->Key;
-		if ( Element->Value.length() > 0 )
-			Text += " = " + Element->Value;
+		Text += "Key ";
+		Text += Element->GetKey();
+		if ( Element->HasValue() )
+		{
+			Text += " = ";
+			Text.append( Element->Value, Element->ValueLen);
+		}
 		if ( Element->Flags & PEF_Array )
 			Text += " ARRAY";
 		if ( Element->Flags & PEF_Object )
@@ -137,20 +323,32 @@ uint32 CParserElement::CountTokens( const bool bCountChildren)
 	return Count;
 }
 
-CParserElement* CParserElement::GetChild( const char* ChildKey) const
+CParserElement* CParserElement::GetChild( CName ChildKey) const
 {
 	for ( auto* Link=Children ; Link ; Link=Link->Next )
-		if ( !_stricmp( Link->Key.c_str(), ChildKey) )
+		if ( Link->MatchesKey( ChildKey, *ChildKey) )
 			return Link;
 	return nullptr;
 }
 
-CParserElement* CParserElement::GetChild( const char* ChildKey, bool bCreate)
+CParserElement* CParserElement::GetChild( const char* ChildKey) const
 {
+	CName ChildName( ChildKey, CNAME_Find);
 	for ( auto* Link=Children ; Link ; Link=Link->Next )
-		if ( !_stricmp( Link->Key.c_str(), ChildKey) )
+		if ( Link->MatchesKey( ChildName, ChildKey) )
 			return Link;
-	return bCreate ? new CParserElement(*this,ChildKey) : nullptr;
+	return nullptr;
+}
+
+CParserElement* CParserElement::GetChild( const char* ChildKey, bool bCreate)
+{
+	CParserElement* Child = ((const CParserElement*)this)->GetChild( ChildKey);
+	if ( !Child && bCreate )
+	{
+		Child = AddChild();
+		Child->SetKey( ChildKey, ChildKey ? CStrlen(ChildKey) : 0);
+	}
+	return Child;
 }
 
 CParserElement* CParserElement::GetChild( uint32 ChildId, bool bCreate) //Should be used with array
@@ -161,7 +359,7 @@ CParserElement* CParserElement::GetChild( uint32 ChildId, bool bCreate) //Should
 		if ( *Ptr == nullptr ) //Chain not long enough
 		{
 			if ( bCreate )
-				*Ptr = new CParserElement( Flags & PEF_Inherit);
+				*Ptr = NewElement( Flags & PEF_Inherit);
 			else
 				break;
 		}
@@ -193,20 +391,26 @@ static bool JSON_NeedsStringQuote( const char* Value, size_t Len)
 
 void CParserElement::Export_JSONString( std::string& String)
 {
-	if ( Key.length() && !(Flags & PEF_Inner) )
-		String += CSprintf( "\x22%s\x22:", Key.c_str() );
+	if ( HasKey() && !(Flags & PEF_Inner) )
+	{
+		if ( KeyText )
+			CJSONWriter::WriteString( String, KeyText, CStrlen(KeyText));
+		else
+			CJSONWriter::WriteString( String, *Key, Key.Len());
+		String += ':';
+	}
 
 	if ( Flags & PEF_Object )
 		String += '{';
 	else if ( Flags & PEF_Array )
 		String += '[';
 
-	if ( Value.length() )
+	if ( HasValue() )
 	{
-		if ( (Flags & PEF_StringQuoted) || JSON_NeedsStringQuote( Value.c_str(), Value.length() ) )
-			String += CSprintf( "\x22%s\x22", Value.c_str() );
+		if ( (Flags & PEF_StringQuoted) || JSON_NeedsStringQuote( GetValue(), ValueLen) )
+			CJSONWriter::WriteString( String, Value, ValueLen);
 		else
-			String += Value;
+			String.append( Value, ValueLen);
 	}
 	else if ( Flags & PEF_Null )
 		String += "null";
@@ -226,41 +430,64 @@ void CParserElement::Export_JSONString( std::string& String)
 		String += ']';
 }
 
+//
+// Selects the struct named by ClassName (if registered) and creates the object if needed.
+// Returns nullptr if an existing object's class doesn't match ClassName.
+//
+static void* ResolveImportObject( const CStruct*& Struct, void*& Into, const char* ClassName)
+{
+	CStruct* ClassStruct = ClassName ? GetStruct( ClassName) : nullptr;
+	if ( ClassStruct )
+		Struct = ClassStruct;
+	if ( !Into )
+		Into = (*Struct->DefaultCreator)();
+	else if ( ClassName ) //Check for class mismatch, if mismatch then do not import
+	{
+		CProperty* ClassNameProp = Struct->FindProperty(NAME_Class);
+		if ( ClassNameProp && GetStruct(ClassNameProp->String(Into)) != ClassStruct )
+			return nullptr;
+	}
+	return Into;
+}
+
 void CParserElement::ParseObject( const CStruct* Struct, void*& Into) const
 {
 	if ( Flags & PEF_Object )
 	{
+		const char* ClassName = nullptr;
 		for ( CParserElement* Elem=Children ; Elem ; Elem=Elem->Next )
-			if ( _stricmp( Elem->Key.c_str(), "Class") )
+			if ( Elem->Key == NAME_Class )
 			{
-				CStruct* StructOther = GetStruct( Elem->Value.c_str() );
-				if ( StructOther )
-				{
-					Struct = StructOther;
+				ClassName = Elem->GetValue();
+				if ( GetStruct( ClassName) )
 					break;
-				}
-			}
-		if ( !Into )
-			Into = (*Struct->DefaultCreator)();
-		else //Check for class mismatch, if mismatch then do not import
-		{
-			CProperty* ClassNameProp;
-			CParserElement* ClassNameElem;
-			if ( (ClassNameProp=Struct->FindProperty("Class")) != nullptr
-				&& (ClassNameElem=GetChild("Class")) != nullptr  //We have a class descriptor in struct and element
-				&& _stricmp(ClassNameProp->Name,ClassNameElem->Key.c_str()) ) //But it's a mismatch
-			{
-				return; //Do not import
 			}
-		}
+		if ( !ResolveImportObject( Struct, Into, ClassName) )
+			return; //Do not import
+
+		// Primitive values are collected and parsed in a single batch
+		// Views are copied to the arena, other imports reuse the circular buffer
+		const char* PrimitiveText[64];
+		bool bBatch = Struct->PropertyTable && (Struct->PropertyCount <= ARRAY_COUNT(PrimitiveText));
+		if ( bBatch )
+			memset( PrimitiveText, 0, sizeof(const char*) * Struct->PropertyCount);
 		for ( CParserElement* Elem=Children ; Elem ; Elem=Elem->Next )
 		{
-			CProperty* Property = Struct->FindProperty( Elem->Key.c_str() );
+			CName ElemKey = Elem->KeyText ? CName( Elem->KeyText, CNAME_Find) : Elem->Key; //Struct may have been created after parsing
+			int32 Index = bBatch ? Struct->FindPropertyIndex( ElemKey) : -1;
+			CProperty* Property = bBatch ? ((Index >= 0) ? Struct->PropertyTable[Index] : nullptr) : Struct->FindProperty( ElemKey);
 			if ( Property && !(Property->PropertyFlags & PF_NoImport) )
-				Property->Import( Into, *Elem );
+			{
+				if ( bBatch && Struct->PrimitiveTypes[Index] )
+					PrimitiveText[Index] = Elem->GetArenaValue();
+				else
+					Property->Import( Into, *Elem );
+			}
 			else
-				DebugCallback( CSprintf("ParseObject: property not found %s", Elem->Key.c_str()), CACUS_CALLBACK_PARSER );
+				DebugCallback( CSprintf("ParseObject: property not found %s", Elem->GetKey()), CACUS_CALLBACK_PARSER );
 		}
+		if ( bBatch )
+			Struct->ImportPrimitives( Into, 0, 1, PrimitiveText);
 		if ( Struct->PostParseFunction )
 			(*Struct->PostParseFunction)(Into);
 	}
@@ -290,7 +517,7 @@ void CParserElement::ExportObject( const CStruct* Struct, void* From, bool Root)
 	{
 		CStruct* RealStruct;
 		CProperty* ClassProp;
-		if ( (ClassProp = Struct->FindProperty("Class")) != nullptr
+		if ( (ClassProp = Struct->FindProperty(NAME_Class)) != nullptr
 			&& (RealStruct = GetStruct(ClassProp->String(From))) != nullptr )
 			Struct = RealStruct;
 	}
@@ -301,7 +528,7 @@ void CParserElement::ExportObject( const CStruct* Struct, void* From, bool Root)
 	for ( CProperty* Link=Struct->Properties ; Link ; Link=Link->NextProperty )
 		if ( Link->ShouldExport(From, Delta) )
 		{
-			CParserElement* NewElement = new CParserElement( *this, Link->Name);
+			CParserElement* NewElement = AddChild( Link->NameHandle);
 			NewElement->TypeName = Link->TypeName();
 			Link->Export( From, *NewElement);
 			//TODO: EMPTY PROPERTYSTRUCT NEEDS TO BE REMOVED (PTR VERSION NOT BECAUSE IT CALLS NEW() )
@@ -310,11 +537,11 @@ void CParserElement::ExportObject( const CStruct* Struct, void* From, bool Root)
 
 bool CParserElement::operator==( const CParserElement & Other) const
 {
-	return Flags==Other.Flags
-		&& Key.length() == Other.Key.length() //Visual Studio STL does not do length check on ==
-		&& Value.length() == Other.Value.length()
-		&& Key==Other.Key
-		&& Value==Other.Value;
+	return (Flags & ~PEF_ValueView) == (Other.Flags & ~PEF_ValueView)
+		&& Key == Other.Key
+		&& (!KeyText == !Other.KeyText) && (!KeyText || !CStricmp( KeyText, Other.KeyText))
+		&& ValueLen == Other.ValueLen
+		&& !CStrncmp( Value, Other.Value, ValueLen);
 }
 
 uint32 CParserElement::RemoveFlaggedTokens( CParserElement** TokenList, int32 Flags)
@@ -325,8 +552,7 @@ uint32 CParserElement::RemoveFlaggedTokens( CParserElement** TokenList, int32 Fl
 		CParserElement* Token = *TokenList;
 		if ( Token->Flags & Flags )
 		{
-			*TokenList = Token->Next;
-			delete Token;
+			*TokenList = Token->Next; //Memory is owned by the arena
 			Removed++;
 		}
 		else
@@ -339,9 +565,35 @@ uint32 CParserElement::RemoveFlaggedTokens( CParserElement** TokenList, int32 Fl
 //*******************************************************************
 // JSON TEXT
 
+bool CJSONParser::UseStructuralIndex = true;
+
+CJSONParser::CJSONParser( const char* InData)
+	: CParser(InData)
+	, bInSitu(false)
+	, Scanner(InData, InData ? CStrlen(InData) : 0)
+{}
+
+CJSONParser::CJSONParser( char* InData, bool bInSitu)
+	: CParser(InData)
+	, bInSitu(bInSitu)
+	, Scanner(InData, InData ? CStrlen(InData) : 0)
+{}
+
+//
+// Whitespace is never indexed by the scanner, so the next token
+// start is the next non-whitespace character.
+//
+inline void CJSONParser::SkipWhitespace()
+{
+	if ( !UseStructuralIndex )
+		AdvanceThrough( Data, JSON_SKIP);
+	else if ( *Data == ' ' || *Data == '\t' || *Data == '\r' || *Data == '\n' )
+		Data = Scanner.Next( Data);
+}
+
 bool CJSONParser::Parse()
 {
-	AdvanceThrough( Data, JSON_SKIP);
+	SkipWhitespace();
 	bool Result = 
 		  (*Data == '{') ? ParseObject(&RootElement)
 		: (*Data == '[') ? ParseArray( &RootElement)
@@ -353,27 +605,29 @@ bool CJSONParser::Parse()
 
 bool CJSONParser::ParseKey( CParserElement* Parent)
 {
-	AdvanceThrough( Data, JSON_SKIP);
+	SkipWhitespace();
 	if ( *Data == '\x22' ) // " >> this is a key
 	{
-		size_t Position = 0;
-		char* TKey = ParseToken( Data, &Position); 
-		Data += Position;
-		AdvanceThrough( Data, JSON_SKIP);
-		if ( TKey && (*Data == ':') ) //Token and ':' needed
+		const char* KeyStart;
+		size_t KeyLen;
+		bool bTerminated;
+		bool bValidKey = ParseString( KeyStart, KeyLen, bTerminated);
+		SkipWhitespace();
+		if ( bValidKey && (*Data == ':') ) //Token and ':' needed
 		{
 			Data++;
-			CParserElement* Element = new CParserElement(*Parent,TKey); //Properties are unordered
+			CParserElement* Element = Parent->AddChild(); //Properties are unordered
+			Element->SetKey( KeyStart, KeyLen);
 			return ParseValue( Element );
 		}
-		DebugCallback( CSprintf( "CJSONParser::ParseKey -> Error (Key=%s)", TKey ? TKey : "null"), CACUS_CALLBACK_PARSER );
+		DebugCallback( CSprintf( "CJSONParser::ParseKey -> Error (Key=%s)", bValidKey ? CopyToBuffer(KeyStart,KeyLen) : "null"), CACUS_CALLBACK_PARSER );
 	}
 	return false;
 }
 
 bool CJSONParser::ParseValue( CParserElement* Element)
 {
-	AdvanceThrough( Data, JSON_SKIP);
+	SkipWhitespace();
 	if ( *Data == '{' ) //New Object
 		return ParseObject( Element);
 	else if ( *Data == '[' ) //New Array
@@ -385,37 +639,204 @@ bool CJSONParser::ParseValue( CParserElement* Element)
 	//Empty value
 	else //Token
 	{
-		bool bStringToken = (*Data == '\x22');
-		size_t Position = 0;
-		char* TVal = ParseToken( Data, &Position);
-		if ( TVal )
+		const char* TokenStart;
+		size_t TokenLen;
+		bool bTerminated;
+		if ( *Data == '\x22' )
 		{
-			Data += Position;
-			if ( !bStringToken && !strcmp(TVal,"null") )
-				Element->Flags |= PEF_Null;
-			else
+			if ( ParseString( TokenStart, TokenLen, bTerminated) )
 			{
-				Element->Value = TVal;
-				if ( bStringToken )
-					Element->Flags |= PEF_StringQuoted;
+				Element->SetValueView( TokenStart, TokenLen, bTerminated);
+				Element->Flags |= PEF_StringQuoted;
+				return true;
 			}
+		}
+		else if ( ParseLiteral( TokenStart, TokenLen, bTerminated) )
+		{
+			if ( (TokenLen == 4) && !CStrncmp( TokenStart, "null", 4) )
+				Element->Flags |= PEF_Null;
+			else
+				Element->SetValueView( TokenStart, TokenLen, bTerminated);
 			return true;
 		}
-		DebugCallback( CSprintf( "CJSONParser::ParseValue -> Couldn't parse value for %s [%s]", Element->Key.c_str(), Element->Value.c_str() ), CACUS_CALLBACK_PARSER );
+		DebugCallback( CSprintf( "CJSONParser::ParseValue -> Couldn't parse value for %s", Element->GetKey()), CACUS_CALLBACK_PARSER );
 	}
 	return false;
 }
 
+//
+// Reads a quoted string starting at Data into a span.
+// Unescaped strings point into the source, escaped strings are decoded
+// in place if parsing in-situ, otherwise into the arena.
+// In-situ and decoded strings are always null terminated.
+//
+bool CJSONParser::ParseString( const char*& OutStart, size_t& OutLen, bool& bOutTerminated)
+{
+	const char* Start = ++Data;
+	bool bEscaped = false;
+	if ( UseStructuralIndex ) //Closing quote is the next token
+	{
+		Data = Scanner.Next( Start);
+		if ( *Data != '\x22' )
+			return false;
+		bEscaped = memchr( Start, '\\', (size_t)(Data - Start)) != nullptr;
+	}
+	else
+	{
+		char C;
+		while ( (C=*Data) != '\x22' )
+		{
+			if ( C == '\0' )
+				return false;
+			if ( C == '\\' )
+			{
+				bEscaped = true;
+				if ( *++Data == '\0' )
+					return false;
+			}
+			Data++;
+		}
+	}
+	size_t RawLen = (size_t)(Data++ - Start);
+
+	if ( !bEscaped )
+	{
+		OutStart = Start;
+		OutLen = RawLen;
+		if ( bInSitu )
+			((char*)Start)[RawLen] = '\0';
+		bOutTerminated = bInSitu;
+		return true;
+	}
+
+	char* Dest = bInSitu ? (char*)Start : (char*)Mem.PushBytes( RawLen + 1, EALIGN_Byte);
+	OutLen = Unescape( Dest, Start, RawLen);
+	OutStart = Dest;
+	bOutTerminated = true;
+	return OutLen != NPOS;
+}
+
+//
+// Reads a number or literal starting at Data into a span.
+// The span is only null terminated if parsing in-situ and the token
+// is followed by whitespace.
+//
+bool CJSONParser::ParseLiteral( const char*& OutStart, size_t& OutLen, bool& bOutTerminated)
+{
+	const char* Start = Data;
+	while ( (*Data >= 'a' && *Data <= 'z') || (*Data >= '0' && *Data <= '9') || *Data == '-' || *Data == '+' || *Data == '.' || *Data == 'E' )
+		Data++;
+	if ( Data == Start )
+		return false;
+	OutStart = Start;
+	OutLen = (size_t)(Data - Start);
+	bOutTerminated = bInSitu && (*Data == ' ' || *Data == '\t' || *Data == '\r' || *Data == '\n');
+	if ( bOutTerminated )
+		*(char*)Data++ = '\0';
+	return true;
+}
+
+static int32 JSON_HexQuad( const char* Src)
+{
+	int32 Result = 0;
+	for ( int32 i=0 ; i<4 ; i++ )
+	{
+		char C = Src[i];
+		int32 Digit = (C >= '0' && C <= '9') ? (C - '0')
+		            : (C >= 'a' && C <= 'f') ? (C - 'a' + 10)
+		            : (C >= 'A' && C <= 'F') ? (C - 'A' + 10)
+		            : -1;
+		if ( Digit < 0 )
+			return -1;
+		Result = (Result << 4) | Digit;
+	}
+	return Result;
+}
+
+//
+// Decodes JSON escape sequences, Dest may be the same as Src.
+// Output is null terminated and never longer than input.
+// Returns NPOS on malformed escape sequences.
+//
+size_t CJSONParser::Unescape( char* Dest, const char* Src, size_t SrcLen)
+{
+	const char* SrcEnd = Src + SrcLen;
+	char* Out = Dest;
+	while ( Src < SrcEnd )
+	{
+		if ( *Src != '\\' )
+		{
+			*Out++ = *Src++;
+			continue;
+		}
+		if ( ++Src >= SrcEnd )
+			return NPOS;
+		switch ( *Src++ )
+		{
+		case '\x22': *Out++ = '\x22'; break;
+		case '\\':   *Out++ = '\\';   break;
+		case '/':    *Out++ = '/';    break;
+		case 'b':    *Out++ = '\b';   break;
+		case 'f':    *Out++ = '\f';   break;
+		case 'n':    *Out++ = '\n';   break;
+		case 'r':    *Out++ = '\r';   break;
+		case 't':    *Out++ = '\t';   break;
+		case 'u':
+		{
+			int32 Code = (Src + 4 <= SrcEnd) ? JSON_HexQuad( Src) : -1;
+			if ( Code < 0 )
+				return NPOS;
+			Src += 4;
+			if ( (Code >= 0xD800) && (Code <= 0xDBFF) && (Src + 6 <= SrcEnd) && (Src[0] == '\\') && (Src[1] == 'u') ) //Surrogate pair
+			{
+				int32 Low = JSON_HexQuad( Src + 2);
+				if ( (Low >= 0xDC00) && (Low <= 0xDFFF) )
+				{
+					Code = 0x10000 + ((Code - 0xD800) << 10) + (Low - 0xDC00);
+					Src += 6;
+				}
+			}
+			// UTF-8 output never exceeds the 6 (or 12) input characters
+			if ( Code < 0x80 )
+				*Out++ = (char)Code;
+			else if ( Code < 0x800 )
+			{
+				*Out++ = (char)(0xC0 | (Code >> 6));
+				*Out++ = (char)(0x80 | (Code & 0x3F));
+			}
+			else if ( Code < 0x10000 )
+			{
+				*Out++ = (char)(0xE0 | (Code >> 12));
+				*Out++ = (char)(0x80 | ((Code >> 6) & 0x3F));
+				*Out++ = (char)(0x80 | (Code & 0x3F));
+			}
+			else
+			{
+				*Out++ = (char)(0xF0 | (Code >> 18));
+				*Out++ = (char)(0x80 | ((Code >> 12) & 0x3F));
+				*Out++ = (char)(0x80 | ((Code >> 6) & 0x3F));
+				*Out++ = (char)(0x80 | (Code & 0x3F));
+			}
+			break;
+		}
+		default:
+			return NPOS;
+		}
+	}
+	*Out = '\0';
+	return (size_t)(Out - Dest);
+}
+
 bool CJSONParser::ParseObject( CParserElement* Element)
 {
-	AdvanceThrough( Data, JSON_SKIP);
+	SkipWhitespace();
 	Element->Flags = PEF_Object;
 	if ( *Data++ == '{' ) //Needed in case we're parsing a master container (MLUser)
 	{
 		uint32 PropCount = 0;
 		do
 		{
-			AdvanceThrough( Data, JSON_SKIP);
+			SkipWhitespace();
 			if ( *Data == '}' )
 			{
 				Data++;
@@ -426,7 +847,7 @@ bool CJSONParser::ParseObject( CParserElement* Element)
 
 			if ( (PropCount++ != 0) && (*Data++ != ',') )
 			{
-				DebugCallback( CSprintf("CJSONParser::ParseObject -> New child failure in object %s", Element->Key.c_str()), CACUS_CALLBACK_PARSER );
+				DebugCallback( CSprintf("CJSONParser::ParseObject -> New child failure in object %s", Element->GetKey()), CACUS_CALLBACK_PARSER );
 				TChar8Buffer<32> TmpBuf = Data;
 				DebugCallback( CSprintf("CJSONParser::ParseObject -> Next data in parsing line is [%s ...]", *TmpBuf), CACUS_CALLBACK_PARSER );
 				break;
@@ -439,7 +860,7 @@ bool CJSONParser::ParseObject( CParserElement* Element)
 
 bool CJSONParser::ParseArray( CParserElement* Container)
 {
-	AdvanceThrough( Data, JSON_SKIP);
+	SkipWhitespace();
 	Container->Flags = PEF_Array;
 
 	if ( *Data++ == '[' ) //Needed in case we're parsing a master array (MLCurrency)
@@ -449,7 +870,7 @@ bool CJSONParser::ParseArray( CParserElement* Container)
 		CParserElement** InsertChildRef = &Container->Children;
 		do
 		{
-			AdvanceThrough( Data, JSON_SKIP);
+			SkipWhitespace();
 			if ( *Data == ']' )
 			{
 				Data++;
@@ -458,11 +879,11 @@ bool CJSONParser::ParseArray( CParserElement* Container)
 
 			if ( (ArrayNum++ != 0) && (*Data++ != ',') )
 			{
-				DebugCallback( CSprintf("CJSONParser::ParseArray -> New child failure in array variable %s", Container->Key.c_str()), CACUS_CALLBACK_PARSER );
+				DebugCallback( CSprintf("CJSONParser::ParseArray -> New child failure in array variable %s", Container->GetKey()), CACUS_CALLBACK_PARSER );
 				break;
 			}
 
-			InsertChildRef[0] = LastChild = new CParserElement( Container->Flags & PEF_Inherit); //Preserve order of array elements
+			InsertChildRef[0] = LastChild = Container->NewElement( Container->Flags & PEF_Inherit); //Preserve order of array elements
 			InsertChildRef = &LastChild->Next;
 		} while ( ParseValue(LastChild) );
 	}
@@ -504,7 +925,7 @@ bool CPlainTextFormParser::ParseMembers( CParserElement* Parent)
 		return ParseArray( Parent);
 	if ( *Line == '=' ) //End
 	{
-		Parent->Value = ++Line;
+		Parent->SetValue( ++Line);
 		return true;
 	}
 	return false;
@@ -531,7 +952,7 @@ bool CPlainTextFormParser::ParseArray( CParserElement* Container)
 			else if ( *ArrayKey == '\0' )  //  [] - consider as 'last'
 			{
 				if ( Container->GetChild(30) == nullptr ) //No more than 30
-					SelectedNode = Container->AddChildLast( new CParserElement(Container->Flags&PEF_Inherit) );
+					SelectedNode = Container->AddChildLast( Container->NewElement(Container->Flags&PEF_Inherit) );
 			}
 
 			if ( SelectedNode )
@@ -539,7 +960,7 @@ bool CPlainTextFormParser::ParseArray( CParserElement* Container)
 				for ( ; *Line==' ' ; Line++ ); //Space skipper
 				if ( *Line == '=' )
 				{
-					SelectedNode->Value = ++Line;
+					SelectedNode->SetValue( ++Line);
 					return true;
 				}
 				return ParseMembers( SelectedNode);
@@ -585,8 +1006,9 @@ void PropertyStdVectorBase::_ImportNextChild( void* Into, CParserElement*& Child
 void CProperty::Import( void* Into, const CParserElement& Elem) const
 {
 #ifdef _STRING_
-	if ( !Parse( Into, Elem.Value.c_str() ) )
-		DebugCallback( CSprintf("Import failed for element [%s] with value %s", Elem.Key.c_str(), Elem.Value.c_str()), CACUS_CALLBACK_PARSER );
+	const char* Value = Elem.GetValue();
+	if ( !Parse( Into, Value) )
+		DebugCallback( CSprintf("Import failed for element [%s] with value %s", Elem.GetKey(), Value), CACUS_CALLBACK_PARSER );
 #endif
 }
 
@@ -659,12 +1081,123 @@ void PropertyStructPtr::Import( void* Into, const CParserElement& Elem) const
 }
 
 
+//Stream importers - resolve import destinations as values arrive
+void* PropertyStruct::ImportObject( void* Into, const CStruct*& OutStruct, const char* ClassName) const
+{
+	void* Address = AddressOffset( Into, Offset);
+	OutStruct = Model;
+	return ResolveImportObject( OutStruct, Address, ClassName);
+}
+
+void* PropertyStructPtr::ImportObject( void* Into, const CStruct*& OutStruct, const char* ClassName) const
+{
+	void** Address = AddressOffset<void*>( Into, Offset);
+	OutStruct = Model;
+	return ResolveImportObject( OutStruct, *Address, ClassName);
+}
+
+bool PropertyFixedArray::ImportArray( void* Into) const
+{
+	GetProp<Primitive>(Into).Setup( 0, 0);
+	return true;
+}
+
+void* PropertyFixedArray::ImportArrayElement( void* Into, size_t Index) const
+{
+	CFixedArray& Array = GetProp<Primitive>(Into);
+	if ( Index >= Array.Size() ) //Grow geometrically, trimmed at end
+		Array.Setup( Max<size_t>( Index + 1, Array.Size() * 2), Inner->ElementSize);
+	return AddressOffset( Array.GetData(), Inner->ElementSize * Index);
+}
+
+void PropertyFixedArray::ImportArrayEnd( void* Into, size_t Count) const
+{
+	GetProp<Primitive>(Into).Setup( Count, Inner->ElementSize);
+}
+
+#ifdef _VECTOR_
+bool PropertyMasterObjectArray::ImportArray( void* Into) const
+{
+	GetProp<Primitive>(Into).Empty(); //Destruction handled here
+	return true;
+}
+
+void* PropertyMasterObjectArray::ImportArrayElement( void* Into, size_t Index) const
+{
+	auto& Array = GetProp<Primitive>(Into);
+	void* NewObject = (*Inner->Model->DefaultCreator)();
+	CSleepLock SL( &Array.Lock);
+	Array.List.push_back( NewObject);
+	return &Array.List.back(); //Valid until next element is added
+}
+
+bool PropertyStdVectorBase::ImportArray( void* Into) const
+{
+	VectorSetSize( Into, 0);
+	return true;
+}
+
+void* PropertyStdVectorBase::ImportArrayElement( void* Into, size_t Index) const
+{
+	VectorSetSize( Into, Index + 1);
+	return VectorGetElement( Into, Index); //Valid until next element is added
+}
+#endif
+
+//Stream exporters - expose object and array contents to writers
+const CStruct* PropertyStruct::ExportObject( void* From, void*& OutObject) const
+{
+	OutObject = AddressOffset( From, Offset);
+	return Model;
+}
+
+const CStruct* PropertyStructPtr::ExportObject( void* From, void*& OutObject) const
+{
+	OutObject = *AddressOffset<void*>( From, Offset);
+	return Model;
+}
+
+bool PropertyFixedArray::ExportArray( void* From, size_t& OutCount) const
+{
+	OutCount = GetProp<Primitive>(From).Size();
+	return true;
+}
+
+void* PropertyFixedArray::ExportArrayElement( void* From, size_t Index) const
+{
+	return AddressOffset( GetProp<Primitive>(From).GetData(), Inner->ElementSize * Index);
+}
+
+#ifdef _VECTOR_
+bool PropertyMasterObjectArray::ExportArray( void* From, size_t& OutCount) const
+{
+	OutCount = GetProp<Primitive>(From).List.size();
+	return true;
+}
+
+void* PropertyMasterObjectArray::ExportArrayElement( void* From, size_t Index) const
+{
+	return &GetProp<Primitive>(From).List[Index];
+}
+
+bool PropertyStdVectorBase::ExportArray( void* From, size_t& OutCount) const
+{
+	OutCount = VectorGetSize( From);
+	return true;
+}
+
+void* PropertyStdVectorBase::ExportArrayElement( void* From, size_t Index) const
+{
+	return VectorGetElement( From, Index);
+}
+#endif
+
 //Exporters - create sub-elements using property data (root element must exist)
 void CProperty::Export( void* From, CParserElement& Elem) const
 {
 #ifdef _STRING_
-	Elem.Key = Name;
-	Elem.Value = String(From);
+	Elem.Key = NameHandle;
+	Elem.SetValue( String(From));
 	if ( IsText() )
 		Elem.Flags |= PEF_StringQuoted;
 	if ( PropertyFlags & PF_NullDefault )
@@ -683,7 +1216,7 @@ void PropertyFixedArray::Export( void* From, CParserElement& Elem) const
 	uint8* Address = AddressOffset<uint8>( Array.GetData(), (int_p)Inner->ElementSize * i);
 	for ( ; i>=0 ; i-- ) //Backwards loop to keep Array order
 	{
-		CParserElement* Child = new CParserElement( Elem);
+		CParserElement* Child = Elem.AddChild();
 		Inner->Export( Address, *Child);
 		Address -= Inner->ElementSize;
 	}
@@ -699,7 +1232,7 @@ void PropertyMasterObjectArray::Export( void* From, CParserElement& Elem) const
 	CSleepLock(&Array.Lock,0);
 	for ( int_p i=(int_p)Array.List.size() - 1 ; i>=0 ; i-- ) //Backwards loop to keep Array order
 	{
-		CParserElement* Child = new CParserElement( Elem);
+		CParserElement* Child = Elem.AddChild();
 		Inner->Export( &Array.List[i], *Child);
 	}
 #endif
@@ -710,9 +1243,9 @@ void PropertyStdVectorBase::Export( void* From, CParserElement& Elem) const
 #ifdef _STRING_
 	Elem.Flags |= PEF_Array;
 	int_p ListSize = VectorGetSize(From);
-	for ( int_p i=ListSize-1; i>=0; i++)
+	for ( int_p i=ListSize-1; i>=0; i--) //Backwards loop to keep Array order
 	{
-		CParserElement* Child = new CParserElement(Elem);
+		CParserElement* Child = Elem.AddChild();
 		Inner->Export( VectorGetElement(From,i), *Child);
 	}
 #endif
@@ -22,6 +22,7 @@
 
 #else
 #include <pthread.h>
+#include <unistd.h>
 
 
 #endif
@@ -190,4 +191,118 @@ int CThread::WaitFinish( float MaxWait)
 		}
 	}
 	return tId == 0;
-}
\ No newline at end of file
+}
+
+
+//---------- CEvent begin ----------//
+#if _WINDOWS
+CEvent::CEvent( bool bManualReset)
+{
+	Handle = CreateEventW( nullptr, bManualReset, FALSE, nullptr);
+}
+
+CEvent::~CEvent()
+{
+	if ( Handle )
+		CloseHandle( Handle);
+}
+
+void CEvent::Signal()
+{
+	SetEvent( Handle);
+}
+
+void CEvent::Reset()
+{
+	ResetEvent( Handle);
+}
+
+bool CEvent::Wait( double MaxWait)
+{
+	DWORD Milliseconds = (MaxWait < 0) ? INFINITE : (DWORD)(MaxWait * 1000.0);
+	return WaitForSingleObject( Handle, Milliseconds) == WAIT_OBJECT_0;
+}
+
+#else
+struct CEventPosix
+{
+	pthread_mutex_t Mutex;
+	pthread_cond_t  Cond;
+	bool            bSignaled;
+	bool            bManualReset;
+};
+
+CEvent::CEvent( bool bManualReset)
+{
+	CEventPosix* Event = new CEventPosix;
+	pthread_mutex_init( &Event->Mutex, nullptr);
+	pthread_cond_init( &Event->Cond, nullptr);
+	Event->bSignaled = false;
+	Event->bManualReset = bManualReset;
+	Handle = Event;
+}
+
+CEvent::~CEvent()
+{
+	CEventPosix* Event = (CEventPosix*)Handle;
+	pthread_cond_destroy( &Event->Cond);
+	pthread_mutex_destroy( &Event->Mutex);
+	delete Event;
+}
+
+void CEvent::Signal()
+{
+	CEventPosix* Event = (CEventPosix*)Handle;
+	pthread_mutex_lock( &Event->Mutex);
+	Event->bSignaled = true;
+	if ( Event->bManualReset )
+		pthread_cond_broadcast( &Event->Cond);
+	else
+		pthread_cond_signal( &Event->Cond);
+	pthread_mutex_unlock( &Event->Mutex);
+}
+
+void CEvent::Reset()
+{
+	CEventPosix* Event = (CEventPosix*)Handle;
+	pthread_mutex_lock( &Event->Mutex);
+	Event->bSignaled = false;
+	pthread_mutex_unlock( &Event->Mutex);
+}
+
+bool CEvent::Wait( double MaxWait)
+{
+	CEventPosix* Event = (CEventPosix*)Handle;
+	timespec EndTime;
+	if ( MaxWait >= 0 )
+	{
+		clock_gettime( CLOCK_REALTIME, &EndTime);
+		double Seconds = (double)EndTime.tv_nsec * 1e-9 + MaxWait;
+		EndTime.tv_sec += (time_t)Seconds;
+		EndTime.tv_nsec = (long)((Seconds - (double)(time_t)Seconds) * 1e9);
+	}
+	pthread_mutex_lock( &Event->Mutex);
+	int Result = 0;
+	while ( !Event->bSignaled && !Result )
+		Result = (MaxWait < 0) ? pthread_cond_wait( &Event->Cond, &Event->Mutex) : pthread_cond_timedwait( &Event->Cond, &Event->Mutex, &EndTime);
+	bool bSignaled = Event->bSignaled;
+	if ( bSignaled && !Event->bManualReset )
+		Event->bSignaled = false;
+	pthread_mutex_unlock( &Event->Mutex);
+	return bSignaled;
+}
+#endif
+//---------- CEvent end ----------//
+
+
+uint32 CGetProcessorCount()
+{
+#if _WINDOWS
+	SYSTEM_INFO Info;
+	GetSystemInfo( &Info);
+	return (Info.dwNumberOfProcessors > 0) ? (uint32)Info.dwNumberOfProcessors : 1;
+#else
+	long Count = sysconf( _SC_NPROCESSORS_ONLN);
+	return (Count > 0) ? (uint32)Count : 1;
+#endif
+}
@@ -17,6 +17,7 @@
 #include "Atomics.h"
 #include "DebugCallback.h"
 #include "CTickerEngine.h"
+#include "NetworkSocket.h"
 
 
 #ifdef _WINDOWS
@@ -62,6 +63,8 @@ CTickerEngine::CTickerEngine()
 	if ( FPlatformTime::GetSecondsPerCycle() == 0 )
 		FPlatformTime::InitTiming();
 	LastSleepExitTime = 0;
+	TickCount = 0;
+	Poller = nullptr;
 	UpdateTimerResolution();
 	LastTickTimestamp = FPlatformTime::Seconds();
 	LastInterval = 0;
@@ -88,6 +91,19 @@ void CTickerEngine::NativeSleep( double Time)
 //	debugf( TEXT("NATIVESLEEP %i"), SleepTime);
 }
 
+//============== Sleep used by ticks, services the socket poller if set
+//
+void CTickerEngine::IdleSleep( double Time)
+{
+	if ( Poller )
+	{
+		Poller->DispatchFor( Time);
+		LastSleepExitTime = FPlatformTime::Seconds();
+	}
+	else
+		NativeSleep( Time);
+}
+
 //============== Yield implementation, zero case of sleep
 //
 void CTickerEngine::NativeYield()
@@ -214,7 +230,7 @@ double CTickerEngine::TickAbsolute( double EndTime)
 		if ( (SleepTime > MIN_GRANULARITY * 1.01) && (SleepTime > SleepResolution) ) //Prevent over-sleep
 		{
 //			uint32 Cycles = FPlatformTime::Cycles();
-			NativeSleep( SleepTime);
+			IdleSleep( SleepTime);
 //			Cycles = FPlatformTime::Cycles() - Cycles;
 //			double RealSleep = FPlatformTime::ToSeconds(Cycles);
 //			if ( RealSleep > SleepTime * 3 )
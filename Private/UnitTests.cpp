@@ -9,6 +9,20 @@
 void TestCallbacks(){}
 void TestCharBuffer(){}
 void TestTimer(){}
+void TestJSONScanner(){}
+void TestJSONSpans(){}
+void TestJSONReader(){}
+void TestJSONWriter(){}
+void TestBinaryFormat(){}
+void TestObjectCopy(){}
+void TestObjectDelta(){}
+void TestPropertyTable(){}
+void TestNumberConversion(){}
+void TestMappedFile(){}
+void TestLineParser(){}
+void TestXMLReader(){}
+void TestXMLParser(){}
+void TestSocketPoller(){}
 
 #else
 
@@ -16,8 +30,27 @@ void TestTimer(){}
 #include "DebugCallback.h"
 #include "TCharBuffer.h"
 #include "CTickerEngine.h"
+#include "CacusThread.h"
+#include "NetworkSocket.h"
+#include "AppTime.h"
+#include "Utils.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#ifndef _WINDOWS
+	#include <unistd.h>
+	#include <sys/select.h>
+#endif
+
+#include "CacusField.h"
+#include "Internal/CParser.h"
+#include "Parser/Binary.h"
+#include "Parser/JSONReader.h"
+#include "Parser/JSONWriter.h"
+#include "Parser/Line.h"
+#include "Parser/XML.h"
 
 
 //======================================================================
@@ -82,6 +115,16 @@ template<int N> void OrderedCallback( const char* Message, int MessageFlags)
 static char ThrowBuf[256] = {};
 #define checktest(statement,...) if ( !(statement) ) { sprintf(ThrowBuf,##__VA_ARGS__); throw (const char*)ThrowBuf; }
 
+// Throughput is only measured and reported with CACUS_USE_BENCHMARKS,
+// regular runs check results on small inputs.
+#ifdef CACUS_USE_BENCHMARKS
+	#define benchsize(benchmark,test) (benchmark)
+	#define BENCH_RUNS 5
+#else
+	#define benchsize(benchmark,test) (test)
+	#define BENCH_RUNS 1
+#endif
+
 
 //============================= TestCallbacks
 //
@@ -161,6 +204,18 @@ void TestCharBuffer()
 	const char* TestC = CSprintf( "%s%s", TEST_ASSIGNMENT, TEST_ASSIGNMENT);
 	checktest( AnsiBuffer == TestC, "Bad CSprintf result [%s != %s]", TestC, *AnsiBuffer);
 	checktest( !CStrncmp( TestC, TEST_ASSIGNMENT), "CStrncmp <array template> error" );
+
+	Stage = "Case conversion";
+	static const char Mixed[] = "aZ09_-@[`{";
+	static const char Upper[] = "AZ09_-@[`{";
+	static const char Lower[] = "az09_-@[`{";
+	for ( size_t i=0 ; i<_len(Mixed) ; i++ )
+	{
+		checktest( CChrToUpper(Mixed[i]) == Upper[i], "CChrToUpper('%c') returned '%c'", Mixed[i], CChrToUpper(Mixed[i]));
+		checktest( CChrToLower(Mixed[i]) == Lower[i], "CChrToLower('%c') returned '%c'", Mixed[i], CChrToLower(Mixed[i]));
+	}
+	checktest( CChrToUpper((char16)'q') == (char16)'Q' && CChrToLower((char32)'Q') == (char32)'q', "Wide case conversion");
+	checktest( !CStricmp( Upper, Lower) && CStricmp( Upper, "AZ09_-@[`z") && !CStrnicmp( "Location: x", "LOCATION: y", 10), "Case insensitive compare");
 	unguardtest
 }
 
@@ -193,4 +248,1417 @@ void TestTimer()
 	unguardtest
 }
 
-#endif
\ No newline at end of file
+
+//============================= TestJSONScanner
+// Compares structural index parsing against per-character parsing,
+// benchmarks report throughput of both on a multi-megabyte document.
+//
+#if USES_CACUS_FIELD
+static void JSONBenchDocument( std::string& Doc, size_t MinSize)
+{
+	Doc = "[\n";
+	for ( uint32 i=0 ; Doc.length()<MinSize ; i++ )
+	{
+		if ( i )
+			Doc += ",\n";
+		Doc += CSprintf( "  {\n    \"id\": %u,\n    \"name\": \"Player %u\",\n    \"score\": %i.%02u,\n", i, i, (int)(i*7919%5000)-2500, i%100);
+		Doc += "    \"tags\": [ \"alpha\", \"beta\", \"gamma\" ],\n    \"active\": true,\n    \"clan\": null,\n";
+		Doc += "    \"note\": \"Escaped \\\"quote\\\" and \\\\ backslash with a \\u00e9 somewhere in a longer line of text\",\n";
+		Doc += CSprintf( "    \"pos\": { \"x\": %u, \"y\": %u, \"z\": -%u }\n  }", i%1024, (i*3)%1024, (i*5)%1024);
+	}
+	Doc += "\n]\n";
+}
+
+static double JSONBenchParse( const std::string& Doc, bool UseIndex, uint32 Runs, std::string& Result)
+{
+	CJSONParser::UseStructuralIndex = UseIndex;
+	double Best = 0;
+	for ( uint32 i=0 ; i<Runs ; i++ )
+	{
+		double StartTime = FPlatformTime::Seconds();
+		CJSONParser Parser( Doc.c_str());
+		bool bParsed = Parser.Parse();
+		double Time = FPlatformTime::Seconds() - StartTime;
+		if ( !bParsed )
+			throw "Parse failed";
+		if ( !i || (Time < Best) )
+			Best = Time;
+		if ( i+1 == Runs )
+			Parser.RootElement.Export_JSONString( Result);
+	}
+	CJSONParser::UseStructuralIndex = true;
+	return Best;
+}
+#endif
+
+void TestJSONScanner()
+{
+	guardtest("JSON Scanner");
+#if USES_CACUS_FIELD
+	std::string Doc, Scalar, Indexed;
+	Stage = "Document";
+	JSONBenchDocument( Doc, benchsize(8 * 1024 * 1024, 128 * 1024));
+
+	Stage = "Per-character";
+	double ScalarTime = JSONBenchParse( Doc, false, BENCH_RUNS, Scalar);
+	Stage = "Structural index";
+	double IndexedTime = JSONBenchParse( Doc, true, BENCH_RUNS, Indexed);
+	checktest( Scalar == Indexed, "Element trees differ [%i/%i bytes]", (int)Scalar.length(), (int)Indexed.length());
+
+#ifdef CACUS_USE_BENCHMARKS
+	double MB = (double)Doc.length() / (1024.0 * 1024.0);
+	printf( " %.1fMB: %.1fMB/s per-character, %.1fMB/s indexed... ", MB, MB / ScalarTime, MB / IndexedTime);
+#endif
+#endif
+	unguardtest
+}
+
+
+//============================= TestJSONSpans
+// Imports an element tree parsed in span and in-situ mode into a struct
+// whose primitive values are batched while long strings are imported
+// through the circular buffer.
+//
+#if USES_CACUS_FIELD
+struct FSpanInner
+{
+	CSTRUCT_DECLARE_BASE_CLASS(FSpanInner)
+	int32 Level;
+	std::string Text;
+	std::string Path;
+};
+void FSpanInner::CStructInit( CStruct* st_Struct)
+{
+	CREATE_PROPERTY(Level)
+	CREATE_PROPERTY(Text)
+	CREATE_PROPERTY(Path)
+}
+CSTRUCT_IMPLEMENT_BASE_CLASS(FSpanInner)
+
+struct FSpanOuter
+{
+	CSTRUCT_DECLARE_BASE_CLASS(FSpanOuter)
+	int32 Id;
+	uint32 Flags;
+	float Score;
+	bool bActive;
+	std::string Name;
+	FSpanInner Inner;
+	std::vector<std::string> Lines;
+};
+void FSpanOuter::CStructInit( CStruct* st_Struct)
+{
+	CREATE_PROPERTY(Id)
+	CREATE_PROPERTY(Flags)
+	CREATE_PROPERTY(Score)
+	CREATE_PROPERTY(bActive)
+	CREATE_PROPERTY(Name)
+	CREATE_PROPERTY(Inner)
+	CREATE_PROPERTY(Lines)
+}
+CSTRUCT_IMPLEMENT_BASE_CLASS(FSpanOuter)
+
+static void CheckSpanImport( const FSpanOuter& Obj, const std::string& Line)
+{
+	checktest( Obj.Id == -1234, "Id imported as %i", Obj.Id);
+	checktest( Obj.Flags == 4000000000u, "Flags imported as %u", Obj.Flags);
+	checktest( Obj.Score == 2.5f, "Score imported as %f", Obj.Score);
+	checktest( Obj.bActive, "bActive imported as false");
+	checktest( Obj.Name == "Plain name without any escape sequences", "Name imported as %s", Obj.Name.c_str());
+	checktest( Obj.Inner.Level == 77, "Inner.Level imported as %i", Obj.Inner.Level);
+	checktest( Obj.Inner.Text == "First line\nSecond \"quoted\" line\tand a tab, followed by enough text to pass 64 bytes \xC3\xA9", "Inner.Text imported as %s", Obj.Inner.Text.c_str());
+	checktest( Obj.Inner.Path == "C:\\Games\\UnrealTournament\\System\\Cacus\\Logs\\Server\\Session\\Output.log", "Inner.Path imported as %s", Obj.Inner.Path.c_str());
+	checktest( Obj.Lines.size() == 512, "Imported %i lines", (int)Obj.Lines.size());
+	for ( size_t i=0 ; i<Obj.Lines.size() ; i++ )
+		checktest( Obj.Lines[i] == Line, "Line %i differs", (int)i);
+}
+#endif
+
+void TestJSONSpans()
+{
+	guardtest("JSON Spans");
+#if USES_CACUS_FIELD
+	Stage = "Document";
+	// Object keys are linked in reverse, so Lines are imported after the
+	// primitive values are read and wrap the string buffer before the
+	// batch is imported
+	std::string Line( 128, 'x');
+	std::string Doc = "{ \"Lines\": [ ";
+	for ( uint32 i=0 ; i<512 ; i++ )
+		Doc += (i ? ", \"" : "\"") + Line + "\"";
+	Doc += " ],"
+		" \"Inner\": { \"Level\": 77,"
+		" \"Text\": \"First line\\nSecond \\\"quoted\\\" line\\tand a tab, followed by enough text to pass 64 bytes \\u00e9\","
+		" \"Path\": \"C:\\\\Games\\\\UnrealTournament\\\\System\\\\Cacus\\\\Logs\\\\Server\\\\Session\\\\Output.log\" },"
+		" \"Name\": \"Plain name without any escape sequences\","
+		" \"Id\": -1234, \"Flags\": 4000000000, \"Score\": 2.5, \"bActive\": true }";
+	CProperty* Outer = CreateProperty( "", nullptr, *(FSpanOuter*)CSTRUCT_BASE, PF_Inner);
+
+	Stage = "Span";
+	{
+		FSpanOuter Obj;
+		CJSONParser Parser( Doc.c_str());
+		checktest( Parser.Parse(), "Failed to parse document");
+		Outer->Import( &Obj, Parser.RootElement);
+		CheckSpanImport( Obj, Line);
+	}
+
+	Stage = "In-situ";
+	{
+		FSpanOuter Obj;
+		std::string Buffer = Doc;
+		CJSONParser Parser( &Buffer[0], true);
+		checktest( Parser.Parse(), "Failed to parse document");
+		Outer->Import( &Obj, Parser.RootElement);
+		CheckSpanImport( Obj, Line);
+	}
+
+	Stage = "Views";
+	{
+		char* Block = new char[3]; //Nothing readable past the view
+		CMemcpy( Block, "123", 3);
+		CMemExStack Mem( 1024);
+		CParserElement Root( PEF_Root, Mem);
+		CParserElement* Element = Root.AddChild();
+		Element->SetValueView( Block, 3);
+		checktest( !CStrcmp( Element->GetValue(), "123") && !CStrcmp( Element->GetArenaValue(), "123") && (Element->GetArenaValue() != Block), "View read as %s", Element->GetValue());
+		Element->SetValue( Block, 2);
+		checktest( !(Element->Flags & PEF_ValueView) && !CStrcmp( Element->GetValue(), "12"), "Copied value read as %s", Element->GetValue());
+		delete[] Block;
+	}
+
+	Stage = "Unknown keys";
+	int32 NameCount = CName::Count();
+	CJSONParser Parser( "{ \"json_unlisted_key\": 5, \"Id\": 1 }");
+	checktest( Parser.Parse() && (CName::Count() == NameCount), "Parse added %i names", CName::Count() - NameCount);
+	CParserElement* Unlisted = Parser.RootElement.GetChild( "JSON_Unlisted_Key");
+	checktest( Unlisted && !Parser.RootElement.GetChild( "Id")->KeyText && !CStrcmp( Unlisted->GetValue(), "5"), "Unknown key not found by text");
+	std::string Exported;
+	Parser.RootElement.Export_JSONString( Exported);
+	checktest( Exported.find( "\"json_unlisted_key\":5") != std::string::npos, "Unknown key not exported: %s", Exported.c_str());
+	delete Outer;
+#endif
+	unguardtest
+}
+
+
+//============================= TestJSONReader
+// Feeds a document to the streaming reader split at every offset, then
+// malformed documents that must fail without leaving arrays unfinished.
+//
+#if USES_CACUS_FIELD
+struct FReaderShape
+{
+	CSTRUCT_DECLARE_BASE_CLASS(FReaderShape)
+	CSTRUCT_VIRTUAL_CLASS
+	int32 Sides;
+
+	FReaderShape() : Sides(0) {}
+	virtual ~FReaderShape() {}
+};
+void FReaderShape::CStructInit( CStruct* st_Struct)
+{
+	CREATE_PROPERTY(Sides)
+	CREATE_CLASS_MARKER()
+}
+CSTRUCT_IMPLEMENT_BASE_CLASS(FReaderShape)
+
+struct FReaderCircle : public FReaderShape
+{
+	CSTRUCT_DECLARE_CLASS(FReaderCircle,FReaderShape)
+	CSTRUCT_VIRTUAL_CLASS
+	float Radius;
+
+	FReaderCircle() : Radius(0) {}
+};
+void FReaderCircle::CStructInit( CStruct* st_Struct)
+{
+	CREATE_PROPERTY(Radius)
+}
+CSTRUCT_IMPLEMENT_CLASS(FReaderCircle,FReaderShape)
+
+struct FReaderDoc
+{
+	CSTRUCT_DECLARE_BASE_CLASS(FReaderDoc)
+	int32 Id;
+	float Score;
+	std::string Name;
+	std::vector<int32> Values;
+	std::vector<std::string> Words;
+	TFixedArray<int32> Fixed;
+	FReaderShape* Shape;
+
+	FReaderDoc() : Id(0), Score(0), Name("Before"), Shape(nullptr) {}
+	~FReaderDoc() { delete Shape; }
+};
+void FReaderDoc::CStructInit( CStruct* st_Struct)
+{
+	CREATE_PROPERTY(Id)
+	CREATE_PROPERTY(Score)
+	CREATE_PROPERTY(Name)
+	CREATE_PROPERTY(Values)
+	CREATE_PROPERTY(Words)
+	CREATE_PROPERTY(Fixed)
+	CREATE_PROPERTY(Shape)
+}
+CSTRUCT_IMPLEMENT_BASE_CLASS(FReaderDoc)
+
+static bool ReaderImport( FReaderDoc& Doc, CProperty* Outer, const std::string& Text, size_t Split, size_t Step)
+{
+	CJSONReader Reader( &Doc, Outer);
+	bool bFed = Reader.Feed( Text.data(), Split);
+	for ( size_t Offset=Split ; bFed && (Offset<Text.length()) ; Offset+=Step )
+		bFed = Reader.Feed( Text.data() + Offset, Min( Step, Text.length() - Offset));
+	return bFed && Reader.Finish() && !Reader.HasError();
+}
+
+static void CheckReaderImport( FReaderDoc& Doc, size_t Split)
+{
+	checktest( Doc.Id == -77, "Id imported as %i (split %i)", Doc.Id, (int)Split);
+	checktest( Doc.Score == -12.375f, "Score imported as %f (split %i)", Doc.Score, (int)Split);
+	checktest( Doc.Name == "Esc \"quoted\" \\ \xC3\xA9\xF0\x9F\x98\x80 end", "Name imported as %s (split %i)", Doc.Name.c_str(), (int)Split);
+	checktest( Doc.Values.size() == 100, "Imported %i values (split %i)", (int)Doc.Values.size(), (int)Split);
+	for ( size_t i=0 ; i<Doc.Values.size() ; i++ )
+		checktest( Doc.Values[i] == (int32)(i * 7919) - 300000, "Value %i imported as %i (split %i)", (int)i, Doc.Values[i], (int)Split);
+	checktest( Doc.Words.size() == 3 && Doc.Words[0] == "a" && Doc.Words[1] == "b\nc" && Doc.Words[2].empty(), "Words imported wrong (split %i)", (int)Split);
+	checktest( Doc.Fixed.Size() == 5 && Doc.Fixed[0] == 1 && Doc.Fixed[4] == 5, "Fixed array imported with %i elements (split %i)", (int)Doc.Fixed.Size(), (int)Split);
+	checktest( Doc.Shape && Doc.Shape->VirtualCStruct() == FReaderCircle::GetInstanceCStruct(), "Shape not created as FReaderCircle (split %i)", (int)Split);
+	checktest( Doc.Shape->Sides == 1 && ((FReaderCircle*)Doc.Shape)->Radius == 0.125f, "Shape properties not imported (split %i)", (int)Split);
+}
+#endif
+
+void TestJSONReader()
+{
+	guardtest("JSON Reader");
+#if USES_CACUS_FIELD
+	Stage = "Document";
+	FReaderCircle::GetInstanceCStruct(); //Register for 'Class' lookups
+	CProperty* Outer = CreateProperty( "", nullptr, *(FReaderDoc*)CSTRUCT_BASE, PF_Inner);
+	std::string Text = "{ \"Id\": -77, \"Name\": \"Esc \\\"quoted\\\" \\\\ \\u00e9\\ud83d\\ude00 end\", \"Score\": -12.375,\n";
+	Text += "  \"Shape\": { \"Class\": \"FReaderCircle\", \"Sides\": 1, \"Radius\": 0.125 },\n  \"Values\": [";
+	for ( uint32 i=0 ; i<100 ; i++ )
+		Text += CSprintf( "%s%i", i ? ", " : " ", (int32)(i * 7919) - 300000);
+	Text += " ],\n  \"Skipped\": { \"Nested\": [ 1, { \"Key\": \"\\\"}]\" } ] },\n";
+	Text += "  \"Words\": [ \"a\", \"b\\nc\", \"\" ], \"Fixed\": [1,2,3,4,5] }";
+
+	Stage = "Split";
+	CDbg_UnregisterCallback( &MainCallback); //Skipped key is reported
+	for ( size_t Split=0 ; Split<=Text.length() ; Split++ )
+	{
+		FReaderDoc Doc;
+		checktest( ReaderImport( Doc, Outer, Text, Split, Text.length()), "Import failed (split %i)", (int)Split);
+		CheckReaderImport( Doc, Split);
+	}
+
+	Stage = "Bytes";
+	{
+		FReaderDoc Doc;
+		checktest( ReaderImport( Doc, Outer, Text, 0, 1), "Import failed");
+		CheckReaderImport( Doc, 0);
+	}
+
+	Stage = "Class order";
+	{
+		FReaderDoc Doc;
+		static const char* Late = "{ \"Shape\": { \"Sides\": 4, \"Class\": \"FReaderCircle\" } }";
+		checktest( ReaderImport( Doc, Outer, Late, CStrlen(Late), 1), "Import failed");
+		checktest( Doc.Shape && Doc.Shape->VirtualCStruct() == FReaderShape::GetInstanceCStruct() && Doc.Shape->Sides == 4, "Late 'Class' key not ignored");
+	}
+
+	Stage = "Malformed";
+	static const char* Malformed[] =
+	{
+		"{ \"Id\": 5, \"Values\": [ 1, 2, } ",
+		"{ \"Id\": 5, \"Fixed\": [ 1, 2, 3 : 4 ] }",
+		"{ \"Id\": 5, \"Fixed\": [ 1, 2, 3",
+		"{ \"Id\": 5, \"Name\": \"Bad \\q escape\" }",
+		"{ \"Id\": 5 \"Name\": \"Missing comma\" }",
+		"{ \"Id\": 5, \"Name\": \"Unterminated",
+		"{ \"Id\": 5, \"Words\": [ \"x\" ] } }",
+	};
+	for ( size_t i=0 ; i<ARRAY_COUNT(Malformed) ; i++ )
+	{
+		FReaderDoc Doc;
+		CJSONReader Reader( &Doc, Outer);
+		bool bFed = Reader.Feed( Malformed[i], CStrlen(Malformed[i]));
+		checktest( !(bFed && Reader.Finish()) && Reader.HasError() && !Reader.Feed( "{}", 2), "Document %i accepted", (int)i);
+		checktest( Doc.Id == 5 && Doc.Name == "Before", "Document %i imported as Id=%i Name=%s", (int)i, Doc.Id, Doc.Name.c_str());
+		checktest( Doc.Values.size() <= 2 && Doc.Words.size() <= 1, "Document %i left %i values", (int)i, (int)Doc.Values.size());
+		checktest( Doc.Fixed.Size() == ((i == 1 || i == 2) ? 3 : 0), "Document %i left %i fixed elements", (int)i, (int)Doc.Fixed.Size());
+		for ( size_t j=0 ; j<Doc.Fixed.Size() ; j++ )
+			checktest( Doc.Fixed[j] == (int32)j + 1, "Document %i fixed element %i is %i", (int)i, (int)j, Doc.Fixed[j]);
+		std::string Exported = ObjectToData( Doc, PARSE_JSON);
+		checktest( Exported.find( "\"Id\":5") != std::string::npos, "Document %i exported as %s", (int)i, Exported.c_str());
+	}
+	CDbg_RegisterCallback( &MainCallback, CACUS_CALLBACK_ALL);
+	delete Outer;
+#endif
+	unguardtest
+}
+
+
+//============================= TestJSONWriter
+// Compares direct property writing against exporting through an
+// element tree on an array of records, benchmarks report throughput
+// of both.
+//
+#if USES_CACUS_FIELD
+struct FBenchPos
+{
+	CSTRUCT_DECLARE_BASE_CLASS(FBenchPos)
+	CSTRUCT_NODELTA_COMPARE
+	int32 X, Y, Z;
+};
+void FBenchPos::CStructInit( CStruct* st_Struct)
+{
+	CREATE_PROPERTY(X)
+	CREATE_PROPERTY(Y)
+	CREATE_PROPERTY(Z)
+}
+CSTRUCT_IMPLEMENT_BASE_CLASS(FBenchPos)
+
+struct FBenchRecord
+{
+	CSTRUCT_DECLARE_BASE_CLASS(FBenchRecord)
+	CSTRUCT_NODELTA_COMPARE
+	uint32 Id;
+	std::string Name;
+	float Score;
+	bool bActive;
+	std::string Note;
+	std::vector<int32> Tags;
+	FBenchPos Pos;
+};
+void FBenchRecord::CStructInit( CStruct* st_Struct)
+{
+	CREATE_PROPERTY(Id)
+	CREATE_PROPERTY(Name)
+	CREATE_PROPERTY(Score)
+	CREATE_PROPERTY(bActive)
+	CREATE_PROPERTY(Note)
+	CREATE_PROPERTY(Tags)
+	CREATE_PROPERTY(Pos)
+}
+CSTRUCT_IMPLEMENT_BASE_CLASS(FBenchRecord)
+
+struct FBenchDocument
+{
+	CSTRUCT_DECLARE_BASE_CLASS(FBenchDocument)
+	std::vector<FBenchRecord> Records;
+};
+void FBenchDocument::CStructInit( CStruct* st_Struct)
+{
+	CREATE_PROPERTY(Records)
+}
+CSTRUCT_IMPLEMENT_BASE_CLASS(FBenchDocument)
+
+// Regular runs write a few full batches of 64 array elements converted
+// by ExportPrimitives, plus a partial one.
+#define BENCH_RECORDS benchsize(50000, 64 * 4 + 13)
+
+static void BenchDocument( FBenchDocument& Document, uint32 Count)
+{
+	Document.Records.resize( Count);
+	for ( uint32 i=0 ; i<Count ; i++ )
+	{
+		FBenchRecord& Record = Document.Records[i];
+		Record.Id      = i;
+		Record.Name    = CSprintf( "Player %u", i);
+		Record.Score   = (float)((int)(i*7919%5000)-2500) * 0.25f;
+		Record.bActive = (i & 1) != 0;
+		Record.Note    = "Escaped \"quote\" and \\ backslash somewhere in a longer line of text";
+		Record.Tags.push_back( i % 7);
+		Record.Tags.push_back( i % 13);
+		Record.Pos.X   = i % 1024;
+		Record.Pos.Y   = (i*3) % 1024;
+		Record.Pos.Z   = -(int32)((i*5) % 1024);
+	}
+}
+#endif
+
+void TestJSONWriter()
+{
+	guardtest("JSON Writer");
+#if USES_CACUS_FIELD
+	Stage = "Document";
+	FBenchDocument Document;
+	BenchDocument( Document, BENCH_RECORDS);
+	CProperty* Outer = CreateProperty( "", nullptr, *(FBenchDocument*)CSTRUCT_BASE, PF_Inner);
+
+	std::string Tree, Direct;
+	double TreeTime = 0, DirectTime = 0;
+	for ( uint32 i=0 ; i<BENCH_RUNS ; i++ )
+	{
+		Stage = "Element tree";
+		double StartTime = FPlatformTime::Seconds();
+		{
+			CMemExStack Mem( 256 * 1024);
+			CParserElement RootElement( PEF_Root, Mem);
+			Outer->Export( &Document, RootElement);
+			Tree.clear();
+			RootElement.Export_JSONString( Tree);
+		}
+		double Time = FPlatformTime::Seconds() - StartTime;
+		if ( !i || (Time < TreeTime) )
+			TreeTime = Time;
+
+		Stage = "Direct";
+		StartTime = FPlatformTime::Seconds();
+		Direct.clear();
+		CJSONWriter Writer( Direct);
+		Writer.WriteValue( Outer, &Document);
+		Time = FPlatformTime::Seconds() - StartTime;
+		if ( !i || (Time < DirectTime) )
+			DirectTime = Time;
+	}
+	checktest( Tree == Direct, "Outputs differ [%i/%i bytes]", (int)Tree.length(), (int)Direct.length());
+
+	Stage = "Roundtrip";
+	FBenchDocument Imported;
+	std::string Reexported;
+	checktest( DataToObject( Direct.c_str(), &Imported, Outer, PARSE_JSON), "Failed to import written document");
+	ObjectToData( Reexported, &Imported, Outer, PARSE_JSON);
+	checktest( Direct == Reexported, "Roundtrip differs [%i/%i bytes]", (int)Direct.length(), (int)Reexported.length());
+	delete Outer;
+
+#ifdef CACUS_USE_BENCHMARKS
+	double MB = (double)Direct.length() / (1024.0 * 1024.0);
+	printf( " %.1fMB: %.1fMB/s element tree, %.1fMB/s direct... ", MB, MB / TreeTime, MB / DirectTime);
+#endif
+#endif
+	unguardtest
+}
+
+
+//============================= TestBinaryFormat
+// Compares binary and JSON serialization of the TestJSONWriter
+// records, benchmarks report size and throughput of both directions.
+//
+void TestBinaryFormat()
+{
+	guardtest("Binary Format");
+#if USES_CACUS_FIELD
+	Stage = "Document";
+	FBenchDocument Document;
+	BenchDocument( Document, BENCH_RECORDS);
+	CProperty* Outer = CreateProperty( "", nullptr, *(FBenchDocument*)CSTRUCT_BASE, PF_Inner);
+
+	std::string Data[2];
+	double WriteTime[2] = {0,0};
+	double ReadTime[2] = {0,0};
+	const EParseType Formats[2] = { PARSE_JSON, PARSE_Binary };
+	for ( uint32 i=0 ; i<BENCH_RUNS ; i++ )
+		for ( uint32 f=0 ; f<2 ; f++ )
+		{
+			Stage = (Formats[f] == PARSE_JSON) ? "JSON" : "Binary";
+			double StartTime = FPlatformTime::Seconds();
+			ObjectToData( Data[f], &Document, Outer, Formats[f]);
+			double Time = FPlatformTime::Seconds() - StartTime;
+			if ( !i || (Time < WriteTime[f]) )
+				WriteTime[f] = Time;
+
+			FBenchDocument Imported;
+			StartTime = FPlatformTime::Seconds();
+			bool bImported = DataViewToObject( Data[f].data(), Data[f].length(), &Imported, Outer, Formats[f]);
+			Time = FPlatformTime::Seconds() - StartTime;
+			checktest( bImported, "Failed to import %s document", Stage);
+			if ( !i || (Time < ReadTime[f]) )
+				ReadTime[f] = Time;
+
+			if ( !i && (Formats[f] == PARSE_Binary) )
+			{
+				std::string Reexported;
+				ObjectToData( Reexported, &Imported, Outer, PARSE_JSON);
+				checktest( Reexported == Data[0], "Binary roundtrip differs [%i/%i bytes]", (int)Reexported.length(), (int)Data[0].length());
+			}
+		}
+
+	Stage = "Schema";
+	FBenchRecord Record;
+	CProperty* RecordOuter = CreateProperty( "", nullptr, *(FBenchRecord*)CSTRUCT_BASE, PF_Inner);
+	CDbg_UnregisterCallback( &MainCallback);
+	bool bMismatch = DataViewToObject( Data[1].data(), Data[1].length(), &Record, RecordOuter, PARSE_Binary);
+	CDbg_RegisterCallback( &MainCallback, CACUS_CALLBACK_ALL);
+	checktest( !bMismatch, "Binary data imported with a different schema");
+	delete RecordOuter;
+
+	Stage = "Truncated";
+	const std::string& Binary = Data[1];
+	checktest( CBinaryReader::PeekSize( Binary.data(), Binary.length()) == Binary.length(), "PeekSize returned %i", (int)CBinaryReader::PeekSize( Binary.data(), Binary.length()));
+	checktest( !CBinaryReader::PeekSize( Binary.data(), CBinaryWriter::HEADER_SIZE - 1) && !CBinaryReader::PeekSize( "CBI", 3), "PeekSize read past a short buffer");
+	size_t CutSizes[] = { 0, 4, CBinaryWriter::HEADER_SIZE - 1, CBinaryWriter::HEADER_SIZE, CBinaryWriter::HEADER_SIZE + 1, Binary.length() / 2, Binary.length() - 1 };
+	CDbg_UnregisterCallback( &MainCallback);
+	for ( size_t i=0 ; i<ARRAY_COUNT(CutSizes) ; i++ )
+	{
+		std::vector<char> Cut( Binary.begin(), Binary.begin() + CutSizes[i]); //Exact size for ASAN
+		FBenchDocument Imported;
+		checktest( !DataViewToObject( Cut.data(), Cut.size(), &Imported, Outer, PARSE_Binary), "Imported data cut to %i bytes", (int)CutSizes[i]);
+	}
+	FBenchDocument Unsized;
+	bool bUnsized = DataToObject( Binary.data(), &Unsized, Outer, PARSE_Binary);
+	CDbg_RegisterCallback( &MainCallback, CACUS_CALLBACK_ALL);
+	checktest( !bUnsized, "Binary data imported without a length");
+	delete Outer;
+
+#ifdef CACUS_USE_BENCHMARKS
+	double MB = (double)Data[0].length() / (1024.0 * 1024.0);
+	printf( " %.1fMB JSON, %.1fMB binary: write %.1f/%.1fms, read %.1f/%.1fms... ", MB, (double)Data[1].length() / (1024.0 * 1024.0)
+		, WriteTime[0] * 1000.0, WriteTime[1] * 1000.0, ReadTime[0] * 1000.0, ReadTime[1] * 1000.0);
+#endif
+#endif
+	unguardtest
+}
+
+
+//============================= TestObjectCopy
+// Compares ObjectToObject copy plans against copying through an
+// element tree on the TestJSONWriter records.
+//
+void TestObjectCopy()
+{
+	guardtest("Object Copy");
+#if USES_CACUS_FIELD
+	Stage = "Document";
+	FBenchDocument Document;
+	BenchDocument( Document, BENCH_RECORDS);
+	CProperty* Outer = CreateProperty( "", nullptr, *(FBenchDocument*)CSTRUCT_BASE, PF_Inner);
+
+	double TreeTime = 0, PlanTime = 0;
+	for ( uint32 i=0 ; i<BENCH_RUNS ; i++ )
+	{
+		Stage = "Element tree";
+		FBenchDocument TreeCopy;
+		double StartTime = FPlatformTime::Seconds();
+		{
+			CMemExStack Mem( 256 * 1024);
+			CParserElement RootElement( PEF_Root, Mem);
+			Outer->Export( &Document, RootElement);
+			Outer->Import( &TreeCopy, RootElement);
+		}
+		double Time = FPlatformTime::Seconds() - StartTime;
+		if ( !i || (Time < TreeTime) )
+			TreeTime = Time;
+
+		Stage = "Copy plan";
+		FBenchDocument PlanCopy;
+		StartTime = FPlatformTime::Seconds();
+		ObjectToObject( &Document, &PlanCopy, Outer, Outer);
+		Time = FPlatformTime::Seconds() - StartTime;
+		if ( !i || (Time < PlanTime) )
+			PlanTime = Time;
+
+		if ( !i )
+		{
+			std::string Original, TreeData, PlanData;
+			ObjectToData( Original, &Document, Outer, PARSE_JSON);
+			ObjectToData( TreeData, &TreeCopy, Outer, PARSE_JSON);
+			ObjectToData( PlanData, &PlanCopy, Outer, PARSE_JSON);
+			checktest( PlanData == Original, "Copy differs from original [%i/%i bytes]", (int)PlanData.length(), (int)Original.length());
+			checktest( PlanData == TreeData, "Copy differs from element tree copy [%i/%i bytes]", (int)PlanData.length(), (int)TreeData.length());
+		}
+	}
+	delete Outer;
+
+#ifdef CACUS_USE_BENCHMARKS
+	printf( " %i records: %.1fms element tree, %.1fms copy plan... ", (int)Document.Records.size(), TreeTime * 1000.0, PlanTime * 1000.0);
+#endif
+#endif
+	unguardtest
+}
+
+
+//============================= TestObjectDelta
+// Changes one in a hundred TestJSONWriter records, checks that applying
+// the delta to a copy of the original reproduces the changed document.
+//
+void TestObjectDelta()
+{
+	guardtest("Object Delta");
+#if USES_CACUS_FIELD
+	Stage = "Document";
+	FBenchDocument Original, Changed, Replica;
+	BenchDocument( Original, BENCH_RECORDS);
+	CProperty* Outer = CreateProperty( "", nullptr, *(FBenchDocument*)CSTRUCT_BASE, PF_Inner);
+	ObjectToObject( &Original, &Changed, Outer, Outer);
+	ObjectToObject( &Original, &Replica, Outer, Outer);
+	for ( size_t i=0 ; i<Changed.Records.size() ; i+=100 )
+	{
+		FBenchRecord& Record = Changed.Records[i];
+		Record.Score += 1.0f;
+		Record.Pos.Y++;
+		if ( i % 300 == 0 )
+			Record.Tags.push_back( 1);
+	}
+
+	Stage = "Unchanged";
+	std::string Delta;
+	ObjectToDelta( Delta, &Original, &Replica, Outer);
+	checktest( Delta.length() == CBinaryWriter::HEADER_SIZE, "Delta of identical objects isn't empty [%i bytes]", (int)Delta.length());
+
+	Stage = "Delta";
+	double DeltaTime = 0;
+	for ( uint32 i=0 ; i<BENCH_RUNS ; i++ )
+	{
+		double StartTime = FPlatformTime::Seconds();
+		ObjectToDelta( Delta, &Original, &Changed, Outer);
+		double Time = FPlatformTime::Seconds() - StartTime;
+		if ( !i || (Time < DeltaTime) )
+			DeltaTime = Time;
+	}
+
+	Stage = "Apply";
+	double StartTime = FPlatformTime::Seconds();
+	checktest( DeltaToObject( Delta.data(), Delta.length(), &Replica, Outer), "Failed to apply delta");
+	double ApplyTime = FPlatformTime::Seconds() - StartTime;
+	std::string Expected, Result, Full;
+	ObjectToData( Expected, &Changed, Outer, PARSE_JSON);
+	ObjectToData( Result, &Replica, Outer, PARSE_JSON);
+	checktest( Result == Expected, "Applied delta differs from changed document [%i/%i bytes]", (int)Result.length(), (int)Expected.length());
+
+	Stage = "Schema";
+	CProperty* RecordOuter = CreateProperty( "", nullptr, *(FBenchRecord*)CSTRUCT_BASE, PF_Inner);
+	CDbg_UnregisterCallback( &MainCallback);
+	bool bMismatch = DeltaToObject( Delta.data(), Delta.length(), &Replica.Records[0], RecordOuter);
+	CDbg_RegisterCallback( &MainCallback, CACUS_CALLBACK_ALL);
+	checktest( !bMismatch, "Delta applied to a different type");
+	delete RecordOuter;
+
+	Stage = "Truncated";
+	ObjectToData( Expected, &Replica, Outer, PARSE_JSON);
+	size_t CutSizes[] = { 0, 4, CBinaryWriter::HEADER_SIZE - 1, CBinaryWriter::HEADER_SIZE, Delta.length() / 2, Delta.length() - 1 };
+	CDbg_UnregisterCallback( &MainCallback);
+	for ( size_t i=0 ; i<ARRAY_COUNT(CutSizes) ; i++ )
+	{
+		std::vector<char> Cut( Delta.begin(), Delta.begin() + CutSizes[i]); //Exact size for ASAN
+		checktest( !DeltaToObject( Cut.data(), Cut.size(), &Replica, Outer), "Applied a delta truncated to %i bytes", (int)CutSizes[i]);
+	}
+	bool bOversized = false;
+	uint32 PayloadSizes[] = { (uint32)(Delta.length() - CBinaryWriter::HEADER_SIZE + 1), 0x7FFFFFFF };
+	for ( size_t i=0 ; i<ARRAY_COUNT(PayloadSizes) ; i++ )
+	{
+		std::string Broken = Delta;
+		for ( uint32 j=0 ; j<4 ; j++ ) //Header size field is little endian
+			Broken[8+j] = (char)(uint8)(PayloadSizes[i] >> (j*8));
+		bOversized |= DeltaToObject( Broken.data(), Broken.length(), &Replica, Outer);
+	}
+	CDbg_RegisterCallback( &MainCallback, CACUS_CALLBACK_ALL);
+	checktest( !bOversized, "Applied a delta whose header exceeds its length");
+	ObjectToData( Result, &Replica, Outer, PARSE_JSON);
+	checktest( Result == Expected, "Rejected delta modified the object");
+
+	ObjectToData( Full, &Changed, Outer, PARSE_Binary);
+	delete Outer;
+
+#ifdef CACUS_USE_BENCHMARKS
+	printf( " %i bytes (full %i): %.1fms delta, %.1fms apply... ", (int)Delta.length(), (int)Full.length(), DeltaTime * 1000.0, ApplyTime * 1000.0);
+#endif
+#endif
+	unguardtest
+}
+
+
+//============================= TestPropertyTable
+// Property tables list properties in declaration order and lookups
+// resolve through them.
+//
+void TestPropertyTable()
+{
+	guardtest("Property Table");
+#if USES_CACUS_FIELD
+	static const char* Expected[] = { "Id", "Name", "Score", "bActive", "Note", "Tags", "Pos" };
+	CStruct* Struct = FBenchRecord::GetInstanceCStruct();
+
+	Stage = "Order";
+	checktest( Struct->PropertyCount == ARRAY_COUNT(Expected), "Table has %i properties, expected %i", (int)Struct->PropertyCount, (int)ARRAY_COUNT(Expected));
+	for ( uint32 i=0 ; i<Struct->PropertyCount ; i++ )
+		checktest( !CStrcmp( Struct->PropertyTable[i]->Name, Expected[i]), "Property %i is %s, expected %s", (int)i, Struct->PropertyTable[i]->Name, Expected[i]);
+
+	Stage = "Lookup";
+	for ( uint32 i=0 ; i<Struct->PropertyCount ; i++ )
+		checktest( Struct->FindProperty( Expected[i]) == Struct->PropertyTable[i], "Lookup of %s failed", Expected[i]);
+	checktest( !Struct->FindProperty( "X"), "Found property of a nested struct");
+#endif
+	unguardtest
+}
+
+
+//============================= TestNumberConversion
+// Floats are written with the fewest digits that read back exactly,
+// parsers agree with the C library.
+//
+void TestNumberConversion()
+{
+	guardtest("Number Conversion");
+	static const float Values[] = { 1.5f, 0.1f, -0.0f, 100.0f, 1e21f, 1e-7f, 0.000123f, 123456.7f, 3.4028235e38f, 1.4e-45f };
+	static const char* Expected[] = { "1.5", "0.1", "-0", "100", "1e+21", "1e-7", "0.000123", "123456.7", "3.4028235e+38", "1e-45" };
+	char Text[CNUMBER_TEXT_SIZE];
+
+	Stage = "Format";
+	for ( uint32 i=0 ; i<ARRAY_COUNT(Values) ; i++ )
+	{
+		CFormatFloat( Text, Values[i]);
+		checktest( !CStrcmp( Text, Expected[i]), "Float written as %s, expected %s", Text, Expected[i]);
+	}
+	CFormatInt32( Text, -2147483647 - 1);
+	checktest( !CStrcmp( Text, "-2147483648"), "Int32 written as %s", Text);
+	CFormatUInt32( Text, 4294967295u);
+	checktest( !CStrcmp( Text, "4294967295"), "UInt32 written as %s", Text);
+
+	Stage = "Parse";
+	int32 Int;
+	uint32 UInt;
+	checktest( CParseInt32( " -42x", &Int) == 4 && Int == -42, "Int32 parsed as %i", Int);
+	checktest( CParseInt32( "9999999999", &Int) == 10 && Int == MAXINT, "Int32 didn't saturate (%i)", Int);
+	checktest( CParseUInt32( "0x1F", &UInt) == 4 && UInt == 31, "UInt32 parsed as %u", UInt);
+	static const char* UIntTexts[] = { "010", "0", "08", "0777x", "+017", "0x", "040000000000", "4294967296", " 12" };
+	for ( uint32 i=0 ; i<ARRAY_COUNT(UIntTexts) ; i++ )
+	{
+		char* End;
+		uint32 Expected = (uint32)Min<unsigned long>( strtoul( UIntTexts[i], &End, 0), 0xFFFFFFFFUL);
+		size_t Read = CParseUInt32( UIntTexts[i], &UInt);
+		checktest( UInt == Expected && Read == (size_t)(End - UIntTexts[i]), "UInt32 %s parsed as %u (%i chars), strtoul gives %u (%i chars)", UIntTexts[i], UInt, (int)Read, Expected, (int)(End - UIntTexts[i]));
+	}
+	checktest( !CParseInt32( "abc", &Int), "Parsed a number from text");
+
+	Stage = "Roundtrip";
+	for ( uint32 Bits=1 ; Bits<0x7F800000 ; Bits+=7919 )
+	{
+		float Value, Parsed;
+		CMemcpy( &Value, &Bits, sizeof(Value));
+		CFormatFloat( Text, Value);
+		CParseFloat( Text, &Parsed);
+		checktest( Parsed == Value, "%s parsed as %.9g, expected %.9g", Text, Parsed, Value);
+		checktest( strtof( Text, nullptr) == Value, "%s doesn't read back as %.9g", Text, Value);
+	}
+
+	Stage = "Timing";
+	static const uint32 Count = benchsize(200000, 2000);
+	std::vector<char> Texts( Count * CNUMBER_TEXT_SIZE);
+	float Sum = 0, LibSum = 0;
+	double StartTime = FPlatformTime::Seconds();
+	for ( uint32 i=0 ; i<Count ; i++ )
+		CFormatFloat( &Texts[i * CNUMBER_TEXT_SIZE], (float)i * 0.01f);
+	double FormatTime = FPlatformTime::Seconds() - StartTime;
+	StartTime = FPlatformTime::Seconds();
+	for ( uint32 i=0 ; i<Count ; i++ )
+	{
+		float Value;
+		CParseFloat( &Texts[i * CNUMBER_TEXT_SIZE], &Value);
+		Sum += Value;
+	}
+	double ParseTime = FPlatformTime::Seconds() - StartTime;
+	StartTime = FPlatformTime::Seconds();
+	for ( uint32 i=0 ; i<Count ; i++ )
+		sprintf( &Texts[i * CNUMBER_TEXT_SIZE], "%f", (float)i * 0.01f);
+	double LibFormatTime = FPlatformTime::Seconds() - StartTime;
+	StartTime = FPlatformTime::Seconds();
+	for ( uint32 i=0 ; i<Count ; i++ )
+		LibSum += (float)atof( &Texts[i * CNUMBER_TEXT_SIZE]);
+	double LibParseTime = FPlatformTime::Seconds() - StartTime;
+	checktest( Sum == LibSum, "Parsed values add up to %f, expected %f", Sum, LibSum);
+#ifdef CACUS_USE_BENCHMARKS
+	printf( " format %.0fns (sprintf %.0fns), parse %.0fns (atof %.0fns)... "
+		, FormatTime * 1e9 / Count, LibFormatTime * 1e9 / Count, ParseTime * 1e9 / Count, LibParseTime * 1e9 / Count);
+#endif
+	unguardtest
+}
+
+
+//============================= TestMappedFile
+// Mapped files are parsed straight from their view, without a
+// terminator.
+//
+void TestMappedFile()
+{
+	guardtest("Mapped File");
+	static const char* Filename = "CacusTestMapped.tmp";
+	std::string Text;
+	JSONBenchDocument( Text, 65536);
+
+	Stage = "Map";
+	checktest( cacus::ToFile( Filename, Text), "Failed to write %s", Filename);
+	CMappedFile File( Filename);
+	checktest( File.IsOpen() && File.GetSize() == Text.length(), "Mapped %i bytes, expected %i", (int)File.GetSize(), (int)Text.length());
+	checktest( !CStrncmp( (const char*)File.GetData(), Text.c_str(), Text.length()), "Mapped data differs");
+
+	Stage = "Lines";
+	CParserFastLine8 ViewLines, TextLines;
+	checktest( ViewLines.Parse( (const char*)File.GetData(), File.GetSize()) && TextLines.Parse( Text.c_str()), "Line parser failed");
+	checktest( ViewLines.GetLineCount() == TextLines.GetLineCount(), "Parsed %i lines, expected %i", (int)ViewLines.GetLineCount(), (int)TextLines.GetLineCount());
+	for ( size_t i=0 ; i<TextLines.GetLineCount() ; i++ )
+		checktest( !CStrcmp( ViewLines.GetLineArray()[i], TextLines.GetLineArray()[i]), "Line %i differs", (int)i);
+
+#if USES_CACUS_FIELD
+	Stage = "Import";
+	FBenchDocument Document, Imported;
+	BenchDocument( Document, 2000);
+	std::string Exported = ObjectToData( Document, PARSE_JSON);
+	checktest( cacus::ToFile( Filename, Exported), "Failed to write %s", Filename);
+	checktest( File.Open( Filename) && DataViewToObject( (const char*)File.GetData(), File.GetSize(), Imported, PARSE_JSON), "Failed to import mapped document");
+	std::string Reexported = ObjectToData( Imported, PARSE_JSON);
+	checktest( Exported == Reexported, "Roundtrip differs [%i/%i bytes]", (int)Exported.length(), (int)Reexported.length());
+#endif
+
+	Stage = "Empty";
+	checktest( cacus::ToFile( Filename, ""), "Failed to write %s", Filename);
+	checktest( File.Open( Filename) && !File.GetSize(), "Empty file not mapped");
+	File.Close();
+	remove( Filename);
+	unguardtest
+}
+
+
+//============================= TestLineParser
+// Copy, view and in-situ results of the line parser match, benchmarks
+// report the time each mode takes on a multi megabyte text.
+//
+static void LineBenchText( std::string& Text, size_t MinSize)
+{
+	static const char* Breaks[] = { "\n", "\r\n", "\r", "\n\n" };
+	for ( uint32 i=0 ; Text.length()<MinSize ; i++ )
+	{
+		Text += CSprintf( "Line %u: key_%u = value with some padding text %u", i, i % 97, i * 7919);
+		Text += Breaks[i % ARRAY_COUNT(Breaks)];
+	}
+}
+
+// Parses a widened copy of Text, returns the first line that differs from Expected or -1
+template<typename CHAR> static int32 LineWideMismatch( const std::string& Text, CParserFastLine8& Expected)
+{
+	std::vector<CHAR> Wide( Text.begin(), Text.end());
+	Wide.push_back( 0);
+	for ( size_t i=0 ; i<Text.length() ; i++ )
+		Wide[i] = (CHAR)(uint8)Text[i];
+	CParserFastLine<CHAR> Parser;
+	if ( !Parser.Parse( &Wide[0]) || (Parser.GetLineCount() != Expected.GetLineCount()) )
+		return 0;
+	for ( size_t i=0 ; i<Parser.GetLineCount() ; i++ )
+	{
+		const char* Line = Expected.GetLineArray()[i];
+		const CHAR* WideLine = Parser.GetLineArray()[i];
+		size_t Len = CStrlen( Line);
+		if ( CStrlen( WideLine) != Len )
+			return (int32)i;
+		for ( size_t j=0 ; j<Len ; j++ )
+			if ( WideLine[j] != (CHAR)(uint8)Line[j] )
+				return (int32)i;
+	}
+	return -1;
+}
+
+void TestLineParser()
+{
+	guardtest("Line Parser");
+	std::string Text;
+	LineBenchText( Text, benchsize(4 * 1024 * 1024, 64 * 1024));
+	std::string Mutable = Text;
+
+	CParserFastLine8 Copy, View, InSitu;
+	double StartTime = FPlatformTime::Seconds();
+	checktest( Copy.Parse( Text.c_str()), "Copy mode failed");
+	double CopyTime = FPlatformTime::Seconds() - StartTime;
+	StartTime = FPlatformTime::Seconds();
+	checktest( View.ParseView( Text.c_str(), Text.length()), "View mode failed");
+	double ViewTime = FPlatformTime::Seconds() - StartTime;
+	StartTime = FPlatformTime::Seconds();
+	checktest( InSitu.ParseInSitu( &Mutable[0]), "In-situ mode failed");
+	double InSituTime = FPlatformTime::Seconds() - StartTime;
+
+	Stage = "Compare";
+	size_t Count = Copy.GetLineCount();
+	checktest( View.GetLineCount() == Count && InSitu.GetLineCount() == Count, "Line counts differ %i/%i/%i", (int)Count, (int)View.GetLineCount(), (int)InSitu.GetLineCount());
+	checktest( !View.GetLineArray()[0] && !View.GetViewArray()[Count].Start && !InSitu.GetLineArray()[Count], "Arrays not terminated");
+	for ( size_t i=0 ; i<Count ; i++ )
+	{
+		const char* Line = Copy.GetLineArray()[i];
+		const CParserFastLine8::LineView& Span = View.GetViewArray()[i];
+		checktest( Span.Len == CStrlen(Line) && !CStrncmp( Span.Start, Line, Span.Len), "View of line %i differs", (int)i);
+		checktest( !CStrcmp( InSitu.GetLineArray()[i], Line), "In-situ line %i differs", (int)i);
+	}
+
+	Stage = "Custom breaks";
+	static const char* Breaks[] = { "||", ";", "\n" };
+	static const char* ManyBreaks[] = { "1", "2", "3", "4", "5" };
+	static const char* Expected[] = { "a", "b", "c", "d|e", "" };
+	static const char* ManyExpected[] = { "x", "y", "z", "w" };
+	CParserFastLine8 Custom;
+	Custom.SetLineBreaks( Breaks, ARRAY_COUNT(Breaks));
+	checktest( Custom.Parse( "a;b||c\nd|e;") && Custom.GetLineCount() == ARRAY_COUNT(Expected), "Split into %i lines", (int)Custom.GetLineCount());
+	for ( size_t i=0 ; i<ARRAY_COUNT(Expected) ; i++ )
+		checktest( !CStrcmp( Custom.GetLineArray()[i], Expected[i]), "Line %i is [%s], expected [%s]", (int)i, Custom.GetLineArray()[i], Expected[i]);
+	Custom.SetLineBreaks( ManyBreaks, ARRAY_COUNT(ManyBreaks));
+	checktest( Custom.Parse( "x5y3z1w") && Custom.GetLineCount() == ARRAY_COUNT(ManyExpected), "Split into %i lines", (int)Custom.GetLineCount());
+	for ( size_t i=0 ; i<ARRAY_COUNT(ManyExpected) ; i++ )
+		checktest( !CStrcmp( Custom.GetLineArray()[i], ManyExpected[i]), "Line %i is [%s], expected [%s]", (int)i, Custom.GetLineArray()[i], ManyExpected[i]);
+
+	Stage = "Wide";
+	int32 Mismatch;
+	checktest( (Mismatch=LineWideMismatch<char16>( Text, Copy)) < 0, "char16 line %i differs", Mismatch);
+	checktest( (Mismatch=LineWideMismatch<char32>( Text, Copy)) < 0, "char32 line %i differs", Mismatch);
+	checktest( (Mismatch=LineWideMismatch<wchar_t>( Text, Copy)) < 0, "wchar_t line %i differs", Mismatch);
+	static const char16* WideBreaks[] = { u"\u2028", u"\n" };
+	CParserFastLine16 Wide; //U+0128 and U+010A share low bytes with the breaks, U+0100 with the terminator
+	Wide.SetLineBreaks( WideBreaks, ARRAY_COUNT(WideBreaks));
+	checktest( Wide.Parse( u"a\u0128\u2028b\u010A\u0100\nc") && Wide.GetLineCount() == 3, "Split into %i lines", (int)Wide.GetLineCount());
+	checktest( !CStrcmp( Wide.GetLineArray()[0], u"a\u0128") && !CStrcmp( Wide.GetLineArray()[1], u"b\u010A\u0100") && !CStrcmp( Wide.GetLineArray()[2], u"c"), "Wide custom breaks");
+
+	Stage = "Stream";
+	static const size_t ChunkSizes[] = { 1, 2, 3, 7, 1460, 65536 };
+	size_t StreamEnd = Count;
+	if ( StreamEnd && !*Copy.GetLineArray()[StreamEnd-1] ) //Block parser ends with an empty line after the last break
+		StreamEnd--;
+	for ( size_t c=0 ; c<ARRAY_COUNT(ChunkSizes) ; c++ )
+	{
+		CParserStreamLine8 Stream;
+		size_t Index = 0;
+		const char* Line;
+		size_t Len;
+		for ( size_t Offset=0 ; Offset<Text.length() ; Offset+=ChunkSizes[c] )
+		{
+			Stream.Feed( Text.c_str() + Offset, Min( ChunkSizes[c], Text.length() - Offset));
+			while ( Stream.Next( Line, Len) )
+			{
+				checktest( Index < StreamEnd && Len == CStrlen(Copy.GetLineArray()[Index]) && !CStrncmp( Line, Copy.GetLineArray()[Index], Len), "Chunk size %i: line %i differs", (int)ChunkSizes[c], (int)Index);
+				Index++;
+			}
+		}
+		Stream.Finish();
+		while ( Stream.Next( Line, Len) )
+			Index++;
+		checktest( Index == StreamEnd && !Stream.GetBufferedLen(), "Chunk size %i: got %i lines, expected %i", (int)ChunkSizes[c], (int)Index, (int)StreamEnd);
+	}
+	static const char* StreamExpected[] = { "a", "b", "c", "d|e", "f" };
+	CParserStreamLine8 Stream;
+	Stream.SetLineBreaks( Breaks, ARRAY_COUNT(Breaks));
+	size_t Index = 0;
+	const char* StreamText = "a;b||c\nd|e;f";
+	for ( const char* C=StreamText ; *C ; C++ )
+		Stream.Feed( C, 1, [&]( const char* Line, size_t Len)
+		{
+			checktest( Index < ARRAY_COUNT(StreamExpected) && Len == CStrlen(StreamExpected[Index]) && !CStrncmp( Line, StreamExpected[Index], Len), "Custom stream line %i differs", (int)Index);
+			Index++;
+		});
+	Stream.Finish();
+	Stream.Feed( "", 0, [&]( const char* Line, size_t Len)
+	{
+		checktest( !CStrcmp( Line, "f"), "Last line is [%s]", Line);
+		Index++;
+	});
+	checktest( Index == ARRAY_COUNT(StreamExpected), "Custom stream split into %i lines", (int)Index);
+
+	Stage = "Empty breaks";
+	static const char* NoBreaks[] = { "" };
+	CParserStreamLine8 Unbroken;
+	Unbroken.SetLineBreaks( NoBreaks, ARRAY_COUNT(NoBreaks));
+	const char UnbrokenText[] = "ab\0cd";
+	const char* Line;
+	size_t Len;
+	for ( size_t i=0 ; i<5 ; i++ )
+	{
+		Unbroken.Feed( UnbrokenText + i, 1);
+		checktest( !Unbroken.Next( Line, Len), "Line found without breaks");
+	}
+	Unbroken.Finish();
+	checktest( Unbroken.Next( Line, Len) && (Len == 5) && !CStrncmp( Line+3, "cd", 2), "Unbroken text returned as %i chars", (int)Len);
+
+#ifdef CACUS_USE_BENCHMARKS
+	double MB = (double)Text.length() / (1024.0 * 1024.0);
+	printf( " %.1fMB, %i lines: %.1fMB/s copy, %.1fMB/s view, %.1fMB/s in-situ... ", MB, (int)Count, MB / CopyTime, MB / ViewTime, MB / InSituTime);
+#endif
+	unguardtest
+}
+
+
+//============================= TestXMLReader
+// The pull reader produces the same events regardless of how the
+// document is split into chunks.
+//
+static bool XMLReaderLog( const std::string& Document, size_t ChunkSize, std::string& Log, size_t MaxTokenSize=0, size_t* OutFed=nullptr)
+{
+	CParserStreamXML8 Reader;
+	Reader.SetMaxTokenSize( MaxTokenSize);
+	Log.clear();
+	for ( size_t Offset=0 ; ; Offset+=ChunkSize )
+	{
+		if ( OutFed )
+			*OutFed = Min( Offset + ChunkSize, Document.length());
+		if ( Offset < Document.length() )
+			Reader.Feed( Document.c_str() + Offset, Min( ChunkSize, Document.length() - Offset));
+		else
+			Reader.Finish();
+		for ( ; ; )
+		{
+			CParserStreamXML8::EEvent Event = Reader.Next();
+			switch ( Event )
+			{
+			case CParserStreamXML8::XML_StartElement: Log += CSprintf( "<%s>", Reader.GetName()); break;
+			case CParserStreamXML8::XML_Attribute:    Log += CSprintf( "[%s=%s]", Reader.GetName(), Reader.GetValue()); break;
+			case CParserStreamXML8::XML_Text:         Log += CSprintf( "{%s}", Reader.GetValue()); break;
+			case CParserStreamXML8::XML_Comment:      Log += CSprintf( "(%s)", Reader.GetValue()); break;
+			case CParserStreamXML8::XML_EndElement:   Log += CSprintf( "</%s>", Reader.GetName()); break;
+			case CParserStreamXML8::XML_Done:         return true;
+			case CParserStreamXML8::XML_Error:        return false;
+			default: break;
+			}
+			if ( Event == CParserStreamXML8::XML_NeedData )
+				break;
+		}
+	}
+}
+
+void TestXMLReader()
+{
+	guardtest("XML Reader");
+	static const char* Small =
+		"<?xml version=\"1.0\"?>\r\n"
+		"<!DOCTYPE root [ <!ENTITY e \"x\"> ]>\r\n"
+		"<root xmlns=\"urn:test\" a = 'x>y'>\r\n"
+		"\t<!-- a <comment> -->\r\n"
+		"\t<item id='1' name=\"a &amp; b\">R &lt;1&gt; &#233;&#x41;&bad;</item>\r\n"
+		"\t<empty/><data><![CDATA[<raw> & ]]></data>\r\n"
+		"</root>";
+	static const char* SmallLog =
+		"<root>[xmlns=urn:test][a=x>y]( a <comment> )"
+		"<item>[id=1][name=a & b]{R <1> \xC3\xA9\x41&bad;}</item>"
+		"<empty></empty><data>{<raw> & }</data></root>";
+	std::string Log;
+	checktest( XMLReaderLog( Small, 4096, Log) && (Log == SmallLog), "Small document read as %s", Log.c_str());
+
+	Stage = "Chunks";
+	std::string Document = "<root>";
+	for ( uint32 i=0 ; i<2000 ; i++ )
+		Document += CSprintf( "<device id='%u' type=\"urn:device:%u\"><name>Device &#%u; &lt;%u&gt;</name><!-- %u --><flag/></device>\n", i, i % 7, 0x41 + i % 26, i, i);
+	Document += "</root>\n";
+	std::string WholeLog;
+	checktest( XMLReaderLog( Document, Document.length(), WholeLog), "Document failed");
+	static const size_t ChunkSizes[] = { 1, 2, 3, 7, 64, 1460 };
+	for ( size_t i=0 ; i<ARRAY_COUNT(ChunkSizes) ; i++ )
+		checktest( XMLReaderLog( Document, ChunkSizes[i], Log) && (Log == WholeLog), "Chunk size %i differs", (int)ChunkSizes[i]);
+
+	Stage = "Errors";
+	static const char* Malformed[] =
+	{
+		"<root><a></b></root>",
+		"<root><a>",
+		"<root a=b></root>",
+		"text<root/>",
+		"<root><!-- unterminated",
+	};
+	CDbg_UnregisterCallback( &MainCallback);
+	for ( size_t i=0 ; i<ARRAY_COUNT(Malformed) ; i++ )
+		checktest( !XMLReaderLog( Malformed[i], 3, Log), "Malformed document %i accepted", (int)i);
+	CDbg_RegisterCallback( &MainCallback, CACUS_CALLBACK_ALL);
+
+	Stage = "Token limit";
+	checktest( XMLReaderLog( Document, 64, Log, 256) && (Log == WholeLog), "Document within the token limit failed");
+	static const char* LongTokens[][2] = { {"<root>","</root>"}, {"<root><!--","--></root>"}, {"<root a='","'/>"}, {"<root><![CDATA[","]]></root>"} };
+	CDbg_UnregisterCallback( &MainCallback);
+	for ( size_t i=0 ; i<ARRAY_COUNT(LongTokens) ; i++ )
+	{
+		std::string LongDocument = LongTokens[i][0] + std::string( 20000, 'x') + LongTokens[i][1];
+		size_t Fed = 0;
+		checktest( !XMLReaderLog( LongDocument, 64, Log, 256, &Fed), "Long token %i accepted", (int)i);
+		checktest( Fed <= 512, "Long token %i rejected after %i bytes", (int)i, (int)Fed);
+		checktest( !XMLReaderLog( LongDocument, LongDocument.length(), Log, 256), "Long token %i accepted in one chunk", (int)i);
+	}
+	CDbg_RegisterCallback( &MainCallback, CACUS_CALLBACK_ALL);
+	unguardtest
+}
+
+
+//============================= TestXMLParser
+// UTF-8 and UTF-16 documents are parsed without conversion and give
+// the same tree.
+//
+static bool XMLSameTree( const CParserFastXML::Node<char>* A, const CParserFastXML::Node<char>* B)
+{
+	for ( ; A && B ; A=A->Next, B=B->Next )
+	{
+		if ( (A->Type != B->Type) || (A->Name != B->Name) || CStrcmp( A->Content, B->Content) )
+			return false;
+		const CParserFastXML::Attrib<char>* AttribA = A->Attribute;
+		const CParserFastXML::Attrib<char>* AttribB = B->Attribute;
+		for ( ; AttribA && AttribB ; AttribA=AttribA->Next, AttribB=AttribB->Next )
+			if ( CStrcmp( AttribA->Name, AttribB->Name) || CStrcmp( AttribA->Value, AttribB->Value) )
+				return false;
+		if ( AttribA || AttribB || !XMLSameTree( A->Child, B->Child) )
+			return false;
+	}
+	return !A && !B;
+}
+
+void TestXMLParser()
+{
+	guardtest("XML Parser");
+	CParserFastXML Parser8, Parser16;
+	checktest( Parser8.Parse( "\xEF\xBB\xBF<?xml version=\"1.0\"?>\r\n<root><device><name>R &lt;1&gt; &#233;&#x1F600;</name><serviceList><service><id>a</id></service><service><id>b</id></service></serviceList></device></root>"), "UTF-8 parse failed");
+	checktest( Parser16.Parse( u"<?xml version=\"1.0\"?>\r\n<root><device><name>R &lt;1&gt; &#233;&#x1F600;</name><serviceList><service><id>a</id></service><service><id>b</id></service></serviceList></device></root>"), "UTF-16 parse failed");
+	checktest( Parser8.GetRoot<char>() && !Parser8.GetRoot<char16>() && Parser16.GetRoot<char16>() && !Parser16.GetRoot<char>(), "Root width mismatch");
+
+	Stage = "Browse";
+	auto Browser8 = Parser8.CreateBrowser<char>();
+	auto Browser16 = Parser16.CreateBrowser<char16>();
+	checktest( Browser8.Start("root") && Browser8.Down("device") && Browser8.Down("name"), "UTF-8 name not found");
+	checktest( Browser16.Start(u"root") && Browser16.Down(u"device") && Browser16.Down(u"name"), "UTF-16 name not found");
+	checktest( !CStrcmp( *Browser8, "R <1> \xC3\xA9\xF0\x9F\x98\x80"), "UTF-8 text is %s", *Browser8);
+	checktest( !CStrcmp( *Browser16, u"R <1> \u00E9\U0001F600"), "UTF-16 text differs");
+	checktest( Browser8.Next("serviceList") && Browser8.Down("service") && !CStrcmp( *Browser8, "<id>a</id>"), "First service is %s", *Browser8);
+	checktest( Browser8.Next("service") && !CStrcmp( *Browser8, "<id>b</id>") && !Browser8.Next("service"), "Second service");
+
+	Stage = "Unknown names";
+	int32 NameCount = CName::Count();
+	CParserFastXML Unknown;
+	checktest( Unknown.Parse( "<root><xml_unlisted_a>1</xml_unlisted_a><XML_Unlisted_B>2</XML_Unlisted_B></root>") && Unknown.BuildIndex(), "Parse failed");
+	checktest( CName::Count() == NameCount, "Parse added %i names", CName::Count() - NameCount);
+	auto UnknownBrowser = Unknown.CreateBrowser<char>();
+	checktest( UnknownBrowser.Query( "root/xml_unlisted_b") && !CStrcmp( *UnknownBrowser, "2"), "Unknown name not found by text");
+
+	Stage = "Late names";
+	CParserFastXML Late;
+	checktest( Late.Parse( "<xml_late_root><xml_late_item>1</xml_late_item><other/><XML_Late_Item>2</XML_Late_Item></xml_late_root>") && Late.BuildIndex(), "Parse failed");
+	CName LateRoot( "xml_late_root"); //Added to the name table after the index was built
+	CName LateItem( "xml_late_item");
+	auto LateBrowser = Late.CreateBrowser<char>();
+	checktest( LateBrowser.Start( "xml_late_root") && LateBrowser.Query( "xml_late_root/Xml_Late_Item") && !CStrcmp( *LateBrowser, "1"), "Name added after indexing not found");
+	checktest( LateBrowser.Next( "xml_late_item") && !CStrcmp( *LateBrowser, "2") && !LateBrowser.Next( "xml_late_item"), "Same named sibling not found");
+	checktest( Parser16.BuildIndex(), "UTF-16 index failed");
+	Browser16 = Parser16.CreateBrowser<char16>();
+	checktest( Browser16.Query( u"root/device/serviceList/service") && Browser16.Next( u"service") && Browser16.Down( u"id") && !CStrcmp( *Browser16, u"b"), "UTF-16 indexed query failed");
+
+	Stage = "Index";
+	const uint32 ItemCount = benchsize(20000, 2000);
+	std::string Document = "<root>";
+	for ( uint32 i=0 ; i<ItemCount ; i++ )
+		Document += CSprintf( "<item><id>%u</id><name>Item %u</name></item><other/>", i, i);
+	Document += "<last><value>end</value></last></root>";
+	CParserFastXML Linear, Indexed;
+	checktest( Linear.Parse( Document.c_str()) && Indexed.Parse( Document.c_str()) && Indexed.BuildIndex() && !Linear.HasIndex(), "Large document parse failed");
+	double Times[2];
+	for ( int32 Pass=0 ; Pass<2 ; Pass++ )
+	{
+		double StartTime = FPlatformTime::Seconds();
+		for ( uint32 i=0 ; i<200 ; i++ )
+		{
+			auto Browser = (Pass ? Indexed : Linear).CreateBrowser<char>();
+			checktest( Browser.Query( "root/last/value") && !CStrcmp( *Browser, "end"), "Query failed (pass %i)", Pass);
+		}
+		auto Items = (Pass ? Indexed : Linear).CreateBrowser<char>();
+		uint32 Count = 0;
+		for ( bool bFound=Items.Query( "root/item") ; bFound ; bFound=Items.Next( "item"), Count++ )
+		{
+			auto Id = Items;
+			checktest( Id.Down( "id") && !CStrcmp( *Id, CSprintf( "%u", Count)), "Item %u not found (pass %i)", Count, Pass);
+		}
+		checktest( Count == ItemCount, "Found %u items (pass %i)", Count, Pass);
+		Times[Pass] = FPlatformTime::Seconds() - StartTime;
+	}
+#ifdef CACUS_USE_BENCHMARKS
+	printf( " query %.2fms linear, %.2fms indexed... ", Times[0] * 1000.0, Times[1] * 1000.0);
+#endif
+
+	Stage = "Layout";
+	Document = "<root><head><title>Layout</title></head>";
+	for ( uint32 i=0 ; i<benchsize(100000, 2000) ; i++ ) //Above XML_LAYOUT_MIN_NODES either way
+		Document += CSprintf( "<item id=\"%u\" kind=\"k%u\"><name>Item &amp; %u</name><value>%u</value></item>", i, i & 7, i, i * 3);
+	Document += "</root><!-- trailing -->";
+	CParserFastXML Single;
+	double StartTime = FPlatformTime::Seconds();
+	checktest( Single.Parse( Document.c_str()), "Single threaded parse failed");
+	double SingleTime = FPlatformTime::Seconds() - StartTime;
+#ifdef CACUS_USE_BENCHMARKS
+	printf( "\n  parse with layout threads 1: %.2fms\n", SingleTime * 1000.0);
+#endif
+	uint32 ThreadCounts[] = { 2, 4, 0 };
+	for ( uint32 i=0 ; i<ARRAY_COUNT(ThreadCounts) ; i++ )
+	{
+		CParserFastXML Multi;
+		Multi.SetLayoutThreads( ThreadCounts[i]);
+		StartTime = FPlatformTime::Seconds();
+		checktest( Multi.Parse( Document.c_str()), "Parse failed with %u threads", ThreadCounts[i]);
+		double MultiTime = FPlatformTime::Seconds() - StartTime;
+		checktest( XMLSameTree( Single.GetRoot<char>(), Multi.GetRoot<char>()), "Tree differs with %u threads", ThreadCounts[i]);
+		auto Browser = Multi.CreateBrowser<char>();
+		checktest( Browser.Query( "root/item") && Browser.Down( "value") && !CStrcmp( *Browser, "0"), "First item value");
+#ifdef CACUS_USE_BENCHMARKS
+		printf( "  parse with layout threads %u: %.2fms (x%.2f)\n", ThreadCounts[i] ? ThreadCounts[i] : CGetProcessorCount(), MultiTime * 1000.0, SingleTime / MultiTime);
+#endif
+	}
+
+	Stage = "Limits";
+	std::string Deep;
+	for ( uint32 i=0 ; i<100 ; i++ )
+		Deep += "<a>";
+	for ( uint32 i=0 ; i<100 ; i++ )
+		Deep += "</a>";
+	CParserFastXML Limited;
+	CParserFastXML::CLimits Limits = { 64, 0, 0, 0 };
+	Limited.SetLimits( Limits);
+	CDbg_UnregisterCallback( &MainCallback);
+	bool bDeepParsed = Limited.Parse( Deep.c_str());
+	Limits = CParserFastXML::CLimits{ 0, 1000, 0, 0 };
+	Limited.SetLimits( Limits);
+	bool bNodesParsed = Limited.Parse( Document.c_str());
+	Limits = CParserFastXML::CLimits{ 0, 0, 1000, 0 };
+	Limited.SetLimits( Limits);
+	bool bAttributesParsed = Limited.Parse( Document.c_str());
+	Limits = CParserFastXML::CLimits{ 0, 0, 0, 64 * 1024 };
+	Limited.SetLimits( Limits);
+	bool bMemoryParsed = Limited.Parse( Document.c_str());
+	CDbg_RegisterCallback( &MainCallback, CACUS_CALLBACK_ALL);
+	checktest( !bDeepParsed && !bNodesParsed && !bAttributesParsed && !bMemoryParsed && !Limited.GetRoot<char>(), "Limits not enforced");
+	Limits = CParserFastXML::CLimits{ 100, 0, 0, 0 };
+	Limited.SetLimits( Limits);
+	checktest( Limited.Parse( Deep.c_str()), "Depth limit too strict");
+	Limits = CParserFastXML::CLimits{ 16, 600000, 200000, 256 * 1024 * 1024 };
+	Limited.SetLimits( Limits);
+	checktest( Limited.Parse( Document.c_str()) && XMLSameTree( Single.GetRoot<char>(), Limited.GetRoot<char>()), "Parse within limits failed");
+	unguardtest
+}
+
+//============================= TestSocketPoller
+// UDP sockets on loopback, only the ones that received data are reported.
+// A ticker with the poller set dispatches while waiting for the next tick.
+//
+static int32 PollerCallbackCount = 0;
+static void PollerCallback( CSocketPoller* Poller, const CSocketPoller::Event& Ready)
+{
+	uint8 Buffer[16];
+	int32 BytesRead;
+	while ( Ready.Socket->Recv( Buffer, sizeof(Buffer), BytesRead) && BytesRead > 0 )
+		PollerCallbackCount++;
+}
+
+static uint32 PollerReadyMask( CSocketPoller::Event* Events, int32 Count, uint32 Flags)
+{
+	uint32 Mask = 0;
+	for ( int32 i=0 ; i<Count ; i++ )
+		if ( Events[i].Flags & Flags )
+			Mask |= 1 << (uint32)(int_p)Events[i].UserData;
+	return Mask;
+}
+
+void TestSocketPoller()
+{
+	guardtest("Socket Poller");
+	const int32 SocketCount = 32;
+	std::vector<CSocket> Sockets;
+	std::vector<IPEndpoint> Endpoints;
+	int32 Slots[SocketCount];
+	Sockets.reserve( SocketCount);
+	CSocketPoller Poller;
+	for ( int32 i=0 ; i<SocketCount ; i++ )
+	{
+		Sockets.emplace_back( false);
+		IPEndpoint Local( IPAddress::InternalLoopback_v4, 0);
+		checktest( !Sockets[i].IsInvalid() && Sockets[i].SetNonBlocking() && Sockets[i].BindPort( Local), "Socket %i setup failed", i);
+		Endpoints.push_back( Local);
+		Slots[i] = Poller.Add( &Sockets[i], SOCKET_PollRead, (void*)(int_p)i);
+		checktest( Slots[i] >= 0, "Socket %i not added", i);
+	}
+	CSocket Sender( false);
+	uint8 Byte = 1;
+	int32 BytesSent;
+	CSocketPoller::Event Events[SocketCount];
+	checktest( Poller.Num() == SocketCount && Poller.Wait( Events, SocketCount, 0) == 0, "Idle sockets reported");
+
+	Stage = "Ready";
+	uint32 Expected = (1 << 3) | (1 << 7) | (1 << 20);
+	for ( int32 i=0 ; i<SocketCount ; i++ )
+		if ( Expected & (1 << i) )
+			Sender.SendTo( &Byte, 1, BytesSent, Endpoints[i]);
+	uint32 Ready = 0;
+	for ( int32 Tries=0 ; (Tries < 100) && (Ready != Expected) ; Tries++ )
+		Ready = PollerReadyMask( Events, Poller.Wait( Events, SocketCount, 0.01), SOCKET_PollRead);
+	checktest( Ready == Expected, "Ready mask %08X", Ready);
+	Ready = PollerReadyMask( Events, Poller.Wait( Events, SocketCount, 0), SOCKET_PollRead);
+	checktest( Ready == Expected, "Level triggered sockets not reported again (%08X)", Ready);
+	checktest( Poller.Wait( Events, 2, 0) == 2, "Event count not capped");
+
+	Stage = "Modify";
+	uint8 Buffer[16];
+	int32 BytesRead;
+	for ( int32 i=0 ; i<SocketCount ; i++ )
+		if ( Expected & (1 << i) )
+			Sockets[i].Recv( Buffer, sizeof(Buffer), BytesRead);
+	checktest( Poller.Wait( Events, SocketCount, 0) == 0, "Sockets still ready after read");
+	checktest( Poller.Remove( Slots[7]) && !Poller.Remove( Slots[7]) && Poller.Num() == SocketCount - 1, "Remove failed");
+	checktest( !Poller.Modify( Slots[7], SOCKET_PollRead) && !Poller.Remove( -1) && !Poller.Remove( SocketCount), "Invalid slot accepted");
+	checktest( Poller.Modify( Slots[3], SOCKET_PollWrite), "Modify failed");
+	Sender.SendTo( &Byte, 1, BytesSent, Endpoints[7]);
+	Ready = PollerReadyMask( Events, Poller.Wait( Events, SocketCount, 0.05), SOCKET_PollRead|SOCKET_PollWrite);
+	checktest( Ready == (1 << 3), "Ready mask after modify %08X", Ready);
+	Slots[7] = Poller.Add( &Sockets[7], SOCKET_PollRead, (void*)(int_p)7);
+	checktest( Poller.Modify( Slots[3], SOCKET_PollRead) && (Slots[7] >= 0), "Restore failed");
+
+	Stage = "Ticker";
+	Poller.Callback = &PollerCallback;
+	PollerCallbackCount = 0;
+	CTickerEngine Ticker;
+	Ticker.SetPoller( &Poller);
+	Ticker.TickNow();
+	double StartTime = FPlatformTime::Seconds();
+	Ticker.TickAbsolute( Ticker.GetLastTickTimestamp() + 0.05); //Packet sent to socket 7 while removed
+	checktest( PollerCallbackCount == 1, "Ticker dispatched %i packets", PollerCallbackCount);
+	Sender.SendTo( &Byte, 1, BytesSent, Endpoints[20]);
+	Ticker.TickAbsolute( Ticker.GetLastTickTimestamp() + 0.05);
+	checktest( PollerCallbackCount == 2, "Ticker dispatched %i packets", PollerCallbackCount);
+	checktest( FPlatformTime::Seconds() - StartTime >= 0.099, "Ticks ended early");
+	Ticker.SetPoller( nullptr);
+
+	Stage = "CheckState";
+	StartTime = FPlatformTime::Seconds();
+	checktest( Sockets[0].CheckState( SOCKET_Readable, 0.02) == SOCKET_Timeout, "Idle socket readable");
+	double Waited = FPlatformTime::Seconds() - StartTime;
+	checktest( Waited >= 0.0195 && Waited < 0.5, "Waited %.2fms", Waited * 1000.0);
+	checktest( Sockets[0].CheckState( SOCKET_Writable, 0) == SOCKET_Writable, "Socket not writable");
+	Sender.SendTo( &Byte, 1, BytesSent, Endpoints[0]);
+	checktest( Sockets[0].CheckState( SOCKET_Readable, 1.0) == SOCKET_Readable, "Socket not readable");
+	uint32 PollReady = Sockets[0].Poll( SOCKET_PollRead|SOCKET_PollWrite, 0);
+	checktest( PollReady == (SOCKET_PollRead|SOCKET_PollWrite), "Combined poll returned %X", PollReady);
+	Sockets[0].Recv( Buffer, sizeof(Buffer), BytesRead);
+#ifndef _WINDOWS
+	// Descriptors past FD_SETSIZE
+	struct CHighSocket : public CSocket
+	{
+		CHighSocket()
+			: CSocket( false)
+		{
+			int High = dup2( (int)SocketDescriptor, FD_SETSIZE + 64);
+			close( (int)SocketDescriptor);
+			SocketDescriptor = High;
+		}
+	};
+	CHighSocket HighSocket;
+	IPEndpoint HighLocal( IPAddress::InternalLoopback_v4, 0);
+	if ( !HighSocket.IsInvalid() && HighSocket.BindPort( HighLocal) )
+	{
+		Sender.SendTo( &Byte, 1, BytesSent, HighLocal);
+		checktest( HighSocket.CheckState( SOCKET_Readable, 1.0) == SOCKET_Readable, "High descriptor not readable");
+		HighSocket.Recv( Buffer, sizeof(Buffer), BytesRead);
+		checktest( HighSocket.CheckState( SOCKET_Readable, 0) == SOCKET_Timeout, "High descriptor still readable");
+	}
+#endif
+
+#ifdef CACUS_USE_BENCHMARKS
+	Stage = "Scaling";
+	double Times[2];
+	int32 Rounds = 2000;
+	StartTime = FPlatformTime::Seconds();
+	for ( int32 Round=0 ; Round<Rounds ; Round++ )
+		for ( int32 i=0 ; i<SocketCount ; i++ )
+			Sockets[i].CheckState( SOCKET_Readable, 0);
+	Times[0] = FPlatformTime::Seconds() - StartTime;
+	StartTime = FPlatformTime::Seconds();
+	for ( int32 Round=0 ; Round<Rounds ; Round++ )
+		Poller.Wait( Events, SocketCount, 0);
+	Times[1] = FPlatformTime::Seconds() - StartTime;
+	printf( " %i sockets: %.2fus per-socket check, %.2fus poller wait... ", SocketCount, Times[0] * 1000000.0 / Rounds, Times[1] * 1000000.0 / Rounds);
+#endif
+
+	for ( int32 i=0 ; i<SocketCount ; i++ )
+		Poller.Remove( Slots[i]);
+	checktest( Poller.Num() == 0, "Sockets left in poller");
+	unguardtest
+}
+
+#endif
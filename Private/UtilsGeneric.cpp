@@ -5,6 +5,15 @@
 	Various general purpose utils implementations.
 =============================================================================*/
 
+#if _WINDOWS
+	#include <Windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
 #include "CacusLibPrivate.h"
 
 #include "Utils.h"
@@ -114,3 +123,127 @@ bool CACUS_API cacus::FromFile( const char* InFilename, std::string& OutData)
 	return false;
 }
 #endif
+
+
+
+//========= CMappedFile - begin ==========//
+//
+// Empty files are opened with a zero size view as they can't be mapped.
+//
+CMappedFile::CMappedFile()
+	: Data(nullptr)
+	, Size(0)
+	, bOpen(false)
+#if _WINDOWS
+	, FileHandle(nullptr)
+	, MappingHandle(nullptr)
+#endif
+{
+}
+
+CMappedFile::CMappedFile( const char* InFilename)
+	: CMappedFile()
+{
+	Open( InFilename);
+}
+
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+#if _WINDOWS
+bool CMappedFile::Open( const char* InFilename)
+{
+	Close();
+	HANDLE File = CreateFileA( InFilename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if ( File == INVALID_HANDLE_VALUE )
+	{
+		DebugCallback( CSprintf("Failed to open file for mapping %s", InFilename), CACUS_CALLBACK_IO);
+		return false;
+	}
+	LARGE_INTEGER FileSize;
+	if ( !GetFileSizeEx( File, &FileSize) || (uint64)FileSize.QuadPart > (uint64)(size_t)-1 )
+	{
+		DebugCallback( CSprintf("Failed to get size of %s", InFilename), CACUS_CALLBACK_IO);
+		CloseHandle( File);
+		return false;
+	}
+	FileHandle = File;
+	Size = (size_t)FileSize.QuadPart;
+	if ( Size )
+	{
+		MappingHandle = CreateFileMappingA( File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		Data = MappingHandle ? (const uint8*)MapViewOfFile( MappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if ( !Data )
+		{
+			DebugCallback( CSprintf("Failed to map %s", InFilename), CACUS_CALLBACK_IO);
+			Close();
+			return false;
+		}
+	}
+	bOpen = true;
+	return true;
+}
+
+void CMappedFile::Close()
+{
+	if ( Data )
+		UnmapViewOfFile( Data);
+	if ( MappingHandle )
+		CloseHandle( MappingHandle);
+	if ( FileHandle )
+		CloseHandle( FileHandle);
+	Data = nullptr;
+	Size = 0;
+	bOpen = false;
+	FileHandle = nullptr;
+	MappingHandle = nullptr;
+}
+
+#else
+bool CMappedFile::Open( const char* InFilename)
+{
+	Close();
+	int File = open( InFilename, O_RDONLY);
+	if ( File < 0 )
+	{
+		DebugCallback( CSprintf("Failed to open file for mapping %s", InFilename), CACUS_CALLBACK_IO);
+		return false;
+	}
+	struct stat FileStat;
+	if ( fstat( File, &FileStat) != 0 || (uint64)FileStat.st_size > (uint64)(size_t)-1 )
+	{
+		DebugCallback( CSprintf("Failed to get size of %s", InFilename), CACUS_CALLBACK_IO);
+		close( File);
+		return false;
+	}
+	size_t FileSize = (size_t)FileStat.st_size;
+	if ( FileSize )
+	{
+		void* Mapping = mmap( nullptr, FileSize, PROT_READ, MAP_PRIVATE, File, 0);
+		if ( Mapping == MAP_FAILED )
+		{
+			DebugCallback( CSprintf("Failed to map %s", InFilename), CACUS_CALLBACK_IO);
+			close( File);
+			return false;
+		}
+		madvise( Mapping, FileSize, MADV_SEQUENTIAL);
+		Data = (const uint8*)Mapping;
+	}
+	close( File); //Mapping stays valid
+	Size = FileSize;
+	bOpen = true;
+	return true;
+}
+
+void CMappedFile::Close()
+{
+	if ( Data )
+		munmap( (void*)Data, Size);
+	Data = nullptr;
+	Size = 0;
+	bOpen = false;
+}
+#endif
+//========= CMappedFile - end ==========//